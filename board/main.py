@@ -5,6 +5,7 @@ import sys, time, requests, json, ast
 from threading import Thread
 
 import serial
+import referee_frame
 from PyQt5.QtWidgets import QApplication
 from PyQt5.QtCore import QObject, pyqtSignal, pyqtSlot, QTime, QTimer, QThread
 from PyQt5.QtQml import QQmlApplicationEngine
@@ -135,6 +136,7 @@ class MainWindow(QObject):
                 self.uart_rak_init()
             b = b''
             intcounter = 0
+            link = referee_frame.LinkReceiver()
             while (1):
                 
                 #time.sleep(3)  
@@ -156,34 +158,37 @@ class MainWindow(QObject):
                         # ID8888888888888888COM1P36END
                         parse_data = b[self.rak811_parse(b,',',3):]
                         log ("[UART] Received hex: {0}".format(parse_data))
-                        parse_data = bytearray.fromhex(parse_data).decode()
-                        log ("[UART] Received message: {0}".format(parse_data))
-                        #log (parse_data[20])
-                        parse_lol = self.rak811_parse(parse_data,'M',1)
-                        command = parse_data[parse_lol:]
-                        log ("[UART] Received command: {0}".format(command))
-
-                        if (command[0] == "1" or command[0] == "2"):
-                            log ("command 1 or 2")
+                        received, ack = link.receive(bytearray.fromhex(parse_data))
+                        if ack is not None:
+                            self.ser.write(("at+txc=1,10," + ack.hex().upper() + "\r\n").encode())
+                        for parse_data in received:
+                            log ("[UART] Received message: {0}".format(parse_data))
+                            #log (parse_data[20])
+                            parse_lol = self.rak811_parse(parse_data,'M',1)
+                            command = parse_data[parse_lol:]
+                            log ("[UART] Received command: {0}".format(command))
+
+                            if (command[0] == "1" or command[0] == "2"):
+                                log ("command 1 or 2")
                             
-                            approach = ''
-                            counter_data = ''
-                            for approach in parse_data[23:]:
-                                if (approach == 'E'):
-                                    break
-                                counter_data += approach
+                                approach = ''
+                                counter_data = ''
+                                for approach in parse_data[23:]:
+                                    if (approach == 'E'):
+                                        break
+                                    counter_data += approach
                             
-                            #counter_data = parse_data[self.rak811_parse(parse_data,'E',1):]
-                            log (counter_data)
-                            #self.namevisible_change(self.req_namevisible)
-                            self.counter_add(counter_data)
-                        if (command[0] == '3'):
-                            #at+txc=1,10,494438383838383838383838383838383838434f4d33503336454e44
-                            self.startTimer.emit()
-                        if (command[0] == '4'):
-                            self.timer_reset()
-                            self.database_next()
-                            self.database_response()
+                                #counter_data = parse_data[self.rak811_parse(parse_data,'E',1):]
+                                log (counter_data)
+                                #self.namevisible_change(self.req_namevisible)
+                                self.counter_add(counter_data)
+                            if (command[0] == '3'):
+                                #at+txc=1,10,494438383838383838383838383838383838434f4d33503336454e44
+                                self.startTimer.emit()
+                            if (command[0] == '4'):
+                                self.timer_reset()
+                                self.database_next()
+                                self.database_response()
                     """                 
                     if (b[0] == 'I'):
                         if (len(b) > 22):
@@ -0,0 +1,175 @@
+#!/usr/bin/env python3
+#coding: utf-8
+
+""" Двоичный кадр судейского пульта (версия 1) и преобразование в старый текстовый формат.
+
+Формат описан в mstn-fw/workspace/1986BE92/src/referee_frame.hpp.
+Старый формат: ID8888888888888888COM1P36END
+
+Использование:
+    referee_frame.py decode 21B89CAEC5DB8CE50F0701243549
+    referee_frame.py encode ID8888888888888888COM1P36END [seq]
+
+Кадры событий подтверждаются кадром ACK: seq - последний принятый номер,
+бит i в ack_mask - принят кадр seq-1-i. Повторы отбрасываются LinkReceiver.
+"""
+
+import re, struct, sys
+
+VERSION = 1
+TYPE_EVENTS = 0
+TYPE_ACK = 1
+MAX_EVENTS = 8
+
+LEGACY = re.compile(r'^ID(\d+)COM(\d)P(\d*)END$')
+
+
+def crc16(data, crc=0xFFFF):
+    for b in data:
+        crc ^= b << 8
+        for _ in range(8):
+            crc = ((crc << 1) ^ 0x1021) & 0xFFFF if crc & 0x8000 else (crc << 1) & 0xFFFF
+    return crc
+
+
+def put_varint(val):
+    out = bytearray()
+    while val >= 0x80:
+        out.append((val & 0x7F) | 0x80)
+        val >>= 7
+    out.append(val)
+    return out
+
+
+def get_varint(data, pos):
+    val, shift = 0, 0
+    while pos < len(data) and shift < 70:
+        b = data[pos]
+        pos += 1
+        val |= (b & 0x7F) << shift
+        if not b & 0x80:
+            return val, pos
+        shift += 7
+    raise ValueError("bad varint")
+
+
+def is_binary(data):
+    return len(data) > 0 and data[0] >> 5 == VERSION
+
+
+def encode(device_id, seq, events=(), ack_mask=None):
+    """ events - список пар (команда, номер подхода); ack_mask задает кадр подтверждения """
+    if len(events) > MAX_EVENTS:
+        raise ValueError("too many events")
+    frame_type = TYPE_EVENTS if ack_mask is None else TYPE_ACK
+    out = bytearray([(VERSION << 5) | (frame_type << 4) | len(events)])
+    out += put_varint(device_id)
+    out.append(seq & 0xFF)
+    if frame_type == TYPE_ACK:
+        out.append(ack_mask & 0xFF)
+    for (command, approach) in events:
+        out.append(command)
+        out += put_varint(approach)
+    out += struct.pack('<H', crc16(out))
+    return bytes(out)
+
+
+def decode(data):
+    data = bytearray(data)
+    if len(data) < 5 or not is_binary(data):
+        raise ValueError("not a version {0} frame".format(VERSION))
+    if crc16(data[:-2]) != struct.unpack('<H', bytes(data[-2:]))[0]:
+        raise ValueError("CRC mismatch")
+    end = len(data) - 2
+    frame_type, count = (data[0] >> 4) & 1, data[0] & 0x0F
+    device_id, pos = get_varint(data, 1)
+    seq = data[pos]
+    pos += 1
+    frame = {'type': frame_type, 'id': device_id, 'seq': seq, 'events': [], 'ack_mask': None}
+    if frame_type == TYPE_ACK:
+        frame['ack_mask'] = data[pos]
+        pos += 1
+    for _ in range(count):
+        command = data[pos]
+        approach, pos = get_varint(data, pos + 1)
+        frame['events'].append((command, approach))
+    if pos != end:
+        raise ValueError("bad frame length")
+    return frame
+
+
+def to_legacy(frame):
+    """ по строке старого формата на каждое событие """
+    return ["ID{0:016d}COM{1}P{2}END".format(frame['id'], command, approach)
+            for (command, approach) in frame['events']]
+
+
+def from_legacy(text, seq=0):
+    m = LEGACY.match(text.strip())
+    if not m:
+        raise ValueError("not a legacy frame: {0}".format(text))
+    return encode(int(m.group(1)), seq, [(int(m.group(2)), int(m.group(3) or 0))])
+
+
+def messages(data):
+    """ сообщения в старом формате из принятых байт любого формата """
+    if is_binary(data):
+        return to_legacy(decode(data))
+    return [bytes(data).decode()]
+
+
+class LinkReceiver:
+    """ Отбрасывает повторно принятые кадры и формирует подтверждения """
+
+    WINDOW = 8
+
+    def __init__(self):
+        self.devices = {}   # id -> [последний seq, маска предыдущих]
+
+    def receive(self, data):
+        """ возвращает (сообщения в старом формате, байты подтверждения или None) """
+        if not is_binary(data):
+            return [bytes(data).decode()], None
+        frame = decode(data)
+        if frame['type'] != TYPE_EVENTS:
+            return [], None
+
+        seq = frame['seq']
+        state = self.devices.get(frame['id'])
+        fresh = True
+        if state is None:
+            state = self.devices[frame['id']] = [seq, 0]
+        else:
+            last, mask = state
+            ahead = (seq - last) & 0xFF
+            back = (last - seq) & 0xFF
+            if ahead == 0:
+                fresh = False
+            elif ahead < 0x80:
+                state[0] = seq
+                state[1] = ((mask << ahead) | (1 << (ahead - 1))) & 0xFF
+            elif back <= self.WINDOW:
+                bit = 1 << (back - 1)
+                fresh = not mask & bit
+                state[1] |= bit
+            else:
+                # пульт перезапущен
+                state[0], state[1] = seq, 0
+
+        ack = encode(frame['id'], state[0], ack_mask=state[1])
+        return (to_legacy(frame) if fresh else []), ack
+
+
+if __name__ == "__main__":
+    if len(sys.argv) < 3 or sys.argv[1] not in ('decode', 'encode'):
+        print(__doc__)
+        sys.exit(1)
+
+    if sys.argv[1] == 'decode':
+        frame = decode(bytearray.fromhex(sys.argv[2]))
+        print(frame)
+        for line in to_legacy(frame):
+            print(line)
+    else:
+        seq = int(sys.argv[3]) if len(sys.argv) > 3 else 0
+        print(from_legacy(sys.argv[2], seq).hex().upper())
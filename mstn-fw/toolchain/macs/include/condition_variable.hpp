@@ -0,0 +1,37 @@
+/** @copyright AstroSoft Ltd */
+#pragma once
+
+#include "scheduler.hpp"
+#include "mutex.hpp"
+
+namespace macs
+{
+
+// Условная переменная при мьютексе: Wait освобождает мьютекс и блокирует задачу одним вызовом ядра.
+// Оповещенная задача не будится, а переставляется в очередь мьютекса и просыпается уже его владельцем.
+// Все ожидающие одновременно должны ждать при одном и том же мьютексе, захваченном однократно.
+class ConditionVariable: public SyncObject
+{
+public:
+	ConditionVariable();
+	~ConditionVariable();
+
+	// по таймауту мьютекс захватывается заново, возвращается ResultTimeout
+	Result Wait(Mutex & mutex, uint32_t timeout_ms = INFINITE_TIMEOUT);
+	Result NotifyOne();
+	Result NotifyAll();
+
+	static Result Wait_Priv(ConditionVariable * pC, Mutex * pM, uint32_t timeout_ms);
+	static Result Notify_Priv(ConditionVariable * pC, bool all);
+
+private:
+	CLS_COPY(ConditionVariable)
+
+	Result Notify(bool all);
+	void Requeue(Task * task);
+
+private:
+	Mutex * m_mutex;
+};
+
+}
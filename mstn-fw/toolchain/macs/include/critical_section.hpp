@@ -4,6 +4,7 @@
 #include <stdint.h>
 #include "system.hpp"
 #include "application.hpp"
+#include "mask_budget.hpp"
 
 namespace macs
 {
@@ -17,9 +18,17 @@ public:
 			App().OnAlarm(AR_NOT_IN_PRIVILEGED);
 
 		m_prev_interrupt_mask = System::DisableIrq();
+#if MACS_MASK_BUDGET_ENABLED
+		if (!m_prev_interrupt_mask)
+			MaskBudget::EnterIrq();
+#endif
 	}
 	inline ~CriticalSection()
 	{
+#if MACS_MASK_BUDGET_ENABLED
+		if (!m_prev_interrupt_mask)
+			MaskBudget::LeaveIrq();
+#endif
 		System::EnableIrq(m_prev_interrupt_mask);
 	}
 
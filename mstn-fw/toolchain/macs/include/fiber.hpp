@@ -0,0 +1,116 @@
+/** @copyright AstroSoft Ltd */
+#pragma once
+
+#include "scheduler.hpp"
+#include "semaphore.hpp"
+#include "wait_set.hpp"
+
+namespace macs
+{
+
+// Бесстековое волокно: Run() вызывается задачей-хозяином заново при каждом продолжении
+// и переходит к точке, на которой остановилось. Между точками FIBER_* локальные переменные
+// не сохраняются - состояние держится в членах класса. Внутри Run() нельзя использовать switch
+// с точками ожидания в его ветвях и блокирующие вызовы ядра.
+//
+// void Execute() {                      void Run() {
+//     for (;;) {                            FIBER_BEGIN();
+//         m_sem.Wait();         ->          for (;;) {
+//         Task::Delay(10);                      FIBER_WAIT(m_sem, INFINITE_TIMEOUT);
+//     }                                         FIBER_SLEEP(10);
+// }                                         }
+//                                           FIBER_END();
+//                                       }
+class Fiber
+{
+public:
+	enum State
+	{
+		StateReady,
+		StateSleeping,
+		StateWaiting,   // семафор, возможно с таймаутом
+		StatePolling,   // условие проверяется при каждом пробуждении хозяина
+		StateFinished
+	};
+
+	Fiber();
+	virtual ~Fiber()
+	{
+	}
+
+	State GetState() const
+	{
+		return m_state;
+	}
+
+protected:
+	virtual void Run() = 0;
+
+	// результат последнего FIBER_WAIT: ResultOk или ResultTimeout
+	Result GetWaitResult() const
+	{
+		return m_result;
+	}
+
+	// для макросов FIBER_*
+	void Sleep(uint32_t timeout_ms);
+	bool Wait(Semaphore & sem, uint32_t timeout_ms);
+
+	uint m_fiber_pc;
+	State m_state;
+
+private:
+	CLS_COPY(Fiber)
+
+	friend class FiberHost;
+
+	void SetDeadline(uint32_t timeout_ms);
+
+	Result m_result;
+	bool m_has_deadline;
+	tick_t m_deadline;
+	Semaphore * m_sem;
+public:
+	Fiber * m_next_fiber;
+};
+
+#define FIBER_BEGIN()              switch (m_fiber_pc) { case 0:
+#define FIBER_END()                default: ; } m_state = StateFinished
+#define FIBER_YIELD()              do { m_fiber_pc = __LINE__; return; case __LINE__:; } while (0)
+#define FIBER_SLEEP(ms)            do { Sleep(ms); m_fiber_pc = __LINE__; return; case __LINE__:; } while (0)
+#define FIBER_WAIT(sem, ms)        do { if (!Wait((sem), (ms))) { m_fiber_pc = __LINE__; return; case __LINE__:; } } while (0)
+#define FIBER_WAIT_UNTIL(cond)     do { m_fiber_pc = __LINE__; case __LINE__: if (!(cond)) { m_state = StatePolling; return; } } while (0)
+
+// Задача, по очереди продолжающая свои волокна на одном стеке. Когда продолжать некого, она спит
+// до ближайшего таймаута волокон на наборе ожидания из семафоров, которых они ждут
+// (сверх WaitSet::MAX_OBJECTS - 1 семафоров опрашиваются каждый тик) и собственного семафора Kick().
+// Набор только будит хозяина, счетчик семафора забирает само волокно при продолжении.
+class FiberHost: public Task
+{
+public:
+	explicit FiberHost(const char * name = "Fibers");
+
+	// из задач или из волокон этого хозяина; волокно живет, пока жив хозяин
+	void Add(Fiber & fiber);
+	// будит хозяина для проверки условий FIBER_WAIT_UNTIL; из задач и прерываний
+	void Kick();
+
+protected:
+	// один проход: продолжить готовые волокна, а если продолжать некого - заснуть
+	void Step();
+
+private:
+	CLS_COPY(FiberHost)
+
+	virtual void Execute();
+
+	bool Resume(Fiber & fiber, tick_t now);
+	void Block(tick_t now);
+
+private:
+	Fiber * m_fiber_list;
+	BinarySemaphore m_kick;
+	WaitSet m_wait;
+};
+
+}
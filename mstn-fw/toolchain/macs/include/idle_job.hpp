@@ -0,0 +1,65 @@
+/** @copyright AstroSoft Ltd */
+#pragma once
+
+#include "tunes.h"
+
+#if MACS_IDLE_JOBS
+
+#include "common.hpp"
+
+namespace macs
+{
+
+// Фоновая работа в простое: задача IDLE перед сном вызывает Step() запрошенных работ по кругу,
+// тратя на них не больше MACS_IDLE_JOB_BUDGET_US за тик. Любая готовая задача вытесняет IDLE
+// посреди шага. Step() - короткий шаг с состоянием в членах класса; блокирующие вызовы ядра
+// в нем запрещены, т.к. задача IDLE не должна блокироваться.
+class IdleJob
+{
+public:
+	// period_ms - самозапуск через period_ms после завершения, 0 - только по Trigger()
+	explicit IdleJob(uint32_t period_ms = 0);
+	virtual ~IdleJob()
+	{
+	}
+
+	// из задач; работа живет до конца работы системы
+	static void Add(IdleJob & job);
+
+	// запрос на выполнение; из задач и прерываний
+	void Trigger();
+
+	// только из задачи IDLE: шаги работ, возвращает, сколько тиков можно спать
+	static uint32_t Run();
+	// запрошена работа, которую Run() еще не видела
+	static inline bool IsTriggered()
+	{
+		return m_triggered;
+	}
+
+protected:
+	// true - работа не закончена, нужен еще шаг
+	virtual bool Step() = 0;
+
+private:
+	CLS_COPY(IdleJob)
+
+	bool Activate(tick_t now);
+	static uint32_t NextDue(tick_t now);
+
+	uint32_t m_period_ticks;
+	tick_t m_due;
+	volatile bool m_pending;
+	bool m_active;
+
+	static volatile bool m_triggered;
+	static tick_t m_budget_tick;
+	static ulong m_budget_used;
+	static IdleJob * m_job_list;
+public:
+	IdleJob * m_next_idle_job;
+};
+
+}
+
+#endif
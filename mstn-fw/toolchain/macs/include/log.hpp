@@ -0,0 +1,119 @@
+/** @copyright AstroSoft Ltd */
+#pragma once
+
+#include "tunes.h"
+
+#if MACS_LOG_ENABLED
+
+#include "common.hpp"
+
+namespace macs
+{
+
+// Формат должен быть литералом, аргументы %s - постоянными строками, 64-битные и float аргументы не поддерживаются
+class Logger
+{
+public:
+	enum Level
+	{
+		LevelErr = MACS_LOG_LEVEL_ERR,
+		LevelWrn = MACS_LOG_LEVEL_WRN,
+		LevelInf = MACS_LOG_LEVEL_INF,
+		LevelDbg = MACS_LOG_LEVEL_DBG
+	};
+
+	static const uint MAX_ARGS = 4;
+	static const uint32_t BUF_LEN = MACS_LOG_BUF_LEN;
+
+	struct Record
+	{
+		volatile uint32_t m_seq;
+		CSPTR m_fmt;
+		tick_t m_stamp;
+		uint8_t m_level;
+		uint8_t m_argc;
+		uint32_t m_args[MAX_ARGS];
+	};
+
+	static Result Initialize();
+
+	static void Store(Level level, CSPTR fmt, uint argc, uint32_t a0, uint32_t a1, uint32_t a2, uint32_t a3);
+
+	static inline void Put(Level level, CSPTR fmt)
+	{
+		Store(level, fmt, 0, 0, 0, 0, 0);
+	}
+	template <typename T0>
+	static inline void Put(Level level, CSPTR fmt, T0 a0)
+	{
+		Store(level, fmt, 1, (uint32_t)a0, 0, 0, 0);
+	}
+	template <typename T0, typename T1>
+	static inline void Put(Level level, CSPTR fmt, T0 a0, T1 a1)
+	{
+		Store(level, fmt, 2, (uint32_t)a0, (uint32_t)a1, 0, 0);
+	}
+	template <typename T0, typename T1, typename T2>
+	static inline void Put(Level level, CSPTR fmt, T0 a0, T1 a1, T2 a2)
+	{
+		Store(level, fmt, 3, (uint32_t)a0, (uint32_t)a1, (uint32_t)a2, 0);
+	}
+	template <typename T0, typename T1, typename T2, typename T3>
+	static inline void Put(Level level, CSPTR fmt, T0 a0, T1 a1, T2 a2, T3 a3)
+	{
+		Store(level, fmt, 4, (uint32_t)a0, (uint32_t)a1, (uint32_t)a2, (uint32_t)a3);
+	}
+
+	static size_t Drain();
+
+	static inline ulong GetDropped()
+	{
+		return m_dropped;
+	}
+
+private:
+	static bool Reserve(uint32_t & pos);
+	static void IncDropped();
+	static void Emit(const Record & rec);
+	static void EmitDropped(ulong dropped);
+
+	static Record m_buf[BUF_LEN];
+	static volatile uint32_t m_head;
+	static volatile uint32_t m_tail;
+	static volatile ulong m_dropped;
+	static ulong m_dropped_reported;
+};
+
+}
+
+#define MACS_LOG(level, ...) macs::Logger::Put(level, __VA_ARGS__)
+
+#else
+
+#define MACS_LOG(level, ...)
+
+#endif
+
+#if MACS_LOG_ENABLED && MACS_LOG_LEVEL >= MACS_LOG_LEVEL_ERR
+#define LOG_ERR(...) MACS_LOG(macs::Logger::LevelErr, __VA_ARGS__)
+#else
+#define LOG_ERR(...)
+#endif
+
+#if MACS_LOG_ENABLED && MACS_LOG_LEVEL >= MACS_LOG_LEVEL_WRN
+#define LOG_WRN(...) MACS_LOG(macs::Logger::LevelWrn, __VA_ARGS__)
+#else
+#define LOG_WRN(...)
+#endif
+
+#if MACS_LOG_ENABLED && MACS_LOG_LEVEL >= MACS_LOG_LEVEL_INF
+#define LOG_INF(...) MACS_LOG(macs::Logger::LevelInf, __VA_ARGS__)
+#else
+#define LOG_INF(...)
+#endif
+
+#if MACS_LOG_ENABLED && MACS_LOG_LEVEL >= MACS_LOG_LEVEL_DBG
+#define LOG_DBG(...) MACS_LOG(macs::Logger::LevelDbg, __VA_ARGS__)
+#else
+#define LOG_DBG(...)
+#endif
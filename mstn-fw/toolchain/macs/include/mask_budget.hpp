@@ -0,0 +1,67 @@
+/** @copyright AstroSoft Ltd */
+#pragma once
+
+#include "tunes.h"
+
+#if MACS_MASK_BUDGET_ENABLED
+
+#include "common.hpp"
+
+namespace macs
+{
+
+// учет интервалов с запретом прерываний (внешние CriticalSection) и с остановленным
+// планировщиком (внешние Sch().Pause, в т.ч. PauseSection) в тактах ядра
+class MaskBudget
+{
+public:
+	enum Kind
+	{
+		KindIrq,
+		KindPause,
+		KindCount
+	};
+
+	// корзина i - интервалы [2^i, 2^(i+1)) тактов, последняя - и все более длинные
+	static const size_t BUCKETS = 20;
+
+	struct Stat
+	{
+		ulong m_count;
+		ulong m_max_cycles;
+		const void * m_max_addr;  // адрес возврата в код, открывший самый длинный интервал
+		ulong m_hist[BUCKETS];
+	};
+
+	struct Interval
+	{
+		ulong m_start;
+		const void * m_addr;
+	};
+
+	static const Stat & Get(Kind kind)
+	{
+		return m_stat[kind];
+	}
+
+	static void Reset();
+	static void Print(String & str, bool use_ns = false);
+
+	// для CriticalSection и Scheduler::Pause
+	static void EnterIrq();
+	static void LeaveIrq();
+	static void Enter(Kind kind, const void * addr);
+	static Interval Opened(Kind kind)
+	{
+		return m_open[kind];
+	}
+	static void Leave(Kind kind, const Interval & interval);
+
+private:
+	static Stat m_stat[KindCount];
+	static Interval m_open[KindCount];
+};
+
+}
+
+#endif
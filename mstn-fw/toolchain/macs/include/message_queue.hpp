@@ -37,9 +37,18 @@ public:
 		return m_len - 1;
 	}
 
+	// запрос в эту очередь и ожидание ответа в replies: выпуск запроса и блокировка - один вызов ядра.
+	// timeout_ms - на ожидание места и ответа вместе. После таймаута ожидания ответа запрос остается
+	// отправленным, опоздавший ответ - в replies
+	template <typename R>
+	Result CallReply(const T & request, MessageQueue<R> & replies, R & reply, uint32_t timeout_ms = INFINITE_TIMEOUT);
+
 private:
 	CLS_COPY(MessageQueue)
 
+	friend class WaitSet;
+	template <typename> friend class MessageQueue;
+
 	enum ACTION
 	{
 		QA_PUSH_FRONT,
@@ -48,6 +57,7 @@ private:
 		QA_PEEK
 	};
 	Result ProcessMessage(Semaphore & wait_sem, Semaphore & sig_sem, T & message, ACTION action, uint32_t timeout_ms);
+	void Transfer(T & message, ACTION action);
 
 private:
 	const size_t m_len;
@@ -132,45 +142,90 @@ Result MessageQueue<T>::ProcessMessage(Semaphore & wait_sem, Semaphore & sig_sem
 	if (retcode != ResultOk)
 		return retcode;
 
-	{
-		PauseSection _ps_;
-		switch (action) {
-		case QA_PUSH_FRONT:
-		{
-			_ASSERT(Count() < GetMaxSize());
-			if (m_head_ptr == m_memory)
-				m_head_ptr = &m_memory[m_len];
-			*--m_head_ptr = message;
-		}
-			break;
-		case QA_PUSH_BACK:
-		{
-			_ASSERT(Count() < GetMaxSize());
-			*m_tail_ptr++ = message;
-			if (m_tail_ptr - m_memory == m_len)
-				m_tail_ptr = m_memory;
-		}
-			break;
-		case QA_POP:
-		{
-			_ASSERT(Count() != 0);
-			message = *m_head_ptr++;
-			if (m_head_ptr - m_memory == m_len)
-				m_head_ptr = m_memory;
-		}
-			break;
-		case QA_PEEK:
-		{
-			_ASSERT(Count() != 0);
-			message = *m_head_ptr;
-		}
-			break;
-		}
-	}
+	Transfer(message, action);
 
 	retcode = sig_sem.Signal();
 
 	return retcode;
 }
 
+template <typename T>
+template <typename R>
+Result MessageQueue<T>::CallReply(const T & request, MessageQueue<R> & replies, R & reply, uint32_t timeout_ms)
+{
+	if (!Sch().IsInitialized() || !Sch().IsStarted())
+		return ResultErrorInvalidState;
+
+	if (System::IsInInterrupt())
+		return ResultErrorInterruptNotSupported;
+
+	const uint32_t start = Sch().GetTickCount();
+	Result retcode = m_sem_write.Wait(timeout_ms);
+	if (retcode != ResultOk)
+		return retcode;
+
+	// ожиданию ответа остается только неизрасходованное время
+	uint32_t wait_ms = timeout_ms;
+	if (timeout_ms != INFINITE_TIMEOUT) {
+		uint32_t spent_ms = TicksToUs(Sch().GetTickCount() - start) / 1000;
+		wait_ms = spent_ms < timeout_ms ? timeout_ms - spent_ms : 0;
+	}
+
+	Transfer(const_cast<T &>(request), QA_PUSH_BACK);
+
+	retcode = Semaphore::SignalAndWait(m_sem_read, replies.m_sem_read, wait_ms);
+	if (retcode != ResultOk && retcode != ResultTimeout) {
+		// ядро отказало до сигнала: запрос уже в буфере, выпускаем его отдельно,
+		// иначе он остался бы там без m_sem_read
+		Result sig = m_sem_read.Signal();
+		if (sig != ResultOk)
+			return sig;
+		retcode = replies.m_sem_read.Wait(wait_ms);
+	}
+	if (retcode != ResultOk)
+		return retcode;
+
+	replies.Transfer(reply, MessageQueue<R>::QA_POP);
+
+	return replies.m_sem_write.Signal();
+}
+
+template <typename T>
+void MessageQueue<T>::Transfer(T & message, ACTION action)
+{
+	PauseSection _ps_;
+	switch (action) {
+	case QA_PUSH_FRONT:
+	{
+		_ASSERT(Count() < GetMaxSize());
+		if (m_head_ptr == m_memory)
+			m_head_ptr = &m_memory[m_len];
+		*--m_head_ptr = message;
+	}
+		break;
+	case QA_PUSH_BACK:
+	{
+		_ASSERT(Count() < GetMaxSize());
+		*m_tail_ptr++ = message;
+		if ((size_t)(m_tail_ptr - m_memory) == m_len)
+			m_tail_ptr = m_memory;
+	}
+		break;
+	case QA_POP:
+	{
+		_ASSERT(Count() != 0);
+		message = *m_head_ptr++;
+		if ((size_t)(m_head_ptr - m_memory) == m_len)
+			m_head_ptr = m_memory;
+	}
+		break;
+	case QA_PEEK:
+	{
+		_ASSERT(Count() != 0);
+		message = *m_head_ptr;
+	}
+		break;
+	}
+}
+
 }  
@@ -9,10 +9,37 @@ class Mutex: public SyncOwnedObject
 private:
 	uint32_t m_lock_cnt;
 	bool m_recursive;
+	Task::Priority m_ceiling;
+#if MACS_SYNC_FAST_PATH
+	// 0 - свободен, адрес задачи - захвачен без входа в ядро, STATE_KERNEL - владельца и очередь ведет ядро.
+	// Ядро берет мьютекс на учет (с наследованием приоритета) при первом конфликте
+	static const uintptr_t STATE_KERNEL = 1;
+	volatile uintptr_t m_state;
+	Mutex * volatile m_next_fast;  // в списке захватившей быстрым путем задачи
+#endif
 public:
 	Mutex(bool recursive = false) :
 			m_lock_cnt(0),
-			m_recursive(recursive)
+			m_recursive(recursive),
+			m_ceiling(Task::PriorityIdle)
+#if MACS_SYNC_FAST_PATH
+			, m_state(0)
+			, m_next_fast(nullptr)
+#endif
+	{
+	}
+
+	// мьютекс с немедленным потолком приоритета: владелец на время владения поднимается до ceiling.
+	// ceiling должен быть не ниже приоритета любой захватывающей задачи, иначе Lock вернет ResultErrorInvalidArgs.
+	// Захват всегда идет через ядро, наследование приоритета для такого мьютекса не применяется
+	explicit Mutex(Task::Priority ceiling, bool recursive = false) :
+			m_lock_cnt(0),
+			m_recursive(recursive),
+			m_ceiling(ceiling)
+#if MACS_SYNC_FAST_PATH
+			, m_state(0)
+			, m_next_fast(nullptr)
+#endif
 	{
 	}
 
@@ -23,48 +50,78 @@ public:
 		return m_recursive;
 	}
 
+	virtual Task::Priority CeilingPriority() const
+	{
+		return m_ceiling;
+	}
+
 	virtual Result Lock(uint32_t timeout_ms = INFINITE_TIMEOUT);
 	virtual Result Unlock();
+	// Unlock() и ожидание семафора или сон за один вызов ядра
+	Result UnlockAndWait(Semaphore & sem, uint32_t timeout_ms = INFINITE_TIMEOUT);
+	Result UnlockAndDelay(uint32_t timeout_ms);
 
 	bool IsLocked() const
 	{
+#if MACS_SYNC_FAST_PATH
+		return m_state != STATE_KERNEL ? m_state != 0 : !!m_owner;
+#else
 		return !!m_owner;
+#endif
 	}
 
 	static Result Lock_Priv(Mutex * pM, uint32_t timeout_ms);
 	static Result Unlock_Priv(Mutex * pM);
+	// pSem == nullptr - сон
+	static Result UnlockAndWait_Priv(Mutex * pM, Semaphore * pSem, uint32_t timeout_ms);
+#if MACS_SYNC_FAST_PATH
+	// освобождает мьютексы, которые удаляемая задача захватила быстрым путем
+	static void DropFastOwner(Task * task);
+#endif
 
 private:
 	CLS_COPY(Mutex)
 
+	friend class WaitSet;
+	friend class ConditionVariable;
+
+	Result UnlockAndBlock(Semaphore * sem, uint32_t timeout_ms);
 	virtual Result BlockCurTask(uint32_t timeout_ms);
 	virtual Result UnblockTask();
 	virtual void OnUnblockTask(Task *, Task::UnblockReason);
 	virtual void OnDeleteTask(Task *);
-#if MACS_MUTEX_PRIORITY_INVERSION
-	inline Task::Priority RemoveFromOwner()
-#else
-	inline void RemoveFromOwner()
+	Result UnlockInternal();
+	Task::Priority ReleaseOwner();
+#if MACS_SYNC_FAST_PATH
+	bool TryLockFast(Task * cur_task);
+	bool TryUnlockFast(Task * cur_task);
+	void Adopt();
+	void LinkFast(Task * task);
+	void UnlinkFast(Task * task);
+	inline void DropFast()
+	{
+		m_lock_cnt = 0;
+		m_state = 0;
+	}
 #endif
+	inline Task * GetOwner() const
 	{
-		m_owner->RemoveOwnedSync(this);
-#if MACS_MUTEX_PRIORITY_INVERSION
-		Task::Priority inh_prior = m_owner_original_priority;
-		SyncOwnedObject * pobj = m_owner->m_owned_obj_list;
-		while (pobj) {
-			if (pobj->m_blocked_task_list) {
-				Task::Priority prior = pobj->m_blocked_task_list->GetPriority();
-				if (prior > inh_prior)
-					inh_prior = prior;
-			}
-			pobj = OwnedSyncObjList::Next(pobj);
-		}
-		return inh_prior;
+#if MACS_SYNC_FAST_PATH
+		if (m_state != STATE_KERNEL)
+			return reinterpret_cast<Task *>(m_state);
+#endif
+		return m_owner;
+	}
+	void Take(Task * task);
+	void Watch();
+	void Unwatch();
+	inline void SetFree()
+	{
+		m_owner = nullptr;
+#if MACS_SYNC_FAST_PATH
+		m_state = IsWatched() ? STATE_KERNEL : 0;
 #endif
 	}
-
-	Result UnlockInternal();
-	void UpdateOwnerPriority();
 };
 
 class MutexGuard
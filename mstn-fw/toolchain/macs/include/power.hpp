@@ -0,0 +1,71 @@
+/** @copyright AstroSoft Ltd */
+#pragma once
+
+#include "tunes.h"
+
+#if MACS_POWER_MANAGEMENT
+
+#include "common.hpp"
+#include "system.hpp"
+
+namespace macs
+{
+
+// Задача IDLE усыпляет процессор до ближайшего пробуждения задачи по таймауту, не прерываясь на тики.
+// Останов (остановка высокочастотных тактов) выбирается, когда сон достаточно долгий,
+// все заданные источники пробуждения работают в останове и его никто не запретил.
+// Время останова отсчитывается от низкочастотного генератора, и системное время отстает или уходит вперед.
+// На 1986ВЕ92 это LSI, его частота измеряется по HSE один раз в System::InitCpu. Погрешность измерения
+// меньше 0,1%, но дрейф LSI с температурой и питанием после старта не отслеживается и входит в ошибку
+// целиком. Без HSE или при занятом приложением RTC остается номинал LSI_Value, и ошибка равна разбросу
+// LSI по партии, до десятков процентов. К каждому останову добавляется до такта LSI (25 мкс) и время
+// запуска HSE и PLL после пробуждения, которое не отсчитывается.
+class Power
+{
+public:
+	enum State
+	{
+		StateRun,
+		StateSleep,
+		StateStop,
+		STATE_COUNT
+	};
+
+	struct Stats
+	{
+		uint64_t m_time_us[STATE_COUNT];
+		ulong m_entries[STATE_COUNT];
+	};
+
+	// System::WakeGpio | System::WakeUart | System::WakeTimer
+	static void SetWakeSources(uint sources);
+	static inline uint GetWakeSources()
+	{
+		return m_wake_sources;
+	}
+
+	// запрет останова, пока периферия работает от высокочастотных тактов; из задач и прерываний
+	static void Inhibit();
+	static void Allow();
+
+	static void SetMinStopMs(uint32_t ms);
+	static void GetStats(Stats & stats);
+
+	// только из задачи IDLE; max_ticks - предел сна, например до фоновых работ
+	static void Idle(uint32_t max_ticks = UINT32_MAX);
+
+private:
+	static uint32_t Sleep(uint32_t idle_ticks);
+	static uint32_t Stop(uint32_t idle_ticks);
+	static void Account(State state, uint32_t us);
+
+	static volatile uint m_wake_sources;
+	static volatile uint32_t m_inhibit_cnt;
+	static uint32_t m_min_stop_ms;
+	static uint64_t m_time_us[STATE_COUNT];
+	static ulong m_entries[STATE_COUNT];
+};
+
+}
+
+#endif
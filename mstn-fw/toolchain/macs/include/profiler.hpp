@@ -59,6 +59,9 @@ typedef enum
 
 	PE_DELAY_10MS,
 
+	PE_LOG_PUT,
+	PE_LOG_DRAIN,
+
 	PE_USER_1,
 	PE_USER_2,
 	PE_USER_3,
@@ -0,0 +1,144 @@
+/** @copyright AstroSoft Ltd */
+#pragma once
+
+#include "scheduler.hpp"
+
+namespace macs
+{
+
+// захват на чтение одной задачей: строка таблицы читателей блокировки, связанная в список задачи
+struct ReadHold
+{
+	RwLock * m_lock;
+	Task * m_task;  // nullptr - строка свободна
+	uint m_count;  // повторные захваты той же задачей
+	ReadHold * m_next_hold;
+};
+SLIST_DECLARE(ReadHoldList, ReadHold, m_next_hold);
+
+// Блокировка читателей-писателя: читатели входят одновременно, писатель - один.
+// Ожидающий писатель закрывает вход новым читателям. Писатель-владелец наследует приоритет
+// ожидающих (и читателей, и писателей), читатели не наследуют. Читатели учитываются по задачам
+// (не больше MACS_RWLOCK_MAX_READERS одновременно), читатель может повторить захват на чтение;
+// рекурсивный захват на запись и захват на запись читателем не поддерживаются.
+class RwLock: public SyncOwnedObject
+{
+public:
+	RwLock();
+	~RwLock();
+
+	Result LockRead(uint32_t timeout_ms = INFINITE_TIMEOUT);
+	Result UnlockRead();
+	Result LockWrite(uint32_t timeout_ms = INFINITE_TIMEOUT);
+	Result UnlockWrite();
+
+	// число задач-читателей
+	size_t GetReaders() const
+	{
+		return m_readers;
+	}
+
+	bool IsWriteLocked() const
+	{
+		return !!m_owner;
+	}
+
+	virtual Task * TopWaiter() const;
+
+	static Result Lock_Priv(RwLock * pL, uint32_t timeout_ms, bool write);
+	static Result Unlock_Priv(RwLock * pL, bool write);
+
+	// снимает захваты на чтение удаляемой задачи
+	static void DropReader(Task * task);
+
+private:
+	CLS_COPY(RwLock)
+
+	// очередь ожидающих читателей; писатели ждут в очереди самого объекта
+	class ReaderQueue: public SyncObject
+	{
+	public:
+		explicit ReaderQueue(RwLock & lock) :
+				m_lock(lock)
+		{
+		}
+		void Drop()
+		{
+			DropLinks();
+		}
+		virtual void OnUnblockTask(Task *, Task::UnblockReason);
+		virtual void OnDeleteTask(Task *);
+		virtual SyncOwnedObject * Inheritor()
+		{
+			return &m_lock;
+		}
+	private:
+		CLS_COPY(ReaderQueue)
+
+		RwLock & m_lock;
+	};
+
+	Result Lock(uint32_t timeout_ms, bool write);
+	Result Unlock(bool write);
+
+	ReadHold * FindHold(Task * task);
+	void TakeRead(Task * task);
+	void ReleaseRead(ReadHold * hold);
+	void TakeWrite(Task * task);
+	void ReleaseWrite();
+	void GrantWriter();
+	void WakeReaders();
+	void OnWaiterGone();
+
+	virtual void OnUnblockTask(Task *, Task::UnblockReason);
+	virtual void OnDeleteTask(Task *);
+
+private:
+	ReaderQueue m_reader_queue;
+	size_t m_readers;
+	ReadHold m_holds[MACS_RWLOCK_MAX_READERS];
+};
+
+class ReadGuard
+{
+public:
+	explicit ReadGuard(RwLock & lock) :
+			m_lock(lock)
+	{
+		m_lock.LockRead();
+	}
+
+	~ReadGuard()
+	{
+		m_lock.UnlockRead();
+	}
+
+private:
+	CLS_COPY(ReadGuard)
+
+private:
+	RwLock & m_lock;
+};
+
+class WriteGuard
+{
+public:
+	explicit WriteGuard(RwLock & lock) :
+			m_lock(lock)
+	{
+		m_lock.LockWrite();
+	}
+
+	~WriteGuard()
+	{
+		m_lock.UnlockWrite();
+	}
+
+private:
+	CLS_COPY(WriteGuard)
+
+private:
+	RwLock & m_lock;
+};
+
+}
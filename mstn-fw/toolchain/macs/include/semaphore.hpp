@@ -14,7 +14,7 @@ public:
 	 
 	size_t GetCurrentCount() const
 	{
-		return m_count;
+		return m_count & ~WAITERS_FLAG;
 	}
 	 
 	size_t GetMaxCount() const
@@ -24,19 +24,41 @@ public:
 
 	Result Wait(uint32_t timeout_ms = INFINITE_TIMEOUT);
 	Result Signal();
+	// Signal() для signal и Wait() для wait за один вызов ядра: ответ не обгонит блокировку.
+	// Ошибка, кроме ResultTimeout, означает, что сигнал не подан
+	static Result SignalAndWait(Semaphore & signal, Semaphore & wait, uint32_t timeout_ms = INFINITE_TIMEOUT);
 	static Result Wait_Priv(Semaphore * pS, uint32_t timeout_ms);  
 	static Result Signal_Priv(Semaphore * pS);  
+	static Result SignalAndWait_Priv(Semaphore * pSig, Semaphore * pWait, uint32_t timeout_ms);
 
 private:
 	CLS_COPY(Semaphore)
 
+	friend class WaitSet;
+
+	// флаг ожидающих задач (и наборов ожидания) в слове счетчика: при нем быстрый путь уступает ядру
+	static const size_t WAITERS_FLAG = 1u << 31;
+
 	bool TryDecrement()
 	{
-		return m_count ? (--m_count, true) : false;
+		return GetCurrentCount() ? (--m_count, true) : false;
 	}
 
+	inline void UpdateWaitersFlag()
+	{
+		m_count = GetCurrentCount() | (IsHolding() || IsWatched() ? WAITERS_FLAG : 0);
+	}
+
+#if MACS_SYNC_FAST_PATH
+	bool TryWaitFast();
+	bool TrySignalFast();
+#endif
+
+	virtual void OnUnblockTask(Task *, Task::UnblockReason);
+	virtual void OnDeleteTask(Task *);
+
 private:
-	size_t m_count;
+	volatile size_t m_count;
 	size_t m_max_count;
 };
 
@@ -16,6 +16,11 @@ class SyncOwnedObject;
 class Event;
 class Mutex;
 class Semaphore;
+class RwLock;
+class ConditionVariable;
+class WaitSet;
+class WaitEntry;
+struct ReadHold;
  
 class Task
 {
@@ -56,14 +61,32 @@ public:
 		UnblockReasonIrq
 	};
 
+	// действие над словом уведомления задачи
+	enum NotifyAction
+	{
+		NotifySetBits,       // value |= bits
+		NotifyIncrement,     // ++value, bits не используются
+		NotifyOverwrite,     // value = bits
+		NotifyNoOverwrite    // value = bits, если прежнее уже забрано, иначе ResultErrorInvalidState
+	};
+
 	 
 	class UnblockFunctor
 	{
 	public:
 		virtual void OnUnblockTask(Task * task, Task::UnblockReason reason) = 0;
-		virtual void OnDeleteTask(Task * task)
+		virtual void OnDeleteTask(Task *)
+		{
+		}
+		// изменился приоритет блокированной задачи
+		virtual void OnChangePriority(Task *)
 		{
 		}
+		// объект, владелец которого наследует приоритет ожидающих здесь задач
+		virtual SyncOwnedObject * Inheritor()
+		{
+			return nullptr;
+		}
 	};
 public:
 	 
@@ -122,10 +145,48 @@ public:
 	{
 		return m_priority;
 	}
+	// приоритет без подъема потолками и наследованием
+	Priority GetBasePriority() const;
+
+	// тиков системного таймера, на которых задача была текущей
+	uint32_t GetRunTicks() const
+	{
+		return m_run_ticks;
+	}
+
+	UnblockReason GetUnblockReason() const
+	{
+		return m_unblock_reason;
+	}
 
 	Result SetPriority(Priority value);
 	static Task * GetCurrent();
 	static void Yield();
+
+	// уведомление задачи без объекта синхронизации; из задач и прерываний
+	static Result Notify(Task * task, uint32_t bits, NotifyAction action = NotifySetBits);
+	// забирает слово уведомления (в value - до очистки) и сбрасывает в нем clear_mask
+	static Result WaitNotify(uint32_t clear_mask, uint32_t timeout_ms = INFINITE_TIMEOUT, uint32_t * value = nullptr);
+	static Result Notify_Priv(Task * task, uint32_t bits, NotifyAction action);
+	static Result WaitNotify_Priv(uint32_t clear_mask, uint32_t timeout_ms);
+
+#if MACS_EDF_ENABLED
+	// текущая задача становится периодической: на приоритете MACS_EDF_PRIORITY готовые периодические задачи
+	// идут по возрастанию абсолютного срока (EDF). deadline_ms == 0 - срок равен периоду, period_ms == 0 - снять
+	static Result SetPeriod(uint32_t period_ms, uint32_t deadline_ms = 0);
+	// конец работы периода: учет пропуска срока и сон до следующего выпуска
+	static Result WaitNextPeriod();
+
+	tick_t GetDeadline() const
+	{
+		return m_deadline;
+	}
+
+	uint32_t GetDeadlineMisses() const
+	{
+		return m_deadline_misses;
+	}
+#endif
 	 
 	inline size_t GetStackLen() const
 	{
@@ -137,6 +198,16 @@ public:
 		return m_stack.GetUsage();
 	}
 	 
+	// границы размеченной области стека: пик считается по копии, вне паузы (Scheduler::ScanStacks)
+	inline StackPtr GetStackMargin() const
+	{
+		return m_stack.GetMargin();
+	}
+	inline StackPtr GetStackTop() const
+	{
+		return m_stack.m_top;
+	}
+	 
 	void InstrumentStack()
 	{
 		m_stack.Instrument();
@@ -177,9 +248,9 @@ public:
 	}
 
 private:
-	inline uint32_t GetExecuteAddress()
+	inline uintptr_t GetExecuteAddress()
 	{
-		return (uint32_t) & Task::Execute_;
+		return (uintptr_t) & Task::Execute_;
 	}
 
 	void SetBlockSync(SyncObject *);  
@@ -187,14 +258,25 @@ private:
 	void DropBlockSync(SyncObject *);  
 	void RemoveOwnedSync(SyncOwnedObject *);  
 	void DetachFromSync();  
+	inline void TakeNotify(uint32_t clear_mask)
+	{
+		m_notify_taken = m_notify_value;
+		m_notify_value &= ~clear_mask;
+		m_notify_pending = false;
+	}
 
 	friend class Scheduler;
 	friend class SyncObject;
+	friend class SyncOwnedObject;
 	friend class Mutex;
 	friend class Semaphore;
 	friend class Event;
+	friend class RwLock;
+	friend class ConditionVariable;
+	friend class WaitSet;
 	friend class TaskRoom;
 	friend class TaskSleepRoom;
+	friend class TaskWorkRoom;
 	friend class TaskIrqRoom;
 	friend Result DeleteTask_Priv(Scheduler * pS, Task * task, bool del_mem);
 	friend Result BlockCurrentTask_Priv(Scheduler * pS, uint32_t timeout_ms, Task::UnblockFunctor *);
@@ -224,19 +306,57 @@ private:
 	Mode m_mode;
 
 	uint32_t m_dream_ticks;  
+	uint32_t m_run_ticks;  
 public:
 	Task * m_next_sched_task;  
+	Task ** m_prev_sched_task;  
 	Task * m_next_sync_task;  
+	Task ** m_prev_sync_task;  
 private:
 	UnblockFunctor * m_unblock_func;  
 	SyncOwnedObject * m_owned_obj_list;  
+	ReadHold * m_read_hold_list;  // захваты RwLock на чтение
+#if MACS_SYNC_FAST_PATH
+	// мьютексы, захваченные быстрым путем, и мьютекс в середине захвата или освобождения:
+	// список меняет сама задача, ядро читает его при удалении задачи
+	Mutex * volatile m_fast_mutex_list;
+	Mutex * volatile m_fast_pending;
+#endif
 
 	 
 	UnblockReason m_unblock_reason;
+
+	uint32_t m_notify_value;
+	uint32_t m_notify_clear;  
+	uint32_t m_notify_taken;  
+	bool m_notify_pending;
+	bool m_notify_waiting;  
+
+#if MACS_EDF_ENABLED
+	uint32_t m_period_ticks;  
+	uint32_t m_deadline_ticks;  
+	tick_t m_release;  
+	tick_t m_deadline;  
+	uint32_t m_deadline_misses;
+#endif
+
+#if MACS_SYNC_STATS
+	SyncObject * m_stat_obj;  
+	ulong m_block_start;  
+#endif
 };
 
 inline bool PriorPreceeding(Task * a, Task * b)
 {
+#if MACS_EDF_ENABLED
+	// в полосе EDF периодические задачи упорядочены по сроку и идут раньше непериодических;
+	// сроки держит тот же упорядоченный список готовых задач: до ~16 задач в полосе он не медленнее кучи (test/edf_test.cpp)
+	if (a->m_priority == b->m_priority && a->m_priority == MACS_EDF_PRIORITY) {
+		if (a->m_period_ticks && b->m_period_ticks)
+			return (int32_t)(a->m_deadline - b->m_deadline) < 0;
+		return a->m_period_ticks && !b->m_period_ticks;
+	}
+#endif
 	return a->m_priority > b->m_priority;
 }
 inline bool WakeupPreceeding(Task * a, Task * b)
@@ -244,10 +364,10 @@ inline bool WakeupPreceeding(Task * a, Task * b)
 	return a->m_dream_ticks <= b->m_dream_ticks;
 }
 
-SLISTORD_DECLARE(TaskSyncList, Task, m_next_sync_task, PriorPreceeding);
-SLIST_DECLARE(TaskRoomList, Task, m_next_sched_task);
-SLISTORD_DECLARE(TaskWorkList, Task, m_next_sched_task, PriorPreceeding);
-SLISTORD_DECLARE(TaskSleepList, Task, m_next_sched_task, WakeupPreceeding);
+DLISTORD_DECLARE(TaskSyncList, Task, m_next_sync_task, m_prev_sync_task, PriorPreceeding);
+DLIST_DECLARE(TaskRoomList, Task, m_next_sched_task, m_prev_sched_task);
+DLISTORD_DECLARE(TaskWorkList, Task, m_next_sched_task, m_prev_sched_task, PriorPreceeding);
+DLISTORD_DECLARE(TaskSleepList, Task, m_next_sched_task, m_prev_sched_task, WakeupPreceeding);
 
 inline Task::Priority operator +(const Task::Priority prior, const int chg)
 {
@@ -343,24 +463,107 @@ class SyncObject: public Task::UnblockFunctor
 {
 public:
 	Task * m_blocked_task_list;
+	WaitEntry * m_watch_list;  
+#if MACS_SYNC_STATS
+	// счетчики конкуренции за объект, такты - такты ядра
+	struct Stats
+	{
+		ulong m_acquires;           // успешные захваты, сразу и после ожидания
+		ulong m_contended;          // ожидания в очереди объекта
+		ulong m_timeouts;
+		ulong m_max_queue;          // наибольшая длина очереди
+		uint64_t m_blocked_cycles;  // суммарное время ожидания
+		ulong m_max_blocked_cycles;
+		ulong m_boosts;             // подъемы приоритета владельца наследованием
+	};
+
+	SyncObject * m_next_stat_obj;  
+	SyncObject ** m_prev_stat_obj;  
+#endif
 public:
 	SyncObject()
 	{
 		m_blocked_task_list = nullptr;
+		m_watch_list = nullptr;
+#if MACS_SYNC_STATS
+		m_name = nullptr;
+		ResetStats();
+		LinkStat(true);
+#endif
+	}
+#if MACS_SYNC_STATS
+	~SyncObject();
+
+	// имя для отчетов, строка не копируется
+	void SetName(const char * name)
+	{
+		m_name = name;
+	}
+	const char * GetName() const
+	{
+		return m_name;
+	}
+	const Stats & GetStats() const
+	{
+		return m_stats;
+	}
+	void ResetStats();
+
+	// реестр всех объектов; обходить под паузой планировщика
+	static SyncObject * FirstStat()
+	{
+		return m_stat_list;
 	}
+	SyncObject * NextStat() const
+	{
+		return m_next_stat_obj;
+	}
+
+	// захват без ожидания, в т.ч. на быстром пути вне ядра
+	void CountAcquire()
+	{
+		ExclIncCnt(m_stats.m_acquires);
+	}
+	// задача встала в очередь объекта; из ядра
+	void CountBlock(Task * task);
+	// пробуждение задачи, ждавшей объект; из ядра
+	void CountWake(Task * task, Task::UnblockReason reason);
+
+	static Result LinkStat_Priv(SyncObject * obj, bool link);
+#endif
 
 	inline bool IsHolding() const
 	{
 		return !!m_blocked_task_list;
 	}
 
+	inline bool IsWatched() const
+	{
+		return !!m_watch_list;
+	}
+
 	virtual Result BlockCurTask(uint32_t timeout_ms);
 	virtual Result UnblockTask();
 	virtual void OnUnblockTask(Task *, Task::UnblockReason);
 	virtual void OnDeleteTask(Task *);
+	virtual void OnChangePriority(Task *);
 
 protected:
 	void DropLinks();
+	// объект стал доступен: его проверяют ожидающие наборы, single - достаточно одного сработавшего
+	bool NotifyWatchers(bool single = false);
+
+#if MACS_SYNC_STATS
+private:
+	// объекты создаются и непривилегированными задачами - реестр меняется через SVC
+	void LinkStat(bool link);
+
+	const char * m_name;
+	Stats m_stats;
+	static SyncObject * m_stat_list;
+
+	friend class SyncOwnedObject;
+#endif
 };
 
 class SyncOwnedObject: public SyncObject
@@ -375,6 +578,37 @@ public:
 		m_owner = nullptr;
 		m_next_owned_obj = nullptr;
 	}
+
+	// самая приоритетная из ожидающих задач
+	virtual Task * TopWaiter() const
+	{
+		return m_blocked_task_list;
+	}
+
+	// приоритет, до которого поднимается владелец на время владения; PriorityIdle - без потолка
+	virtual Task::Priority CeilingPriority() const
+	{
+		return Task::PriorityIdle;
+	}
+
+	virtual SyncOwnedObject * Inheritor()
+	{
+		return this;
+	}
+
+	// пересчитывает приоритет владельца и передает изменение дальше по цепочке:
+	// владелец, сам ждущий объект, поднимает или опускает его владельца, не глубже MACS_PRIORITY_INHERITANCE_DEPTH
+	void UpdateOwnerPriority();
+
+protected:
+	// исходный приоритет владельца, поднятый потолками и ожидающими всех его объектов
+	Task::Priority InheritedPriority() const;
+#if MACS_MUTEX_PRIORITY_INVERSION
+	// снимает объект с владельца и возвращает приоритет, положенный владельцу без него
+	Task::Priority RemoveFromOwner();
+#else
+	void RemoveFromOwner();
+#endif
 };
 SLIST_DECLARE(OwnedSyncObjList, SyncOwnedObject, m_next_owned_obj);
 
@@ -0,0 +1,94 @@
+/** @copyright AstroSoft Ltd */
+#pragma once
+
+#include "scheduler.hpp"
+#include "semaphore.hpp"
+#include "mutex.hpp"
+#include "event.hpp"
+#include "message_queue.hpp"
+
+namespace macs
+{
+
+// Элемент набора: на время ожидания включается в список наблюдателей своего объекта
+class WaitEntry
+{
+public:
+	enum Kind
+	{
+		KindSemaphore,  // счетчик забирается
+		KindMutex,      // мьютекс захватывается ожидающей задачей
+		KindEvent,      // событие, поднятое во время ожидания
+		KindQueue       // в очереди есть сообщение (семафор не пуст), извлекает его сама задача
+	};
+
+	SyncObject * m_obj;
+	WaitSet * m_set;
+	Kind m_kind;
+	bool m_fired;
+	WaitEntry * m_next_watch;
+	WaitEntry ** m_prev_watch;
+};
+DLIST_DECLARE(WaitEntryList, WaitEntry, m_next_watch, m_prev_watch);
+
+// Ожидание одним вызовом любого или всех объектов набора с общим таймаутом.
+// Набор собирается заранее, ждать на нем может одна задача за раз, объекты должны пережить ожидание.
+class WaitSet: public SyncObject
+{
+public:
+	static const size_t MAX_OBJECTS = MACS_WAIT_SET_SIZE;
+
+	WaitSet();
+	~WaitSet();
+
+	Result Add(Semaphore & sem);
+	Result Add(Mutex & mutex);
+	Result Add(Event & event);
+	template <typename T>
+	Result Add(MessageQueue<T> & queue)
+	{
+		return Add(queue.m_sem_read, WaitEntry::KindQueue);
+	}
+	// семафор только будит ожидающего, счетчик он забирает сам
+	Result Watch(Semaphore & sem)
+	{
+		return Add(sem, WaitEntry::KindQueue);
+	}
+	Result Clear();
+
+	size_t Count() const
+	{
+		return m_count;
+	}
+
+	// index - номер сработавшего объекта в порядке добавления
+	Result WaitAny(size_t & index, uint32_t timeout_ms = INFINITE_TIMEOUT);
+	Result WaitAll(uint32_t timeout_ms = INFINITE_TIMEOUT);
+	static Result Wait_Priv(WaitSet * pW, uint32_t timeout_ms, bool all);
+
+private:
+	CLS_COPY(WaitSet)
+
+	friend class SyncObject;
+
+	Result Add(SyncObject & obj, WaitEntry::Kind kind);
+	Result Wait(uint32_t timeout_ms, bool all);
+
+	bool IsReady(const WaitEntry & entry, Task * task) const;
+	void Acquire(WaitEntry & entry, Task * task);
+	bool TryComplete(Task * task);
+	void Arm();
+	void Disarm();
+	bool Notify(WaitEntry * entry);
+
+	virtual void OnUnblockTask(Task *, Task::UnblockReason);
+	virtual void OnDeleteTask(Task *);
+
+private:
+	WaitEntry m_entries[MAX_OBJECTS];
+	size_t m_count;
+	size_t m_fired;
+	bool m_all;
+};
+
+}
@@ -8,12 +8,38 @@
 #include "memory_manager.hpp"
 #include "scheduler.hpp"
 #include "mutex.hpp"
+#include "atomic.hpp"
 
 uint32_t SystemBase::m_tick_rate_hz = MACS_INIT_TICK_RATE_HZ;
  
 namespace macs
 {
 
+uint8_t ExclSet(uint8_t & flag)
+{
+	return AtomicExchange(flag, 1);
+}
+
+uint8_t ExclIncCnt(uint8_t & cnt)
+{
+	return AtomicFetchAdd(cnt, 1) + 1;
+}
+
+ulong ExclIncCnt(ulong & cnt)
+{
+	return AtomicFetchAdd(cnt, 1) + 1;
+}
+
+long ExclChg(long & val, long chg)
+{
+	return AtomicFetchAdd(val, chg) + chg;
+}
+
+void * ExclSetPtr(void * & ptr, void * new_val)
+{
+	return AtomicExchange(ptr, new_val);
+}
+
 #if MACS_DEBUG
 void _Assert(bool e)
 {
@@ -30,6 +30,18 @@ enum EPrivilegedMethods
 	EPM_Mutex_Unlock_Priv,
 	EPM_Semaphore_Wait_Priv,
 	EPM_Semaphore_Signal_Priv,
+	EPM_SetCpuFreq_Priv,
+	EPM_WaitSet_Wait_Priv,
+	EPM_RwLock_Lock_Priv,
+	EPM_RwLock_Unlock_Priv,
+	EPM_ConditionVariable_Wait_Priv,
+	EPM_ConditionVariable_Notify_Priv,
+	EPM_Task_Notify_Priv,
+	EPM_Task_WaitNotify_Priv,
+	EPM_Semaphore_SignalAndWait_Priv,
+	EPM_Mutex_UnlockAndWait_Priv,
+	EPM_GetTasksInfo_Priv,
+	EPM_SyncObject_LinkStat_Priv,
 	EPM_SpiTransferCore_Initialize_Priv,
 	EPM_Spi_PowerControl_Priv,
 	EPM_Count  
@@ -82,6 +94,7 @@ typedef enum
 	AA_CRASH  
 } ALARM_ACTION;
 
+// обертки над atomic.hpp: ExclSet и ExclSetPtr возвращают прежнее значение, ExclIncCnt и ExclChg - новое
 extern uint8_t ExclSet(uint8_t & flag);  
 extern uint8_t ExclIncCnt(uint8_t & cnt);  
 extern ulong ExclIncCnt(ulong & cnt);  
@@ -313,8 +326,9 @@ public:
 		if (str) {
 			if (len == -1)
 				len = strlen(str);
-			else
-				_ASSERT(len >= 0 && len <= strlen(str));
+			else {
+				_ASSERT(len >= 0 && (size_t)len <= strlen(str));
+			}
 			Add(str, len);
 		}
 	}
@@ -0,0 +1,160 @@
+/** @copyright AstroSoft Ltd */
+
+#include "fiber.hpp"
+
+namespace macs
+{
+
+SLIST_DECLARE(FiberList, Fiber, m_next_fiber);
+
+Fiber::Fiber() :
+		m_fiber_pc(0),
+		m_state(StateReady),
+		m_result(ResultOk),
+		m_has_deadline(false),
+		m_deadline(0),
+		m_sem(nullptr),
+		m_next_fiber(nullptr)
+{
+}
+
+void Fiber::SetDeadline(uint32_t timeout_ms)
+{
+	m_has_deadline = timeout_ms != INFINITE_TIMEOUT;
+	if (m_has_deadline)
+		m_deadline = Sch().GetTickCount() + MsToTicks(timeout_ms);
+}
+
+void Fiber::Sleep(uint32_t timeout_ms)
+{
+	m_state = StateSleeping;
+	SetDeadline(timeout_ms);
+}
+
+// true - результат готов сразу, ждать не нужно
+bool Fiber::Wait(Semaphore & sem, uint32_t timeout_ms)
+{
+	if (sem.Wait(0) == ResultOk) {
+		m_result = ResultOk;
+		return true;
+	}
+	if (timeout_ms == 0) {
+		m_result = ResultTimeout;
+		return true;
+	}
+
+	m_state = StateWaiting;
+	m_sem = &sem;
+	SetDeadline(timeout_ms);
+	return false;
+}
+
+static inline bool IsDue(bool has_deadline, tick_t deadline, tick_t now)
+{
+	return has_deadline && (int32_t)(deadline - now) <= 0;
+}
+
+FiberHost::FiberHost(const char * name) :
+		Task(name),
+		m_fiber_list(nullptr)
+{
+}
+
+void FiberHost::Add(Fiber & fiber)
+{
+	{
+		PauseSection _ps_;
+		FiberList::Add(m_fiber_list, &fiber);
+	}
+	Kick();
+}
+
+void FiberHost::Kick()
+{
+	m_kick.Signal();
+}
+
+// true - волокно отработало и снова готово
+bool FiberHost::Resume(Fiber & fiber, tick_t now)
+{
+	switch (fiber.m_state) {
+	case Fiber::StateSleeping:
+		if (!IsDue(fiber.m_has_deadline, fiber.m_deadline, now))
+			return false;
+		break;
+	case Fiber::StateWaiting:
+		if (fiber.m_sem->Wait(0) == ResultOk)
+			fiber.m_result = ResultOk;
+		else if (IsDue(fiber.m_has_deadline, fiber.m_deadline, now))
+			fiber.m_result = ResultTimeout;
+		else
+			return false;
+		break;
+	case Fiber::StateFinished:
+		return false;
+	default:
+		break;
+	}
+
+	fiber.m_state = Fiber::StateReady;
+	fiber.Run();
+	return fiber.m_state == Fiber::StateReady;
+}
+
+// сон до ближайшего таймаута, семафора ждущего волокна или Kick()
+void FiberHost::Block(tick_t now)
+{
+	uint32_t timeout_ticks = UINT32_MAX;
+	bool overflow = false;
+
+	m_wait.Clear();
+	m_wait.Add(m_kick);
+
+	for (Fiber * fiber = m_fiber_list; fiber; fiber = FiberList::Next(fiber)) {
+		if (fiber->m_state != Fiber::StateSleeping && fiber->m_state != Fiber::StateWaiting)
+			continue;
+
+		if (fiber->m_has_deadline) {
+			int32_t left = fiber->m_deadline - now;
+			timeout_ticks = MIN(timeout_ticks, (uint32_t)MAX(left, 0));
+		}
+
+		// семафор, которого ждут несколько волокон, в наборе один раз
+		if (fiber->m_state == Fiber::StateWaiting) {
+			if (m_wait.Count() == WaitSet::MAX_OBJECTS)
+				overflow = true;
+			else
+				m_wait.Watch(*fiber->m_sem);
+		}
+	}
+
+	// не поместившиеся в набор семафоры опрашиваются каждый тик
+	if (overflow)
+		timeout_ticks = MIN(timeout_ticks, 1u);
+
+	uint32_t timeout_ms = timeout_ticks == UINT32_MAX ? INFINITE_TIMEOUT : (TicksToUs(timeout_ticks) + 999) / 1000;
+	size_t index;
+	m_wait.WaitAny(index, timeout_ms);
+}
+
+void FiberHost::Step()
+{
+	bool ready = false;
+	tick_t now = Sch().GetTickCount();
+	for (Fiber * fiber = m_fiber_list; fiber; fiber = FiberList::Next(fiber))
+		if (Resume(*fiber, now))
+			ready = true;
+
+	if (ready)
+		Yield();
+	else
+		Block(Sch().GetTickCount());
+}
+
+void FiberHost::Execute()
+{
+	for (;;)
+		Step();
+}
+
+}
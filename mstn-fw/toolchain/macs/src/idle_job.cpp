@@ -0,0 +1,112 @@
+/** @copyright AstroSoft Ltd */
+
+#include "tunes.h"
+
+#if MACS_IDLE_JOBS
+
+#include "scheduler.hpp"
+#include "idle_job.hpp"
+
+namespace macs
+{
+
+SLIST_DECLARE(IdleJobList, IdleJob, m_next_idle_job);
+
+volatile bool IdleJob::m_triggered = false;
+tick_t IdleJob::m_budget_tick = 0;
+ulong IdleJob::m_budget_used = 0;
+IdleJob * IdleJob::m_job_list = nullptr;
+
+IdleJob::IdleJob(uint32_t period_ms) :
+		m_period_ticks(MsToTicks(period_ms)),
+		m_due(0),
+		m_pending(false),
+		m_active(false),
+		m_next_idle_job(nullptr)
+{
+}
+
+void IdleJob::Add(IdleJob & job)
+{
+	PauseSection _ps_;
+	job.m_due = Sch().GetTickCount() + job.m_period_ticks;
+	IdleJobList::Add(m_job_list, &job);
+}
+
+void IdleJob::Trigger()
+{
+	m_pending = true;
+	m_triggered = true;
+}
+
+// запрос, пришедший во время шага, не теряется: работа и так уже идет
+bool IdleJob::Activate(tick_t now)
+{
+	if (m_active)
+		return true;
+
+	if (m_pending)
+		m_pending = false;
+	else if (!m_period_ticks || (int32_t)(now - m_due) < 0)
+		return false;
+
+	m_active = true;
+	return true;
+}
+
+uint32_t IdleJob::NextDue(tick_t now)
+{
+	uint32_t ticks = UINT32_MAX;
+	for (IdleJob * job = m_job_list; job; job = IdleJobList::Next(job))
+		if (job->m_period_ticks) {
+			int32_t left = job->m_due - now;
+			ticks = MIN(ticks, (uint32_t)MAX(left, 0));
+		}
+	return ticks;
+}
+
+uint32_t IdleJob::Run()
+{
+	tick_t now = Sch().GetTickCount();
+	if (now != m_budget_tick) {
+		m_budget_tick = now;
+		m_budget_used = 0;
+	}
+	const ulong budget = MACS_IDLE_JOB_BUDGET_US * (System::GetCpuFreq() / 1000000);
+
+	m_triggered = false;
+
+	bool active;
+	do {
+		active = false;
+		for (IdleJob * job = m_job_list; job; job = IdleJobList::Next(job)) {
+			if (!job->Activate(now))
+				continue;
+
+			// бюджет тика исчерпан - спим до следующего
+			if (m_budget_used >= budget)
+				return 1;
+
+			ulong start = System::GetCurCpuTick();
+			bool more = job->Step();
+			m_budget_used += System::GetCurCpuTick() - start;
+
+			if (more) {
+				active = true;
+			} else {
+				job->m_active = false;
+				job->m_due = Sch().GetTickCount() + job->m_period_ticks;
+			}
+		}
+
+		// новый тик - новый бюджет
+		if (Sch().GetTickCount() != now)
+			return 0;
+	} while (active);
+
+	return NextDue(now);
+}
+
+}
+
+#endif
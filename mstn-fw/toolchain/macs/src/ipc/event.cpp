@@ -30,13 +30,18 @@ Result Event::Raise_Priv(Event * pE)
 {
 	CriticalSection _cs_;
 
+	bool woken = false;
 	while (pE->IsHolding()) {
 		pE->UnblockTask();
+		woken = true;
 
 		if (!pE->m_broadcast)
 			break;
 	}
 
+	if (pE->IsWatched() && (pE->m_broadcast || !woken))
+		pE->NotifyWatchers(!pE->m_broadcast);
+
 	return ResultOk;
 }
 
@@ -0,0 +1,266 @@
+/** @copyright AstroSoft Ltd */
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include "system.hpp"
+
+namespace macs
+{
+
+// Атомарные операции над выровненными переменными до 32 бит (целые, указатели) для кода ядра и прерываний.
+// На M3/M4 - LDREX/STREX: переключение контекста и вход в прерывание сбрасывают монитор, и попытка повторяется.
+// На M1 - короткая секция с запретом прерываний (PRIMASK), поэтому там только привилегированный код.
+enum MemoryOrder
+{
+	OrderRelaxed,
+	OrderAcquire,
+	OrderRelease,
+	OrderSeqCst
+};
+
+namespace atomic_impl
+{
+
+// тип аргумента выводится только из переменной: AtomicFetchAdd(cnt, 1)
+template<typename T> struct Arg
+{
+	typedef T Type;
+};
+
+inline void FenceBefore(MemoryOrder order)
+{
+	if (order == OrderRelease || order == OrderSeqCst)
+		__DMB();
+}
+
+inline void FenceAfter(MemoryOrder order)
+{
+	if (order == OrderAcquire || order == OrderSeqCst)
+		__DMB();
+}
+
+#if MACS_MCU_CORE >= MACS_CORTEX_M3
+template<size_t SIZE> struct Excl;
+
+template<> struct Excl<1>
+{
+	static inline uint32_t Load(volatile void * addr)
+	{
+		return __LDREXB(static_cast<volatile uint8_t *>(addr));
+	}
+	static inline bool Store(uint32_t val, volatile void * addr)
+	{
+		return !__STREXB((uint8_t)val, static_cast<volatile uint8_t *>(addr));
+	}
+};
+
+template<> struct Excl<2>
+{
+	static inline uint32_t Load(volatile void * addr)
+	{
+		return __LDREXH(static_cast<volatile uint16_t *>(addr));
+	}
+	static inline bool Store(uint32_t val, volatile void * addr)
+	{
+		return !__STREXH((uint16_t)val, static_cast<volatile uint16_t *>(addr));
+	}
+};
+
+template<> struct Excl<4>
+{
+	static inline uint32_t Load(volatile void * addr)
+	{
+		return __LDREXW(static_cast<volatile uint32_t *>(addr));
+	}
+	static inline bool Store(uint32_t val, volatile void * addr)
+	{
+		return !__STREXW(val, static_cast<volatile uint32_t *>(addr));
+	}
+};
+
+template<typename T>
+inline T Load(volatile T & var)
+{
+	return (T)Excl<sizeof(T)>::Load(&var);
+}
+
+template<typename T>
+inline bool Store(volatile T & var, T val)
+{
+	return Excl<sizeof(T)>::Store((uint32_t)val, &var);
+}
+#else
+class IrqLock
+{
+public:
+	IrqLock() :
+			m_primask(__get_PRIMASK())
+	{
+		__disable_irq();
+	}
+	~IrqLock()
+	{
+		__set_PRIMASK(m_primask);
+	}
+private:
+	CLS_COPY(IrqLock)
+
+	uint32_t m_primask;
+};
+#endif
+
+// op(old) -> new; возвращает прежнее значение
+template<typename T, typename Op>
+inline T Modify(volatile T & var, const Op & op, MemoryOrder order)
+{
+	FenceBefore(order);
+	T old;
+#if MACS_MCU_CORE >= MACS_CORTEX_M3
+	do
+		old = Load(var);
+	while (!Store(var, op(old)));
+#else
+	{
+		IrqLock _lock_;
+		old = var;
+		var = op(old);
+	}
+#endif
+	FenceAfter(order);
+	return old;
+}
+
+template<typename T> struct OpSet
+{
+	T m_arg;
+	T operator()(T) const
+	{
+		return m_arg;
+	}
+};
+
+template<typename T> struct OpAdd
+{
+	T m_arg;
+	T operator()(T val) const
+	{
+		return val + m_arg;
+	}
+};
+
+template<typename T> struct OpSub
+{
+	T m_arg;
+	T operator()(T val) const
+	{
+		return val - m_arg;
+	}
+};
+
+template<typename T> struct OpOr
+{
+	T m_arg;
+	T operator()(T val) const
+	{
+		return val | m_arg;
+	}
+};
+
+template<typename T> struct OpAnd
+{
+	T m_arg;
+	T operator()(T val) const
+	{
+		return val & m_arg;
+	}
+};
+
+}
+
+// выровненные чтение и запись до 32 бит атомарны сами по себе, порядок задают барьеры
+template<typename T>
+inline T AtomicLoad(const volatile T & var, MemoryOrder order = OrderSeqCst)
+{
+	T val = var;
+	atomic_impl::FenceAfter(order);
+	return val;
+}
+
+template<typename T>
+inline void AtomicStore(volatile T & var, typename atomic_impl::Arg<T>::Type val, MemoryOrder order = OrderSeqCst)
+{
+	atomic_impl::FenceBefore(order);
+	var = val;
+	if (order == OrderSeqCst)
+		__DMB();
+}
+
+// операции чтения-модификации-записи возвращают прежнее значение
+template<typename T>
+inline T AtomicExchange(volatile T & var, typename atomic_impl::Arg<T>::Type val, MemoryOrder order = OrderSeqCst)
+{
+	atomic_impl::OpSet<T> op = {val};
+	return atomic_impl::Modify(var, op, order);
+}
+
+template<typename T>
+inline T AtomicFetchAdd(volatile T & var, typename atomic_impl::Arg<T>::Type arg, MemoryOrder order = OrderSeqCst)
+{
+	atomic_impl::OpAdd<T> op = {arg};
+	return atomic_impl::Modify(var, op, order);
+}
+
+template<typename T>
+inline T AtomicFetchSub(volatile T & var, typename atomic_impl::Arg<T>::Type arg, MemoryOrder order = OrderSeqCst)
+{
+	atomic_impl::OpSub<T> op = {arg};
+	return atomic_impl::Modify(var, op, order);
+}
+
+template<typename T>
+inline T AtomicSetBits(volatile T & var, typename atomic_impl::Arg<T>::Type mask, MemoryOrder order = OrderSeqCst)
+{
+	atomic_impl::OpOr<T> op = {mask};
+	return atomic_impl::Modify(var, op, order);
+}
+
+template<typename T>
+inline T AtomicClearBits(volatile T & var, typename atomic_impl::Arg<T>::Type mask, MemoryOrder order = OrderSeqCst)
+{
+	atomic_impl::OpAnd<T> op = {(T)~mask};
+	return atomic_impl::Modify(var, op, order);
+}
+
+// при неудаче в expected возвращается текущее значение
+template<typename T>
+inline bool AtomicCompareExchange(volatile T & var, typename atomic_impl::Arg<T>::Type & expected, typename atomic_impl::Arg<T>::Type desired, MemoryOrder order = OrderSeqCst)
+{
+	atomic_impl::FenceBefore(order);
+#if MACS_MCU_CORE >= MACS_CORTEX_M3
+	for (;;) {
+		T cur = atomic_impl::Load(var);
+		if (cur != expected) {
+			__CLREX();
+			expected = cur;
+			return false;
+		}
+		if (atomic_impl::Store(var, desired))
+			break;
+	}
+#else
+	{
+		atomic_impl::IrqLock _lock_;
+		T cur = var;
+		if (cur != expected) {
+			expected = cur;
+			return false;
+		}
+		var = desired;
+	}
+#endif
+	atomic_impl::FenceAfter(order);
+	return true;
+}
+
+}
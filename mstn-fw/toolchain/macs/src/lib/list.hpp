@@ -391,8 +391,135 @@ public:
 		typedef SListOrd<type, name##next_elm_offset, less> name
 #else	 
 #define SLISTORD_DECLARE(name, type, next, less) typedef SListOrd<type, 0, less> name
-#endif		
+#endif
 
-}  
+// Двусвязный список: prev указывает на ссылку, которая ведет на элемент (голову или next предыдущего),
+// поэтому голова остается простым указателем, а удаление не ищет элемент.
+// prev == nullptr - элемент не в списке. Голова не должна менять адрес, пока список не пуст.
+template <typename T, const size_t next_elm_offset, const size_t prev_elm_offset>
+class DList
+{
+private:
+	static const size_t m_offset = next_elm_offset;
+	static const size_t m_prev_offset = prev_elm_offset;
+public:
+	static inline const T * & Next(const T * elm)
+	{
+		return *(const T **)(((LIST_PTR)elm) + m_offset);
+	}
+	static inline T * & Next(T * elm)
+	{
+		return *(T **)(((LIST_PTR)elm) + m_offset);
+	}
+	static inline T ** & Prev(T * elm)
+	{
+		return *(T ***)(((LIST_PTR)elm) + m_prev_offset);
+	}
+	static inline bool IsLinked(T * elm)
+	{
+		return !!Prev(elm);
+	}
+	static ulong Qty(const T * head)
+	{
+		ulong qty = 0;
+		while (head) {
+			++qty;
+			head = Next(head);
+		}
+		return qty;
+	}
+	static T ** Find(T * & head, T * elm)
+	{
+		T ** ptr = &head;
+		while ((*ptr)) {
+			if ((*ptr) == elm)
+				break;
+			ptr = &Next(*ptr);
+		}
+		return ptr;
+	}
+	// вставка перед элементом, на который ведет link
+	static void Add(T * & link, T * elm)
+	{
+		_ASSERT(elm);_ASSERT(! IsLinked(elm));
+
+		T * next = link;
+		Next(elm) = next;
+		Prev(elm) = &link;
+		if (next)
+			Prev(next) = &Next(elm);
+		link = elm;
+	}
+	// элемент вне списка пропускается, элемент из другого списка с теми же полями - ошибка
+	static void Del(T * & head, T * elm)
+	{
+		_ASSERT(elm);
+		if (!IsLinked(elm))
+			return;
+		_ASSERT(* Find(head, elm));
+		(void)head;
+
+		T * next = Next(elm);
+		*Prev(elm) = next;
+		if (next)
+			Prev(next) = Prev(elm);
+		Next(elm) = nullptr;
+		Prev(elm) = nullptr;
+	}
+	static T * Fetch(T * & head)
+	{
+		T * elm = head;
+		if (elm)
+			Del(head, elm);
+		return elm;
+	}
+	static T * Func(T * & head, bool (*pf)(T *))
+	{
+		_ASSERT(pf);
+		T * elm = head;
+		while (elm) {
+			if (!(*pf)(elm))
+				break;
+			elm = Next(elm);
+		}
+		return elm;
+	}
+};
+#ifndef MACS_CCC
+#define DLIST_DECLARE(name, type, next, prev) \
+		static const size_t name##next_elm_offset = SLIST_NEXT_OFFSET(type, next); \
+		static const size_t name##prev_elm_offset = SLIST_NEXT_OFFSET(type, prev); \
+		typedef DList<type, name##next_elm_offset, name##prev_elm_offset> name
+#else
+#define DLIST_DECLARE(name, type, next, prev) typedef DList<type, 0, 0> name
+#endif
+
+template <typename T, size_t next_elm_offset, size_t prev_elm_offset, bool Preceeding(T * a, T * b)>
+class DListOrd: public DList<T, next_elm_offset, prev_elm_offset>
+{
+	typedef DList<T, next_elm_offset, prev_elm_offset> Base;
+public:
+	static void Add(T * & head, T * elm)
+	{
+		T ** ptr = &head;
+		while ((*ptr)) {
+			_ASSERT((* ptr) != elm);
+			if (Preceeding(elm, (*ptr)))
+				break;
+			ptr = &Base::Next(*ptr);
+		}
+		Base::Add((*ptr), elm);
+	}
+};
+#ifndef MACS_CCC
+#define DLISTORD_DECLARE(name, type, next, prev, less) \
+		static const size_t name##next_elm_offset = SLIST_NEXT_OFFSET(type, next); \
+		static const size_t name##prev_elm_offset = SLIST_NEXT_OFFSET(type, prev); \
+		typedef DListOrd<type, name##next_elm_offset, name##prev_elm_offset, less> name
+#else
+#define DLISTORD_DECLARE(name, type, next, prev, less) typedef DListOrd<type, 0, 0, less> name
+#endif
+
+}
 
 using namespace utils;
@@ -0,0 +1,232 @@
+/** @copyright AstroSoft Ltd */
+
+#include "tunes.h"
+
+#if MACS_LOG_ENABLED
+
+#include <stdio.h>
+#include "common.hpp"
+#include "system.hpp"
+#include "scheduler.hpp"
+#include "task.hpp"
+#include "atomic.hpp"
+#include "log.hpp"
+#include "profiler.hpp"
+
+extern "C" int _write(int file, char * ptr, int len);
+
+namespace macs
+{
+
+typedef char LogBufLenCheck[(Logger::BUF_LEN & (Logger::BUF_LEN - 1)) == 0 ? 1 : -1];
+
+static const int LOG_FILE = 1;
+static const byte LOG_FRAME_SYNC = 0xA5;
+static const size_t LOG_LINE_LEN = 96;
+
+Logger::Record Logger::m_buf[Logger::BUF_LEN];
+volatile uint32_t Logger::m_head = 0;
+volatile uint32_t Logger::m_tail = 0;
+volatile ulong Logger::m_dropped = 0;
+ulong Logger::m_dropped_reported = 0;
+
+class LogTask: public Task
+{
+public:
+	LogTask() :
+			Task("LOG")
+	{
+	}
+
+private:
+	virtual void Execute()
+	{
+		for (;;) {
+			Logger::Drain();
+			// спит до записи, на которой остановился вывод (Logger::Store)
+			WaitNotify(~0u);
+		}
+	}
+};
+
+static Task * volatile s_log_task = nullptr;
+
+Result Logger::Initialize()
+{
+	Task * task = new LogTask();
+	Result res = Task::Add(task, Task::PriorityLow, Task::ModePrivileged);
+	if (res == ResultOk)
+		s_log_task = task;
+	return res;
+}
+
+bool Logger::Reserve(uint32_t & pos)
+{
+	uint32_t head = m_head;
+	do {
+		if (head - m_tail >= BUF_LEN)
+			return false;
+	} while (!AtomicCompareExchange(m_head, head, head + 1, OrderRelaxed));
+	pos = head;
+	return true;
+}
+
+void Logger::IncDropped()
+{
+	AtomicFetchAdd(m_dropped, 1, OrderRelaxed);
+}
+
+void Logger::Store(Level level, CSPTR fmt, uint argc, uint32_t a0, uint32_t a1, uint32_t a2, uint32_t a3)
+{
+	PROF_EYE(PE_LOG_PUT, log_put);
+
+	uint32_t pos;
+	if (!Reserve(pos)) {
+		IncDropped();
+		return;
+	}
+
+	Record & rec = m_buf[pos % BUF_LEN];
+	rec.m_fmt = fmt;
+	rec.m_stamp = Sch().GetTickCount();
+	rec.m_level = level;
+	rec.m_argc = argc;
+	rec.m_args[0] = a0;
+	rec.m_args[1] = a1;
+	rec.m_args[2] = a2;
+	rec.m_args[3] = a3;
+
+	// запись должна стать видимой раньше, чем номер
+	__DMB();
+	rec.m_seq = pos + 1;
+
+	// вывод будит только запись, на которой он остановился: остальные он заберет, не засыпая.
+	// Запись из кода, где системные вызовы запрещены, уйдет вместе со следующей
+	__DMB();
+	Task * task = s_log_task;
+	if (m_tail == pos && task)
+		Task::Notify(task, 1);
+}
+
+size_t Logger::Drain()
+{
+	size_t cnt = 0;
+
+	ulong dropped = m_dropped;
+	if (dropped != m_dropped_reported) {
+		EmitDropped(dropped - m_dropped_reported);
+		m_dropped_reported = dropped;
+	}
+
+	for (;;) {
+		uint32_t tail = m_tail;
+		Record & rec = m_buf[tail % BUF_LEN];
+		if (rec.m_seq != tail + 1)
+			break;
+
+		Emit(rec);
+
+		// освобождаем ячейку только после форматирования
+		__DMB();
+		m_tail = tail + 1;
+		++cnt;
+	}
+
+	return cnt;
+}
+
+#if MACS_LOG_BINARY
+
+static size_t PutWord(byte * ptr, uint32_t val)
+{
+	ptr[0] = (byte)val;
+	ptr[1] = (byte)(val >> 8);
+	ptr[2] = (byte)(val >> 16);
+	ptr[3] = (byte)(val >> 24);
+	return sizeof(val);
+}
+
+// кадр: 0xA5, уровень | (число аргументов << 4), метка времени, адрес формата, аргументы (LE)
+void Logger::Emit(const Record & rec)
+{
+	PROF_EYE(PE_LOG_DRAIN, log_drain);
+
+	byte frame[2 + 2 * sizeof(uint32_t) + MAX_ARGS * sizeof(uint32_t)];
+	size_t len = 0;
+	frame[len++] = LOG_FRAME_SYNC;
+	frame[len++] = (byte)(rec.m_level | (rec.m_argc << 4));
+	len += PutWord(&frame[len], rec.m_stamp);
+	len += PutWord(&frame[len], (uint32_t)rec.m_fmt);
+	for (uint i = 0; i < rec.m_argc; ++i)
+		len += PutWord(&frame[len], rec.m_args[i]);
+
+	_write(LOG_FILE, (char *)frame, len);
+}
+
+// нулевой адрес формата означает счетчик потерянных записей
+void Logger::EmitDropped(ulong dropped)
+{
+	Record rec;
+	rec.m_fmt = nullptr;
+	rec.m_stamp = Sch().GetTickCount();
+	rec.m_level = LevelWrn;
+	rec.m_argc = 1;
+	rec.m_args[0] = dropped;
+	Emit(rec);
+}
+
+#else
+
+static char LevelChar(uint8_t level)
+{
+	switch (level) {
+	case Logger::LevelErr:
+		return 'E';
+	case Logger::LevelWrn:
+		return 'W';
+	case Logger::LevelInf:
+		return 'I';
+	case Logger::LevelDbg:
+		return 'D';
+	}
+	return '?';
+}
+
+static void EmitLine(char * line, int len)
+{
+	if (len < 0)
+		return;
+	if (len > (int)LOG_LINE_LEN - 3)
+		len = LOG_LINE_LEN - 3;
+	line[len++] = '\r';
+	line[len++] = '\n';
+	_write(LOG_FILE, line, len);
+}
+
+void Logger::Emit(const Record & rec)
+{
+	PROF_EYE(PE_LOG_DRAIN, log_drain);
+
+	char line[LOG_LINE_LEN];
+	int len = snprintf(line, sizeof(line), "%8lu %c ", (ulong)rec.m_stamp, LevelChar(rec.m_level));
+	if (len < 0 || len >= (int)sizeof(line))
+		return;
+
+	int res = snprintf(&line[len], sizeof(line) - len, rec.m_fmt, rec.m_args[0], rec.m_args[1], rec.m_args[2], rec.m_args[3]);
+	if (res < 0)
+		return;
+
+	EmitLine(line, len + res);
+}
+
+void Logger::EmitDropped(ulong dropped)
+{
+	char line[LOG_LINE_LEN];
+	EmitLine(line, snprintf(line, sizeof(line), "%8lu W %lu log records dropped", (ulong)Sch().GetTickCount(), dropped));
+}
+
+#endif
+
+}
+
+#endif
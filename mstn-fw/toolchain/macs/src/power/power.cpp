@@ -0,0 +1,190 @@
+/** @copyright AstroSoft Ltd */
+
+#include "tunes.h"
+
+#if MACS_POWER_MANAGEMENT
+
+#include "common.hpp"
+#include "system.hpp"
+#include "scheduler.hpp"
+#include "atomic.hpp"
+#include "power.hpp"
+#include "idle_job.hpp"
+
+namespace macs
+{
+
+// дольше не спим за раз, чтобы не переполнять счет в мкс
+static const uint32_t MAX_STOP_MS = 60000;
+
+volatile uint Power::m_wake_sources = 0;
+volatile uint32_t Power::m_inhibit_cnt = 0;
+uint32_t Power::m_min_stop_ms = MACS_POWER_MIN_STOP_MS;
+uint64_t Power::m_time_us[Power::STATE_COUNT];
+ulong Power::m_entries[Power::STATE_COUNT];
+
+static inline uint32_t CyclesPerUs()
+{
+	return System::GetCpuFreq() / 1000000;
+}
+
+static inline uint32_t TickUs()
+{
+	return 1000000 / System::GetTickRate();
+}
+
+void Power::SetWakeSources(uint sources)
+{
+	m_wake_sources = sources;
+}
+
+void Power::Inhibit()
+{
+	AtomicFetchAdd(m_inhibit_cnt, 1, OrderRelaxed);
+}
+
+void Power::Allow()
+{
+	uint32_t cnt = m_inhibit_cnt;
+	while (cnt && !AtomicCompareExchange(m_inhibit_cnt, cnt, cnt - 1, OrderRelaxed))
+		;
+}
+
+void Power::SetMinStopMs(uint32_t ms)
+{
+	m_min_stop_ms = ms;
+}
+
+void Power::GetStats(Stats & stats)
+{
+	uint64_t total_us;
+	{
+		PauseSection _ps_;
+		total_us = (uint64_t)Sch().GetTickCount() * TickUs();
+		for (uint i = 0; i < STATE_COUNT; ++i) {
+			stats.m_time_us[i] = m_time_us[i];
+			stats.m_entries[i] = m_entries[i];
+		}
+	}
+
+	uint64_t idle_us = stats.m_time_us[StateSleep] + stats.m_time_us[StateStop];
+	stats.m_time_us[StateRun] = total_us > idle_us ? total_us - idle_us : 0;
+}
+
+void Power::Account(State state, uint32_t us)
+{
+	m_time_us[state] += us;
+	++m_entries[state];
+}
+
+// SysTick перезаряжается на весь сон; последний тик отрабатывает обычное прерывание
+uint32_t Power::Sleep(uint32_t idle_ticks)
+{
+	uint32_t load = SysTick->LOAD + 1;
+	uint32_t ticks = MIN(idle_ticks, (SysTick_LOAD_RELOAD_Msk + 1) / load);
+
+	if (ticks < 2 || (SCB->ICSR & SCB_ICSR_PENDSTSET_Msk)) {
+		uint32_t start = SysTick->VAL;
+		bool pending = SCB->ICSR & SCB_ICSR_PENDSTSET_Msk;
+		__DSB();
+		__WFI();
+		uint32_t cycles = start - SysTick->VAL;
+		if (!pending && (SCB->ICSR & SCB_ICSR_PENDSTSET_Msk))
+			cycles += load;
+		return cycles / CyclesPerUs();
+	}
+
+	SysTick->CTRL &= ~SysTick_CTRL_ENABLE_Msk;
+	uint32_t reload = SysTick->VAL + load * (ticks - 1);
+	SysTick->LOAD = reload - 1;
+	SysTick->VAL = 0;
+	SysTick->CTRL |= SysTick_CTRL_ENABLE_Msk;
+
+	__DSB();
+	__WFI();
+
+	uint32_t ctrl = SysTick->CTRL;
+	SysTick->CTRL = ctrl & ~SysTick_CTRL_ENABLE_Msk;
+
+	uint32_t stepped;
+	uint32_t cycles;
+	if (ctrl & SysTick_CTRL_COUNTFLAG_Msk) {
+		// досчитал: прерывание SysTick уже ждет, остаток текущего тика продолжаем отсчитывать
+		uint32_t late = reload - 1 - SysTick->VAL;
+		uint32_t rest = late < load ? load - 1 - late : load - 1;
+		SysTick->LOAD = rest ? rest : load - 1;
+		stepped = ticks - 1;
+		cycles = reload + late;
+	} else {
+		uint32_t done = ticks * load - SysTick->VAL;
+		stepped = done / load;
+		SysTick->LOAD = (stepped + 1) * load - done;
+		cycles = reload - 1 - SysTick->VAL;
+	}
+
+	SysTick->VAL = 0;
+	SysTick->CTRL |= SysTick_CTRL_ENABLE_Msk;
+	SysTick->LOAD = load - 1;
+
+	Sch().StepTicks(stepped);
+	return cycles / CyclesPerUs();
+}
+
+uint32_t Power::Stop(uint32_t idle_ticks)
+{
+	uint32_t tick_us = TickUs();
+	uint32_t ticks = MIN(idle_ticks, MsToTicks(MAX_STOP_MS));
+	uint32_t load = SysTick->LOAD + 1;
+
+	// время отсчитывается от начала текущего тика
+	uint32_t passed_us = (load - 1 - SysTick->VAL) / CyclesPerUs();
+	uint32_t slept_us = System::EnterStopMode(ticks * tick_us - passed_us);
+	if (!slept_us)
+		return 0;
+
+	uint32_t total_us = passed_us + slept_us;
+	uint32_t stepped = total_us / tick_us;
+	if (stepped >= ticks) {
+		stepped = ticks - 1;
+		SCB->ICSR = SCB_ICSR_PENDSTSET_Msk;
+		SysTick->LOAD = load - 1;
+	} else {
+		uint32_t rest = (tick_us - total_us % tick_us) * CyclesPerUs();
+		SysTick->LOAD = MIN(MAX(rest, 2u), load) - 1;
+	}
+	SysTick->VAL = 0;
+	SysTick->CTRL = SysTick_CTRL_CLKSOURCE_Msk | SysTick_CTRL_TICKINT_Msk | SysTick_CTRL_ENABLE_Msk;
+	SysTick->LOAD = load - 1;
+
+	Sch().StepTicks(stepped);
+	return slept_us;
+}
+
+void Power::Idle(uint32_t max_ticks)
+{
+	__disable_irq();
+
+	uint32_t idle_ticks = MIN(Sch().GetIdleTicks(), max_ticks);
+#if MACS_IDLE_JOBS
+	// фоновая работа, запрошенная после обхода, не ждет конца сна
+	if (IdleJob::IsTriggered())
+		idle_ticks = 0;
+#endif
+	if (idle_ticks) {
+		bool stop_allowed = !m_inhibit_cnt && !(m_wake_sources & ~System::STOP_WAKE_SOURCES)
+			&& idle_ticks >= MsToTicks(m_min_stop_ms);
+
+		uint32_t us = stop_allowed ? Stop(idle_ticks) : 0;
+		if (us)
+			Account(StateStop, us);
+		else
+			Account(StateSleep, Sleep(idle_ticks));
+	}
+
+	// ожидающие прерывания, в том числе разбудившее, обрабатываются здесь
+	__enable_irq();
+}
+
+}
+
+#endif
@@ -6,6 +6,7 @@
 
 #include "common.hpp"
 #include "critical_section.hpp"
+#include "atomic.hpp"
 #include "task.hpp"
 #include "profiler.hpp"
 
@@ -21,6 +22,31 @@ tick_t ProfData::m_embrace_overhead = 0;
 
 ProfEye * ProfEye::m_cur_eye = nullptr;
 
+// сумма квадратов копится по словам: перенос уходит в старшее слово отдельной операцией
+static void AddWide(uint64_t & sum, uint64_t val)
+{
+	volatile uint32_t * words = reinterpret_cast<volatile uint32_t *>(&sum);
+	uint32_t lo = (uint32_t)val;
+	uint32_t old = AtomicFetchAdd(words[0], lo, OrderRelaxed);
+	uint32_t hi = (uint32_t)(val >> 32) + (old + lo < old ? 1 : 0);
+	if (hi)
+		AtomicFetchAdd(words[1], hi, OrderRelaxed);
+}
+
+static void StoreMin(long & var, long val)
+{
+	long cur = var;
+	while (val < cur && !AtomicCompareExchange(var, cur, val, OrderRelaxed))
+		;
+}
+
+static void StoreMax(long & var, long val)
+{
+	long cur = var;
+	while (val > cur && !AtomicCompareExchange(var, cur, val, OrderRelaxed))
+		;
+}
+
 ProfEye::ProfEye(PROF_EYE eye, bool run)
 {
 	m_eye = eye;
@@ -71,22 +97,16 @@ void ProfEye::Stop(bool call)
 	}
 	m_run = false;
 
-	CriticalSection _cs_;
-
 	if (m_up_eye)  
-		m_up_eye->m_lost += m_lost + ProfData::m_embrace_overhead;
-
-	g_prof_data[m_eye].m_time += pure_time;
-	g_prof_data[m_eye].m_lost += m_lost;
-	g_prof_data[m_eye].m_sqrs += pure_time * (int64_t)pure_time;
+		AtomicFetchAdd(m_up_eye->m_lost, m_lost + ProfData::m_embrace_overhead, OrderRelaxed);
 
-	 
-	long min = MIN(pure_time, g_prof_data[m_eye].m_min);
-	g_prof_data[m_eye].m_min = min;
-	long max = MAX(pure_time, g_prof_data[m_eye].m_max);
-	g_prof_data[m_eye].m_max = max;
-
-	++g_prof_data[m_eye].m_cnt;
+	ProfData & data = g_prof_data[m_eye];
+	AtomicFetchAdd(data.m_time, pure_time, OrderRelaxed);
+	AtomicFetchAdd(data.m_lost, m_lost, OrderRelaxed);
+	AddWide(data.m_sqrs, pure_time * (int64_t)pure_time);
+	StoreMin(data.m_min, pure_time);
+	StoreMax(data.m_max, pure_time);
+	AtomicFetchAdd(data.m_cnt, 1, OrderRelaxed);
 
 	m_lost = 0;
 }
@@ -174,6 +194,11 @@ static CSPTR EyeName(PROF_EYE eye)
 
 	case PE_DELAY_10MS:
 		return "Delay10ms";
+
+	case PE_LOG_PUT:
+		return "LogPut";
+	case PE_LOG_DRAIN:
+		return "LogDrain";
 	}
 	return nullptr;
 }
@@ -192,7 +217,7 @@ void ProfEye::Tune()
 
 	CriticalSection _cs_;
 
-	loop ( int, i, 1000 )
+	for (int i = 0; i < 1000; ++i)
 	{
 		PROF_DECL(PE_EMPTY_CALL, empty_call); PROF_START(empty_call); PROF_STOP(empty_call);
 
@@ -218,7 +243,7 @@ void ProfEye::Print(String & str, bool brief, bool use_ns)
 void ProfEye::PrintResults(String & str, bool brief, bool use_ns)
 {
 	str.Add("Profiler statistics:\n\r");
-	loop ( int, i, PE_QTTY )
+	for (int i = 0; i < PE_QTTY; ++i)
 	{
 		PrintEyeName(str, (PROF_EYE)i);
 		g_prof_data[i].Print(str, brief, use_ns);
@@ -227,6 +252,9 @@ void ProfEye::PrintResults(String & str, bool brief, bool use_ns)
 			str << "------------" << String::NEWLINE;
 	}
 	str.NewLine();
+#if MACS_MASK_BUDGET_ENABLED
+	MaskBudget::Print(str, use_ns);
+#endif
 }
 
 void ProfData::Print(String & str, bool brief, bool use_ns)
@@ -12,13 +12,21 @@
 #include "stack_frame.hpp"
 #include "mutex.hpp"
 #include "semaphore.hpp"
+#include "wait_set.hpp"
+#include "rw_lock.hpp"
+#include "condition_variable.hpp"
 #include "list.hpp"
 #include "profiler.hpp"
+#include "log.hpp"
+#include "power.hpp"
+#include "idle_job.hpp"
+#include "atomic.hpp"
 
 namespace macs
 {
 
-extern "C" void * svcMethods[] = {
+extern "C" void * svcMethods[];
+void * svcMethods[] = {
 	reinterpret_cast<void *>(EPM_Count),
 	reinterpret_cast<void *>(&Read_Cpu_Tick_Priv),
 	reinterpret_cast<void *>(&BlockCurrentTask_Priv),
@@ -33,7 +41,23 @@ extern "C" void * svcMethods[] = {
 	reinterpret_cast<void *>(&Mutex::Lock_Priv),
 	reinterpret_cast<void *>(&Mutex::Unlock_Priv),
 	reinterpret_cast<void *>(&Semaphore::Wait_Priv),
-	reinterpret_cast<void *>(&Semaphore::Signal_Priv)
+	reinterpret_cast<void *>(&Semaphore::Signal_Priv),
+	reinterpret_cast<void *>(&System::SetCpuFreq_Priv),
+	reinterpret_cast<void *>(&WaitSet::Wait_Priv),
+	reinterpret_cast<void *>(&RwLock::Lock_Priv),
+	reinterpret_cast<void *>(&RwLock::Unlock_Priv),
+	reinterpret_cast<void *>(&ConditionVariable::Wait_Priv),
+	reinterpret_cast<void *>(&ConditionVariable::Notify_Priv),
+	reinterpret_cast<void *>(&Task::Notify_Priv),
+	reinterpret_cast<void *>(&Task::WaitNotify_Priv),
+	reinterpret_cast<void *>(&Semaphore::SignalAndWait_Priv),
+	reinterpret_cast<void *>(&Mutex::UnlockAndWait_Priv),
+	reinterpret_cast<void *>(&GetTasksInfo_Priv),
+#if MACS_SYNC_STATS
+	reinterpret_cast<void *>(&SyncObject::LinkStat_Priv)
+#else
+	nullptr
+#endif
 #if MACS_SHARED_MEM_SPI
 	,
 	reinterpret_cast<void *>(&Spi_Initialize_Priv),
@@ -58,11 +82,20 @@ private:
 	virtual void Execute()
 	{
 		for (;;) {
-#if MACS_SLEEP_ON_IDLE
+#if MACS_IDLE_JOBS
+			uint32_t max_ticks = IdleJob::Run();
+			if (!max_ticks)
+				continue;
+#endif
+#if MACS_POWER_MANAGEMENT && MACS_IDLE_JOBS
+			Power::Idle(max_ticks);
+#elif MACS_POWER_MANAGEMENT
+			Power::Idle();
+#elif MACS_SLEEP_ON_IDLE
 			System::EnterSleepMode();
 #endif			
 #if MACS_DEBUG
-			++IdleTaskCnt;
+			AtomicFetchAdd(IdleTaskCnt, 1, OrderRelaxed);
 #endif			
 		}
 	}
@@ -73,7 +106,6 @@ Scheduler::Scheduler() :
 		m_tick_count(0),
 		m_initialized(false),
 		m_started(false),
-		m_pause_flg(false),
 		m_pause_cnt(0),
 		m_pending_swc(false),
 		m_use_preemption(true)
@@ -93,6 +125,8 @@ Result Scheduler::Initialize()
 	if (m_initialized)
 		return ResultErrorInvalidState;
 
+	System::InitCpuTick();
+
 #if MACS_PROFILING_ENABLED
 	TuneProfiler();
 #endif
@@ -108,6 +142,10 @@ Result Scheduler::Initialize()
 	 
 	AddTask(new IdleTask(), Task::PriorityIdle, Task::ModePrivileged);
 
+#if MACS_LOG_ENABLED
+	Logger::Initialize();
+#endif
+
 	m_initialized = true;
 	return ResultOk;
 }
@@ -144,23 +182,34 @@ Result Scheduler::Pause(bool set_on)
 		return ResultErrorInvalidState;
 
 	if (!set_on) {
-		 
-		if (m_pause_cnt == 0) {
-			App().OnAlarm(AR_SCHED_NOT_ON_PAUSE);
+#if MACS_MASK_BUDGET_ENABLED
+		// пока пауза не снята, чужая внешняя пауза не начнется и интервал не перезапишет
+		MaskBudget::Interval interval = MaskBudget::Opened(MaskBudget::KindPause);
+#endif
+		uint cnt = m_pause_cnt;
+		do {
+			if (cnt == 0) {
+				App().OnAlarm(AR_SCHED_NOT_ON_PAUSE);
 
-			return ResultErrorInvalidState;
-		}
-		if (--m_pause_cnt == 0) {
+				return ResultErrorInvalidState;
+			}
+		} while (!AtomicCompareExchange(m_pause_cnt, cnt, cnt - 1));
+		if (cnt == 1) {
+#if MACS_MASK_BUDGET_ENABLED
+			MaskBudget::Leave(MaskBudget::KindPause, interval);
+#endif
 			if (m_pending_swc) {
 				Yield();
 			}
 		}
 	} else {
-		m_pause_flg = true;  
-		++m_pause_cnt;  
-		if (m_pause_cnt == 0)
+		uint cnt = AtomicFetchAdd(m_pause_cnt, 1);
+		if (cnt == UINT_MAX)
 			App().OnAlarm(AR_COUNTER_OVERFLOW);
-		m_pause_flg = false;  
+#if MACS_MASK_BUDGET_ENABLED
+		else if (cnt == 0)
+			MaskBudget::Enter(MaskBudget::KindPause, __builtin_return_address(0));
+#endif
 	}
 
 	return ResultOk;
@@ -344,7 +393,7 @@ Result BlockCurrentTask_Priv(Scheduler * pS, uint32_t timeout_ms, Task::UnblockF
 	pS->m_cur_task->m_unblock_reason = Task::UnblockReasonNone;
 	pS->m_cur_task->m_unblock_func = unblock_functor;
 
-	pS->m_cur_task->m_dream_ticks = (timeout_ms != INFINITE_TIMEOUT ? MsToTicks(timeout_ms) : ULONG_MAX);
+	pS->m_cur_task->m_dream_ticks = (timeout_ms != INFINITE_TIMEOUT ? MsToTicks(timeout_ms) : UINT32_MAX);
 	pS->m_sleep_tasks.Insert(pS->m_cur_task);
 
 	pS->TryContextSwitch();
@@ -364,7 +413,7 @@ Result UnblockTask_Priv(Scheduler * pS, Task * task)
 	if (!pS->m_use_preemption)
 		return ResultOk;
 
-	if (pS->m_cur_task->m_priority < task->m_priority)
+	if (PriorPreceeding(task, pS->m_cur_task))
 		pS->TryContextSwitch();
 
 	return ResultOk;
@@ -390,6 +439,7 @@ bool Scheduler::UnblockTaskInternal(Task * task, Task::UnblockReason reason)
 		return false;
 
 	task->m_unblock_reason = reason;
+	task->m_notify_waiting = false;
 	task->m_state = Task::StateReady;
 	if (task != m_cur_task)
 		m_work_tasks.Insert(task);
@@ -399,9 +449,26 @@ bool Scheduler::UnblockTaskInternal(Task * task, Task::UnblockReason reason)
 		task->m_unblock_func = nullptr;
 	}
 
+#if MACS_SYNC_STATS
+	// объект, в очереди которого задача начала ждать, даже если ее уже сняли с очереди
+	if (task->m_stat_obj) {
+		task->m_stat_obj->CountWake(task, reason);
+		task->m_stat_obj = nullptr;
+	}
+#endif
+
 	return true;
 }
 
+// задача остается блокированной, но уже без таймаута
+void Scheduler::CancelTimeout(Task * task)
+{
+	_ASSERT(task->m_state == Task::StateBlocked);
+	m_sleep_tasks.Remove(task);
+	task->m_dream_ticks = UINT32_MAX;
+	m_sleep_tasks.Insert(task);
+}
+
 void _SetTaskPriority_Priv(Scheduler * pS, Task * task, Task::Priority priority)
 {
 	task->m_priority = priority;
@@ -430,6 +497,8 @@ Result IntSetTaskPriority_Priv(Scheduler * pS, Task * task, Task::Priority prior
 	if (task->m_state == Task::StateReady) {
 		pS->m_work_tasks.Remove(task);  
 		pS->m_work_tasks.Insert(task);
+	} else if (task->m_state == Task::StateBlocked && task->m_unblock_func) {
+		task->m_unblock_func->OnChangePriority(task);
 	}
 
 #if MACS_MUTEX_PRIORITY_INVERSION
@@ -439,6 +508,10 @@ Result IntSetTaskPriority_Priv(Scheduler * pS, Task * task, Task::Priority prior
 			pobj->m_owner_original_priority = priority;
 			pobj = OwnedSyncObjList::Next(pobj);
 		}
+		// внутренние вызовы идут из SyncOwnedObject::UpdateOwnerPriority, который сам проходит цепочку
+		SyncOwnedObject * inheritor = task->m_state == Task::StateBlocked && task->m_unblock_func ? task->m_unblock_func->Inheritor() : nullptr;
+		if (inheritor)
+			inheritor->UpdateOwnerPriority();
 	}
 #endif
 
@@ -482,6 +555,9 @@ bool Scheduler::SysTickHandler()
 	if (!m_started)
 		return false;
 
+	if (m_cur_task)
+		++m_cur_task->m_run_ticks;
+
 	m_sleep_tasks.Tick();
 	for (;;) {
 		Task * awake_task = m_sleep_tasks.Fetch();
@@ -497,7 +573,7 @@ bool Scheduler::SysTickHandler()
 		m_irq_tasks.ActivateTasks();
 #endif
 
-	if (m_pause_flg || m_pause_cnt != 0) {
+	if (m_pause_cnt != 0) {
 		m_pending_swc = true;
 		return false;
 	}
@@ -508,6 +584,27 @@ bool Scheduler::SysTickHandler()
 	return IsContextSwitchRequired();
 }
 
+// вызывается при запрещенных прерываниях; 0 - спать нельзя, UINT32_MAX - будить некому, кроме прерываний
+uint32_t Scheduler::GetIdleTicks()
+{
+	if (m_pending_swc || m_work_tasks.FirstTask())
+		return 0;
+#if ! MACS_IRQ_FAST_SWITCH
+	if (m_irq_tasks.NeedIrqActivate())
+		return 0;
+#endif
+	return m_sleep_tasks.NextWakeup();
+}
+
+// пропущенные во сне тики, меньше GetIdleTicks(): задачи при этом не просыпаются
+void Scheduler::StepTicks(uint32_t ticks)
+{
+	m_tick_count += ticks;
+	m_sleep_tasks.Tick(ticks);
+	if (m_cur_task)
+		m_cur_task->m_run_ticks += ticks;
+}
+
 bool Scheduler::IsContextSwitchRequired()
 {
 	if (m_pending_swc)
@@ -516,8 +613,8 @@ bool Scheduler::IsContextSwitchRequired()
 	if (!m_cur_task || m_cur_task->m_state != Task::StateRunning)
 		return true;
 
-	const Task * cand_task = m_work_tasks.FirstTask();
-	if (cand_task && m_cur_task->GetPriority() <= cand_task->GetPriority())
+	Task * cand_task = m_work_tasks.FirstTask();
+	if (cand_task && !PriorPreceeding(m_cur_task, cand_task))
 		return true;
 
 	return false;
@@ -542,7 +639,7 @@ void Scheduler::SelectNextTask()
 StackPtr Scheduler::SwitchContext(StackPtr new_sp)
 {
 	CriticalSection _cs_;
-	_ASSERT(! m_pause_flg && m_pause_cnt == 0);
+	_ASSERT(m_pause_cnt == 0);
 
 	m_pending_swc = false;
 
@@ -613,6 +710,75 @@ uint Scheduler::GetTasksQty()
 {
 	return m_work_tasks.Qty() + m_sleep_tasks.Qty() + (m_cur_task ? 1 : 0);
 }
+
+static void FillTaskInfo(Scheduler::TaskInfo * info, uint max, uint & count, Task * task)
+{
+	if (count < max) {
+		Scheduler::TaskInfo & ti = info[count];
+		ti.m_task = task;
+		ti.m_name = task->GetName();
+		ti.m_state = task->GetState();
+		ti.m_priority = task->GetPriority();
+		ti.m_unblock_reason = task->GetUnblockReason();
+		ti.m_run_ticks = task->GetRunTicks();
+		ti.m_stack_len = task->GetStackLen();
+		ti.m_stack_usage = 0;
+		ti.m_stack_margin = task->GetStackMargin();
+		ti.m_stack_top = task->GetStackTop();
+	}
+	++count;
+}
+
+// *count: на входе - емкость info, на выходе - число задач
+Result GetTasksInfo_Priv(Scheduler * pS, Scheduler::TaskInfo * info, uint * count)
+{
+	CriticalSection _cs_;
+
+	uint max = *count;
+	uint cnt = 0;
+	if (pS->m_cur_task)
+		FillTaskInfo(info, max, cnt, pS->m_cur_task);
+	for (Task * task = pS->m_work_tasks.FirstTask(); task; task = TaskWorkList::Next(task))
+		FillTaskInfo(info, max, cnt, task);
+	for (Task * task = pS->m_sleep_tasks.FirstTask(); task; task = TaskSleepList::Next(task))
+		FillTaskInfo(info, max, cnt, task);
+
+	*count = cnt;
+	return ResultOk;
+}
+
+uint Scheduler::GetTasksInfo(TaskInfo * info, uint max)
+{
+	if (!m_started)
+		return 0;
+
+	uint count;
+	{
+		PauseSection _ps_;
+		count = CopyTasksInfo(info, max);
+	}
+	ScanStacks(info, MIN(count, max));
+	return count;
+}
+
+uint Scheduler::CopyTasksInfo(TaskInfo * info, uint max)
+{
+	if (!m_started)
+		return 0;
+
+	uint count = max;
+	if (System::IsInPrivOrIrq())
+		GetTasksInfo_Priv(this, info, &count);
+	else
+		SvcExecPrivileged(this, info, &count, EPM_GetTasksInfo_Priv);
+	return count;
+}
+
+void Scheduler::ScanStacks(TaskInfo * info, uint count)
+{
+	for (uint i = 0; i < count; ++i)
+		info[i].m_stack_usage = info[i].m_stack_len - info[i].m_stack_top.GetVirginLen(info[i].m_stack_margin);
+}
  
 void TaskWorkRoom::Insert(Task * task)
 {
@@ -628,12 +794,12 @@ void TaskSleepRoom::Insert(Task * task)
 	TaskSleepList::Add(m_task_list, task);
 }
 
-void TaskSleepRoom::Tick()
+void TaskSleepRoom::Tick(uint32_t ticks)
 {
 	for (Task * ptsk = m_task_list; ptsk != nullptr; ptsk = TaskSleepList::Next(ptsk)) {
 		_ASSERT(ptsk->m_dream_ticks);
-		if (ptsk->m_dream_ticks != ULONG_MAX)
-			--ptsk->m_dream_ticks;
+		if (ptsk->m_dream_ticks != UINT32_MAX)
+			ptsk->m_dream_ticks -= MIN(ticks, ptsk->m_dream_ticks);
 	}
 }
 
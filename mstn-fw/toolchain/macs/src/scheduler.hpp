@@ -44,28 +44,41 @@ public:
 		return !!*TaskRoomList::Find(m_task_list, task);
 	}
 #endif	
-	inline void Remove(Task * task)
-	{
-		TaskRoomList::Del(m_task_list, task);
-	}
 };
 
 class TaskSleepRoom: public TaskRoom
 {
 public:
 	inline void Insert(Task * task);
+	// спящие и готовые задачи связаны одними полями: в списке ожидания только блокированные
+	inline void Remove(Task * task)
+	{
+		if (task->m_state == Task::StateBlocked)
+			TaskSleepList::Del(m_task_list, task);
+	}
 	inline Task * Fetch()
 	{
 		return (m_task_list && !m_task_list->m_dream_ticks) ? TaskSleepList::Fetch(m_task_list) : nullptr;
 	}
 
-	void Tick();
+	void Tick(uint32_t ticks = 1);
+
+	// тиков до пробуждения первой спящей задачи
+	inline uint32_t NextWakeup() const
+	{
+		return m_task_list ? m_task_list->m_dream_ticks : UINT32_MAX;
+	}
 };
 
 class TaskWorkRoom: public TaskRoom
 {
 public:
 	inline void Insert(Task * task);
+	inline void Remove(Task * task)
+	{
+		if (task->m_state == Task::StateReady)
+			TaskWorkList::Del(m_task_list, task);
+	}
 	inline Task * Fetch()
 	{
 		return TaskWorkList::Fetch(m_task_list);
@@ -167,6 +180,30 @@ public:
 	 
 	uint GetTasksQty();
 
+	// сведения о задаче для диагностики
+	struct TaskInfo
+	{
+		Task * m_task;
+		const char * m_name;
+		Task::State m_state;
+		Task::Priority m_priority;
+		Task::UnblockReason m_unblock_reason;
+		uint32_t m_run_ticks;
+		size_t m_stack_len;
+		size_t m_stack_usage;
+		StackPtr m_stack_margin;
+		StackPtr m_stack_top;
+	};
+	// снимок не более max задач с пиком стека; возвращает число всех задач.
+	// Под паузой копируются только сведения и границы стеков, стеки обходятся после нее
+	uint GetTasksInfo(TaskInfo * info, uint max);
+	// то же без своей паузы и без обхода стеков - для снимка вместе с другими данными
+	// под паузой вызывающего. Списки копируются при запрещенных прерываниях (их меняют и обработчики)
+	uint CopyTasksInfo(TaskInfo * info, uint max);
+	// пик стека по скопированным границам. Задача могла быть удалена после паузы:
+	// тогда читается освобожденная память и пик ее строки недостоверен, но чтение безопасно
+	static void ScanStacks(TaskInfo * info, uint count);
+
 private:
 	Scheduler();
 	~Scheduler();
@@ -174,19 +211,22 @@ private:
 	CLS_COPY(Scheduler)
 
 	bool UnblockTaskInternal(Task * task, Task::UnblockReason reason);
+	void CancelTimeout(Task * task);
 	void ForceContextSwitch();
 	void SelectNextTask();
 public:
 	StackPtr SwitchContext(StackPtr new_sp);
 	inline void TryContextSwitch()
 	{  
-		if (!m_pause_flg && m_pause_cnt == 0)
+		if (m_pause_cnt == 0)
 			System::SwitchContext();
 		else
 			m_pending_swc = true;
 	}
 private:
 	bool SysTickHandler();
+	uint32_t GetIdleTicks();
+	void StepTicks(uint32_t ticks);
 	bool IsContextSwitchRequired();
 	bool IsPriorityValid(Task::Priority priority);
 	void TuneProfiler();
@@ -204,6 +244,7 @@ private:
 	friend Result BlockCurrentTask_Priv(Scheduler * pS, uint32_t timeout_ms, Task::UnblockFunctor *);
 	friend Result DeleteTask_Priv(Scheduler * pS, Task * task, bool del_mem);
 	friend Result UnblockTask_Priv(Scheduler * pS, Task * task);
+	friend Result GetTasksInfo_Priv(Scheduler * pS, TaskInfo * info, uint * count);
 #if MACS_MUTEX_PRIORITY_INVERSION
 	friend Result IntSetTaskPriority_Priv(Scheduler * pS, Task * task, Task::Priority priority, bool internal_usage);
 #else
@@ -217,7 +258,9 @@ private:
 	friend class TaskSleepRoom;
 	friend class TaskWorkRoom;
 #endif		
+	friend class ConditionVariable;
 	friend class PauseSection;
+	friend class Power;
 	friend void MacsIrqHandler();
 
 	static Scheduler m_instance;
@@ -231,8 +274,7 @@ private:
 
 	bool m_initialized;
 	bool m_started;
-	bool m_pause_flg;
-	uint m_pause_cnt;
+	volatile uint m_pause_cnt;
 	bool m_pending_swc;
 	bool m_use_preemption;
 };
@@ -261,6 +303,7 @@ extern Result AddTaskIrq_Priv(Scheduler * pS, TaskIrq * task);
 extern void Yield_Priv(Scheduler * pS);
 extern Result DeleteTask_Priv(Scheduler * pS, Task * task, bool del_mem);
 extern Result UnblockTask_Priv(Scheduler * pS, Task * task);
+extern Result GetTasksInfo_Priv(Scheduler * pS, Scheduler::TaskInfo * info, uint * count);
 #if MACS_MUTEX_PRIORITY_INVERSION
 extern Result InfSetTaskPriority_Priv(Scheduler * pS, Task * task, Task::Priority priority, bool internal_usage);
 #endif
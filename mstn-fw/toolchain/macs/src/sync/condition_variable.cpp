@@ -0,0 +1,133 @@
+/** @copyright AstroSoft Ltd */
+
+#include "condition_variable.hpp"
+#include "critical_section.hpp"
+
+namespace macs
+{
+
+ConditionVariable::ConditionVariable() :
+		m_mutex(nullptr)
+{
+}
+
+ConditionVariable::~ConditionVariable()
+{
+	if (IsHolding())
+		DropLinks();
+}
+
+Result ConditionVariable::Wait(Mutex & mutex, uint32_t timeout_ms)
+{
+	if (!Sch().IsInitialized() || !Sch().IsStarted())
+		return ResultErrorInvalidState;
+
+	if (System::IsInInterrupt())
+		return ResultErrorInterruptNotSupported;
+
+	Result res = System::IsInPrivOrIrq() ? Wait_Priv(this, &mutex, timeout_ms) : SvcExecPrivileged(this, &mutex, reinterpret_cast<void*>(timeout_ms), EPM_ConditionVariable_Wait_Priv);
+	if (res != ResultOk)
+		return res;
+
+	if (Task::GetCurrent()->m_unblock_reason != Task::UnblockReasonTimeout)
+		return ResultOk;
+
+	mutex.Lock();
+	return ResultTimeout;
+}
+
+Result ConditionVariable::Wait_Priv(ConditionVariable * pC, Mutex * pM, uint32_t timeout_ms)
+{
+	CriticalSection _cs_;
+
+	if (pC->IsHolding() && pC->m_mutex != pM)
+		return ResultErrorInvalidArgs;
+
+#if MACS_SYNC_FAST_PATH
+	pM->Adopt();
+#endif
+
+	Task * cur_task = Task::GetCurrent();
+	if (!cur_task || pM->m_owner != cur_task || pM->m_lock_cnt != 1)
+		return ResultErrorInvalidState;
+
+	if (timeout_ms == 0)
+		return ResultTimeout;
+
+	pC->m_mutex = pM;
+	Result res = Mutex::Unlock_Priv(pM);
+	if (res != ResultOk)
+		return res;
+
+	return pC->BlockCurTask(timeout_ms);
+}
+
+Result ConditionVariable::NotifyOne()
+{
+	return Notify(false);
+}
+
+Result ConditionVariable::NotifyAll()
+{
+	return Notify(true);
+}
+
+Result ConditionVariable::Notify(bool all)
+{
+	if (!Sch().IsInitialized() || !Sch().IsStarted())
+		return ResultErrorInvalidState;
+
+	if (!System::IsSysCallAllowed())
+		return ResultErrorSysCallNotAllowed;
+
+	return System::IsInPrivOrIrq() ? Notify_Priv(this, all) : SvcExecPrivileged(this, reinterpret_cast<void*>(all), NULL, EPM_ConditionVariable_Notify_Priv);
+}
+
+Result ConditionVariable::Notify_Priv(ConditionVariable * pC, bool all)
+{
+	CriticalSection _cs_;
+
+	while (pC->IsHolding()) {
+		Task * task = TaskSyncList::Fetch(pC->m_blocked_task_list);
+		task->DropBlockSync(pC);
+		pC->Requeue(task);
+
+		if (!all)
+			break;
+	}
+
+	return ResultOk;
+}
+
+// свободный мьютекс отдается сразу, иначе задача ждет его без таймаута, как в Mutex::Lock
+void ConditionVariable::Requeue(Task * task)
+{
+	Mutex * pM = m_mutex;
+#if MACS_SYNC_FAST_PATH
+	pM->Adopt();
+#endif
+
+	if (!pM->m_owner) {
+		pM->Take(task);
+#if MACS_SYNC_STATS
+		pM->CountAcquire();
+#endif
+		Sch().UnblockTask(task);
+		return;
+	}
+
+	Sch().CancelTimeout(task);
+	TaskSyncList::Add(pM->m_blocked_task_list, task);
+	task->SetBlockSync(pM);
+#if MACS_SYNC_STATS
+	// ожидание условия закончилось, дальше время ожидания и пробуждение считает мьютекс
+	_ASSERT(task->m_stat_obj == this);
+	CountWake(task, Task::UnblockReasonRequest);
+	pM->CountBlock(task);
+#endif
+#if MACS_MUTEX_PRIORITY_INVERSION
+	pM->UpdateOwnerPriority();
+#endif
+}
+
+}
@@ -3,8 +3,77 @@
 #include "critical_section.hpp"
 #include "system.hpp"
 #include "application.hpp"
+#include "atomic.hpp"
 
 namespace macs
 {
 
+#if MACS_MASK_BUDGET_ENABLED
+
+MaskBudget::Stat MaskBudget::m_stat[KindCount];
+MaskBudget::Interval MaskBudget::m_open[KindCount];
+
+void MaskBudget::Reset()
+{
+	CriticalSection _cs_;
+	memset(m_stat, 0, sizeof(m_stat));
+}
+
+// вызов не встраивается: адрес возврата указывает в функцию, открывшую CriticalSection
+void __attribute__((noinline)) MaskBudget::EnterIrq()
+{
+	Enter(KindIrq, __builtin_return_address(0));
+}
+
+void MaskBudget::LeaveIrq()
+{
+	Leave(KindIrq, m_open[KindIrq]);
+}
+
+void MaskBudget::Enter(Kind kind, const void * addr)
+{
+	m_open[kind].m_addr = addr;
+	m_open[kind].m_start = System::GetCurCpuTick();
+}
+
+// интервалы паузы закрываются при разрешенных прерываниях, поэтому счетчики атомарные
+void MaskBudget::Leave(Kind kind, const Interval & interval)
+{
+	ulong cycles = System::GetCurCpuTick() - interval.m_start;
+	Stat & stat = m_stat[kind];
+
+	size_t bucket = cycles ? 31 - __builtin_clz(cycles) : 0;
+	AtomicFetchAdd(stat.m_hist[MIN(bucket, BUCKETS - 1)], 1ul, OrderRelaxed);
+	AtomicFetchAdd(stat.m_count, 1ul, OrderRelaxed);
+
+	ulong max = stat.m_max_cycles;
+	while (cycles > max)
+		if (AtomicCompareExchange(stat.m_max_cycles, max, cycles, OrderRelaxed)) {
+			stat.m_max_addr = interval.m_addr;
+			break;
+		}
+}
+
+void MaskBudget::Print(String & str, bool use_ns)
+{
+	static const CSPTR names[KindCount] = { "Irq masked", "Sched pause" };
+
+	str.Add("Masking budget:\n\r");
+	for (int i = 0; i < KindCount; ++i) {
+		const Stat & stat = m_stat[i];
+		str << PrnFmt("%12s:  Cnt=%-8lu  ", names[i], stat.m_count);
+		str << (!use_ns ? PrnFmt("TMax=%-8lu  ", stat.m_max_cycles) : PrnFmt("TMax(ns)=%-8lu  ", System::CpuTicksToNs(stat.m_max_cycles)));
+		str << PrnFmt("At=0x%08lx\r\n", reinterpret_cast<ulong>(stat.m_max_addr));
+
+		str << "    log2 hist:";
+		for (size_t b = 0; b < BUCKETS; ++b)
+			if (stat.m_hist[b])
+				str << PrnFmt(" %u:%lu", b, stat.m_hist[b]);
+		str << String::NEWLINE;
+	}
+	str.NewLine();
+}
+
+#endif
+
 }  
@@ -2,16 +2,27 @@
 
 #include <stdint.h> 
 #include "mutex.hpp"
+#include "semaphore.hpp"
 #include "application.hpp"
 #include "critical_section.hpp"
+#include "atomic.hpp"
 
 namespace macs
 {
 
 Mutex::~Mutex()
 {
+#if MACS_SYNC_FAST_PATH
+	if (m_state && m_state != STATE_KERNEL) {
+		App().OnAlarm(AR_OWNED_MUTEX_DESTR);
+		UnlinkFast(reinterpret_cast<Task *>(m_state));
+	}
+#endif
 	if (m_owner) {
 		App().OnAlarm(AR_OWNED_MUTEX_DESTR);
+#if MACS_SYNC_FAST_PATH
+		UnlinkFast(m_owner);
+#endif
 		m_owner->RemoveOwnedSync(this);
 	}
 	if (IsHolding()) {
@@ -25,6 +36,16 @@ Result Mutex::Lock(uint32_t timeout_ms)
 	if (System::IsInInterrupt())
 		return ResultErrorInterruptNotSupported;
 
+#if MACS_SYNC_FAST_PATH
+	Task * cur_task = Task::GetCurrent();
+	if (cur_task && TryLockFast(cur_task)) {
+#if MACS_SYNC_STATS
+		CountAcquire();
+#endif
+		return ResultOk;
+	}
+#endif
+
 	Result res = System::IsInPrivOrIrq() ? Lock_Priv(this, timeout_ms) : SvcExecPrivileged(this, reinterpret_cast<void*>(timeout_ms), NULL, EPM_Mutex_Lock_Priv);
 	if (res != ResultOk)
 		return res;
@@ -36,6 +57,10 @@ Result Mutex::Lock_Priv(Mutex * pM, uint32_t timeout_ms)
 {
 	CriticalSection _cs_;
 
+#if MACS_SYNC_FAST_PATH
+	pM->Adopt();
+#endif
+
 	Task * cur_task = Task::GetCurrent();
 	if (pM->m_owner == cur_task) {  
 		if (!cur_task)  
@@ -54,18 +79,22 @@ Result Mutex::Lock_Priv(Mutex * pM, uint32_t timeout_ms)
 		}
 
 		++pM->m_lock_cnt;
+#if MACS_SYNC_STATS
+		pM->CountAcquire();
+#endif
 		return ResultOk;
 	}
 	 
+	// нарушение протокола потолка: захватывающий выше потолка. Подъем другими мьютексами
+	// не в счет - вложенный захват мьютекса с более низким потолком законен
+	if (cur_task->GetBasePriority() > pM->m_ceiling && pM->m_ceiling != Task::PriorityIdle)
+		return ResultErrorInvalidArgs;
+
 	if (pM->m_owner == nullptr) {  
-		pM->m_owner = cur_task;
-#if MACS_MUTEX_PRIORITY_INVERSION
-		pM->m_owner_original_priority = cur_task->m_owned_obj_list ? cur_task->m_owned_obj_list->m_owner_original_priority : cur_task->GetPriority();
+		pM->Take(cur_task);
+#if MACS_SYNC_STATS
+		pM->CountAcquire();
 #endif
-		cur_task->AddOwnedSync(pM);
-
-		_ASSERT(pM->m_lock_cnt == 0);
-		pM->m_lock_cnt = 1;
 
 		cur_task->m_unblock_reason = Task::UnblockReasonNone;  
 
@@ -83,6 +112,12 @@ Result Mutex::Unlock()
 	if (System::IsInInterrupt())
 		return ResultErrorInterruptNotSupported;
 
+#if MACS_SYNC_FAST_PATH
+	Task * cur_task = Task::GetCurrent();
+	if (cur_task && TryUnlockFast(cur_task))
+		return ResultOk;
+#endif
+
 	return System::IsInPrivOrIrq() ? Unlock_Priv(this) : SvcExecPrivileged(this, NULL, NULL, EPM_Mutex_Unlock_Priv);
 }
 
@@ -90,6 +125,10 @@ Result Mutex::Unlock_Priv(Mutex * pM)
 {
 	CriticalSection _cs_;
 
+#if MACS_SYNC_FAST_PATH
+	pM->Adopt();
+#endif
+
 	Task * cur_task = Sch().GetCurrentTask();
 	if (!cur_task || pM->m_owner != cur_task)
 		return ResultErrorInvalidState;
@@ -99,50 +138,225 @@ Result Mutex::Unlock_Priv(Mutex * pM)
 	if (--pM->m_lock_cnt > 0)
 		return ResultOk;
 
-#if MACS_MUTEX_PRIORITY_INVERSION
-	Task::Priority inh_prior = pM->RemoveFromOwner();
+	Task::Priority inh_prior = pM->ReleaseOwner();
 	if (pM->m_owner->GetPriority() != inh_prior)
 		_SetTaskPriority_Priv(&Sch(), pM->m_owner, inh_prior);
-#else
-	pM->RemoveFromOwner();
-#endif
 	if (pM->IsHolding())
 		return pM->UnblockTask();
-	pM->m_owner = nullptr;
+	pM->SetFree();
+	if (pM->IsWatched())
+		pM->NotifyWatchers(true);
 	return ResultOk;
 }
 
-#if	MACS_MUTEX_PRIORITY_INVERSION
+Result Mutex::UnlockAndWait(Semaphore & sem, uint32_t timeout_ms)
+{
+	return UnlockAndBlock(&sem, timeout_ms);
+}
 
-extern Result IntSetTaskPriority_Priv(Scheduler * pS, Task * task, Task::Priority priority, bool internal_usage);
+Result Mutex::UnlockAndDelay(uint32_t timeout_ms)
+{
+	return UnlockAndBlock(nullptr, timeout_ms);
+}
 
-void Mutex::UpdateOwnerPriority()
+Result Mutex::UnlockAndBlock(Semaphore * sem, uint32_t timeout_ms)
 {
-	Task::Priority maxPriority = m_owner_original_priority;
-	if (IsHolding()) {
-		Task::Priority maxBlockedPriority = m_blocked_task_list->GetPriority();
-		if (maxBlockedPriority > maxPriority)
-			maxPriority = maxBlockedPriority;
+	if (!Sch().IsInitialized() || !Sch().IsStarted())
+		return ResultErrorInvalidState;
+
+	if (System::IsInInterrupt())
+		return ResultErrorInterruptNotSupported;
+
+	Result res = System::IsInPrivOrIrq() ? UnlockAndWait_Priv(this, sem, timeout_ms) : SvcExecPrivileged(this, sem, reinterpret_cast<void*>(timeout_ms), EPM_Mutex_UnlockAndWait_Priv);
+	if (res != ResultOk)
+		return res;
+
+	return Task::GetCurrent()->m_unblock_reason == Task::UnblockReasonTimeout ? ResultTimeout : ResultOk;
+}
+
+// разбуженный освобождением владелец получит процессор не раньше, чем текущая задача заблокируется
+Result Mutex::UnlockAndWait_Priv(Mutex * pM, Semaphore * pSem, uint32_t timeout_ms)
+{
+	CriticalSection _cs_;
+
+	Result res = Unlock_Priv(pM);
+	if (res != ResultOk)
+		return res;
+
+	if (pSem)
+		return Semaphore::Wait_Priv(pSem, timeout_ms);
+
+	return BlockCurrentTask_Priv(&Sch(), timeout_ms, nullptr);
+}
+
+void Mutex::Take(Task * task)
+{
+	m_owner = task;
+#if MACS_SYNC_FAST_PATH
+	m_state = STATE_KERNEL;
+#endif
+	m_owner_original_priority = task->GetBasePriority();
+	task->AddOwnedSync(this);
+
+	_ASSERT(m_lock_cnt == 0);
+	m_lock_cnt = 1;
+
+	// владелец - текущая или блокированная задача, ее нет в очереди готовых
+	if (m_ceiling > task->GetPriority())
+		_SetTaskPriority_Priv(&Sch(), task, m_ceiling);
+}
+
+// снимает мьютекс с владельца и возвращает положенный ему приоритет.
+// Без других захваченных объектов это исходный приоритет - O(1)
+Task::Priority Mutex::ReleaseOwner()
+{
+#if MACS_SYNC_FAST_PATH
+	// захваченный быстрым путем и взятый ядром на учет все еще в списке владельца
+	UnlinkFast(m_owner);
+#endif
+#if MACS_MUTEX_PRIORITY_INVERSION
+	return RemoveFromOwner();
+#else
+	RemoveFromOwner();
+	return m_ceiling != Task::PriorityIdle ? InheritedPriority() : m_owner->GetPriority();
+#endif
+}
+
+// наблюдаемый мьютекс ведет ядро: захват и освобождение быстрым путем прошли бы мимо наборов ожидания
+void Mutex::Watch()
+{
+#if MACS_SYNC_FAST_PATH
+	Adopt();
+	m_state = STATE_KERNEL;
+#endif
+}
+
+void Mutex::Unwatch()
+{
+#if MACS_SYNC_FAST_PATH
+	if (!IsWatched() && !m_owner)
+		m_state = 0;
+#endif
+}
+
+#if MACS_SYNC_FAST_PATH
+// захват свободного или повторный захват рекурсивного владельцем
+bool Mutex::TryLockFast(Task * cur_task)
+{
+	// подъем до потолка делает ядро
+	if (m_ceiling != Task::PriorityIdle)
+		return false;
+
+	// до записи в список задачи захват виден ядру через m_fast_pending
+	const uintptr_t self = reinterpret_cast<uintptr_t>(cur_task);
+	uintptr_t state = 0;
+	cur_task->m_fast_pending = this;
+	if (AtomicCompareExchange(m_state, state, self, OrderAcquire)) {
+		m_lock_cnt = 1;
+		LinkFast(cur_task);
+		cur_task->m_fast_pending = nullptr;
+		return true;
+	}
+	cur_task->m_fast_pending = nullptr;
+	// о вложенном захвате нерекурсивного и переполнении сообщит ядро
+	if (state != self || !m_recursive || m_lock_cnt == BYTE_MAX)
+		return false;
+	++m_lock_cnt;
+	return true;
+}
+
+// пока мьютекс не на учете ядра, счетчик меняет только владелец
+bool Mutex::TryUnlockFast(Task * cur_task)
+{
+	const uintptr_t self = reinterpret_cast<uintptr_t>(cur_task);
+	if (m_state != self)
+		return false;
+	if (m_lock_cnt > 1) {
+		--m_lock_cnt;
+		return true;
+	}
+
+	cur_task->m_fast_pending = this;
+	UnlinkFast(cur_task);
+	m_lock_cnt = 0;
+	uintptr_t state = self;
+	bool done = AtomicCompareExchange(m_state, state, 0, OrderRelease);
+	if (!done)
+		m_lock_cnt = 1;
+	cur_task->m_fast_pending = nullptr;
+	return done;
+}
+
+// захват с быстрого пути ставится на учет: владелец получает мьютекс в список и может наследовать приоритет
+void Mutex::Adopt()
+{
+	uintptr_t state = m_state;
+	if (!state || state == STATE_KERNEL)
+		return;
+
+	m_state = STATE_KERNEL;
+	m_owner = reinterpret_cast<Task *>(state);
+	m_owner_original_priority = m_owner->GetBasePriority();
+	m_owner->AddOwnedSync(this);
+}
+
+// список ведет сама задача: каждое изменение - одна запись, ядро может прочитать его в любой момент
+void Mutex::LinkFast(Task * task)
+{
+	m_next_fast = task->m_fast_mutex_list;
+	task->m_fast_mutex_list = this;
+}
+
+void Mutex::UnlinkFast(Task * task)
+{
+	Mutex * volatile * link = &task->m_fast_mutex_list;
+	while (*link && *link != this)
+		link = &(*link)->m_next_fast;
+	if (*link) {
+		*link = m_next_fast;
+		m_next_fast = nullptr;
 	}
+}
+
+// задача удалена, и к своему списку уже не вернется
+void Mutex::DropFastOwner(Task * task)
+{
+	CriticalSection _cs_;
 
-	if (m_owner->GetPriority() != maxPriority)
-		IntSetTaskPriority_Priv(&Sch(), m_owner, maxPriority, true);
+	const uintptr_t self = reinterpret_cast<uintptr_t>(task);
+	Mutex * pM = task->m_fast_pending;
+	task->m_fast_pending = nullptr;
+	if (pM && pM->m_state == self)
+		pM->DropFast();
+	while (task->m_fast_mutex_list) {
+		pM = task->m_fast_mutex_list;
+		task->m_fast_mutex_list = pM->m_next_fast;
+		pM->m_next_fast = nullptr;
+		if (pM->m_state == self)
+			pM->DropFast();
+	}
 }
 #endif
 
+#if	MACS_MUTEX_PRIORITY_INVERSION
+extern Result IntSetTaskPriority_Priv(Scheduler * pS, Task * task, Task::Priority priority, bool internal_usage);
+#endif
+
 Result Mutex::UnlockInternal()
 {
 #if MACS_MUTEX_PRIORITY_INVERSION
-	Task::Priority inh_prior = RemoveFromOwner();
+	Task::Priority inh_prior = ReleaseOwner();
 	if (m_owner->GetPriority() != inh_prior)
 		IntSetTaskPriority_Priv(&Sch(), m_owner, inh_prior, true);
 #else
-	RemoveFromOwner();
+	ReleaseOwner();
 #endif
 	if (IsHolding())
 		return UnblockTask();
 
-	m_owner = nullptr;
+	SetFree();
+	if (IsWatched())
+		NotifyWatchers(true);
 
 	return ResultOk;
 }
@@ -159,13 +373,7 @@ Result Mutex::BlockCurTask(uint32_t timeout_ms)
 Result Mutex::UnblockTask()
 {
 	_ASSERT(IsHolding());
-	m_owner = TaskSyncList::Fetch(m_blocked_task_list);
-	_ASSERT(m_lock_cnt == 0);
-	m_lock_cnt = 1;
-	m_owner->AddOwnedSync(this);
-#if MACS_MUTEX_PRIORITY_INVERSION
-	m_owner_original_priority = m_owner->GetPriority();
-#endif
+	Take(TaskSyncList::Fetch(m_blocked_task_list));
 	return Sch().UnblockTask(m_owner);
 }
 
@@ -190,8 +398,9 @@ void Mutex::OnDeleteTask(Task * task)
 		UpdateOwnerPriority();
 #endif
 	} else {
-		UnlockInternal();
+		// счетчик сбрасывается до передачи: новый владелец начинает с 1
 		m_lock_cnt = 0;
+		UnlockInternal();
 	}
 }
 
@@ -0,0 +1,292 @@
+/** @copyright AstroSoft Ltd */
+
+#include "rw_lock.hpp"
+#include "application.hpp"
+#include "critical_section.hpp"
+
+namespace macs
+{
+
+#if MACS_MUTEX_PRIORITY_INVERSION
+extern Result IntSetTaskPriority_Priv(Scheduler * pS, Task * task, Task::Priority priority, bool internal_usage);
+#endif
+
+RwLock::RwLock() :
+		m_reader_queue(*this),
+		m_readers(0)
+{
+	for (size_t i = 0; i < MACS_RWLOCK_MAX_READERS; ++i) {
+		m_holds[i].m_lock = this;
+		m_holds[i].m_task = nullptr;
+		m_holds[i].m_count = 0;
+		m_holds[i].m_next_hold = nullptr;
+	}
+}
+
+RwLock::~RwLock()
+{
+	if (m_owner) {
+		App().OnAlarm(AR_OWNED_MUTEX_DESTR);
+		m_owner->RemoveOwnedSync(this);
+	}
+	if (m_readers) {
+		App().OnAlarm(AR_OWNED_MUTEX_DESTR);
+		for (size_t i = 0; i < MACS_RWLOCK_MAX_READERS; ++i)
+			if (m_holds[i].m_task)
+				ReadHoldList::Del(m_holds[i].m_task->m_read_hold_list, &m_holds[i]);
+	}
+	if (IsHolding() || m_reader_queue.IsHolding()) {
+		App().OnAlarm(AR_BLOCKING_MUTEX_DESTR);
+		DropLinks();
+		m_reader_queue.Drop();
+	}
+}
+
+Result RwLock::LockRead(uint32_t timeout_ms)
+{
+	return Lock(timeout_ms, false);
+}
+
+Result RwLock::UnlockRead()
+{
+	return Unlock(false);
+}
+
+Result RwLock::LockWrite(uint32_t timeout_ms)
+{
+	return Lock(timeout_ms, true);
+}
+
+Result RwLock::UnlockWrite()
+{
+	return Unlock(true);
+}
+
+Result RwLock::Lock(uint32_t timeout_ms, bool write)
+{
+	if (!Sch().IsInitialized() || !Sch().IsStarted())
+		return ResultErrorInvalidState;
+
+	if (System::IsInInterrupt())
+		return ResultErrorInterruptNotSupported;
+
+	Result res = System::IsInPrivOrIrq() ? Lock_Priv(this, timeout_ms, write) : SvcExecPrivileged(this, reinterpret_cast<void*>(timeout_ms), reinterpret_cast<void*>(write), EPM_RwLock_Lock_Priv);
+	if (res != ResultOk)
+		return res;
+
+	return Task::GetCurrent()->m_unblock_reason == Task::UnblockReasonTimeout ? ResultTimeout : ResultOk;
+}
+
+Result RwLock::Unlock(bool write)
+{
+	if (!Sch().IsInitialized() || !Sch().IsStarted())
+		return ResultErrorInvalidState;
+
+	if (System::IsInInterrupt())
+		return ResultErrorInterruptNotSupported;
+
+	return System::IsInPrivOrIrq() ? Unlock_Priv(this, write) : SvcExecPrivileged(this, reinterpret_cast<void*>(write), NULL, EPM_RwLock_Unlock_Priv);
+}
+
+Result RwLock::Lock_Priv(RwLock * pL, uint32_t timeout_ms, bool write)
+{
+	CriticalSection _cs_;
+
+	Task * cur_task = Task::GetCurrent();
+	if (pL->m_owner == cur_task) {
+		App().OnAlarm(AR_NESTED_MUTEX_LOCK);
+		return ResultErrorInvalidState;
+	}
+
+	ReadHold * hold = pL->FindHold(cur_task);
+	if (hold && write) {
+		// читатель ждал бы сам себя
+		App().OnAlarm(AR_NESTED_MUTEX_LOCK);
+		return ResultErrorInvalidState;
+	}
+
+	// ожидающий писатель закрывает вход новым читателям, но не тем, кто уже читает
+	bool free = write ? !pL->m_owner && !pL->m_readers : hold || (!pL->m_owner && !pL->IsHolding() && pL->m_readers < MACS_RWLOCK_MAX_READERS);
+	if (free) {
+		if (write)
+			pL->TakeWrite(cur_task);
+		else if (hold)
+			++hold->m_count;
+		else
+			pL->TakeRead(cur_task);
+#if MACS_SYNC_STATS
+		pL->CountAcquire();
+#endif
+
+		cur_task->m_unblock_reason = Task::UnblockReasonNone;
+		return ResultOk;
+	}
+
+	if (timeout_ms == 0)
+		return ResultTimeout;
+
+	Result res = write ? pL->BlockCurTask(timeout_ms) : pL->m_reader_queue.BlockCurTask(timeout_ms);
+	pL->UpdateOwnerPriority();
+	return res;
+}
+
+Result RwLock::Unlock_Priv(RwLock * pL, bool write)
+{
+	CriticalSection _cs_;
+
+	if (write) {
+		if (!pL->m_owner || pL->m_owner != Task::GetCurrent())
+			return ResultErrorInvalidState;
+
+		pL->ReleaseWrite();
+		return ResultOk;
+	}
+
+	ReadHold * hold = pL->FindHold(Task::GetCurrent());
+	if (!hold)
+		return ResultErrorInvalidState;
+
+	if (--hold->m_count == 0)
+		pL->ReleaseRead(hold);
+
+	return ResultOk;
+}
+
+void RwLock::DropReader(Task * task)
+{
+	while (task->m_read_hold_list) {
+		ReadHold * hold = task->m_read_hold_list;
+		hold->m_lock->ReleaseRead(hold);
+	}
+}
+
+Task * RwLock::TopWaiter() const
+{
+	Task * writer = m_blocked_task_list;
+	Task * reader = m_reader_queue.m_blocked_task_list;
+	if (!writer || !reader)
+		return writer ? writer : reader;
+	return reader->GetPriority() > writer->GetPriority() ? reader : writer;
+}
+
+ReadHold * RwLock::FindHold(Task * task)
+{
+	if (!m_readers)
+		return nullptr;
+	for (size_t i = 0; i < MACS_RWLOCK_MAX_READERS; ++i)
+		if (m_holds[i].m_task == task)
+			return &m_holds[i];
+	return nullptr;
+}
+
+void RwLock::TakeRead(Task * task)
+{
+	_ASSERT(m_readers < MACS_RWLOCK_MAX_READERS);
+	ReadHold * hold = m_holds;
+	while (hold->m_task)
+		++hold;
+	hold->m_task = task;
+	hold->m_count = 1;
+	ReadHoldList::Add(task->m_read_hold_list, hold);
+	++m_readers;
+}
+
+// последний читатель пропускает писателя, освободившаяся строка - ждущего читателя
+void RwLock::ReleaseRead(ReadHold * hold)
+{
+	ReadHoldList::Del(hold->m_task->m_read_hold_list, hold);
+	hold->m_task = nullptr;
+	hold->m_count = 0;
+	--m_readers;
+
+	if (IsHolding()) {
+		if (!m_readers)
+			GrantWriter();
+	} else if (!m_owner) {
+		WakeReaders();
+	}
+}
+
+void RwLock::TakeWrite(Task * task)
+{
+	m_owner = task;
+	m_owner_original_priority = task->GetBasePriority();
+	task->AddOwnedSync(this);
+}
+
+// писатель уходит: следующему писателю, а без них - всем ждущим читателям
+void RwLock::ReleaseWrite()
+{
+#if MACS_MUTEX_PRIORITY_INVERSION
+	Task::Priority inh_prior = RemoveFromOwner();
+	if (m_owner->GetPriority() != inh_prior)
+		IntSetTaskPriority_Priv(&Sch(), m_owner, inh_prior, true);
+#else
+	RemoveFromOwner();
+#endif
+	m_owner = nullptr;
+
+	if (IsHolding())
+		GrantWriter();
+	else
+		WakeReaders();
+}
+
+void RwLock::GrantWriter()
+{
+	_ASSERT(!m_owner && !m_readers);
+	Task * task = TaskSyncList::Fetch(m_blocked_task_list);
+	task->DropBlockSync(this);
+	TakeWrite(task);
+	UpdateOwnerPriority();
+	Sch().UnblockTask(task);
+}
+
+void RwLock::WakeReaders()
+{
+	while (m_reader_queue.IsHolding() && m_readers < MACS_RWLOCK_MAX_READERS) {
+		TakeRead(m_reader_queue.m_blocked_task_list);
+		m_reader_queue.UnblockTask();
+	}
+}
+
+// ожидающий писатель ушел по таймауту или удален
+void RwLock::OnWaiterGone()
+{
+	if (!m_owner && !IsHolding())
+		WakeReaders();
+	else
+		UpdateOwnerPriority();
+}
+
+void RwLock::OnUnblockTask(Task * task, Task::UnblockReason reason)
+{
+	SyncObject::OnUnblockTask(task, reason);
+	if (reason == Task::UnblockReasonTimeout)
+		OnWaiterGone();
+}
+
+void RwLock::OnDeleteTask(Task * task)
+{
+	if (task == m_owner) {
+		ReleaseWrite();
+		return;
+	}
+	SyncObject::OnDeleteTask(task);
+	OnWaiterGone();
+}
+
+void RwLock::ReaderQueue::OnUnblockTask(Task * task, Task::UnblockReason reason)
+{
+	SyncObject::OnUnblockTask(task, reason);
+	if (reason == Task::UnblockReasonTimeout)
+		m_lock.UpdateOwnerPriority();
+}
+
+void RwLock::ReaderQueue::OnDeleteTask(Task * task)
+{
+	SyncObject::OnDeleteTask(task);
+	m_lock.UpdateOwnerPriority();
+}
+
+}
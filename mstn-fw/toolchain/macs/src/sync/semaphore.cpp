@@ -2,13 +2,14 @@
 
 #include "critical_section.hpp"
 #include "semaphore.hpp"
+#include "atomic.hpp"
 
 namespace macs
 {
 
 Semaphore::Semaphore(size_t start_count, size_t max_count) :
-		m_count(start_count <= max_count ? start_count : max_count),
-		m_max_count(max_count)
+		m_count(MIN(start_count, MIN(max_count, WAITERS_FLAG - 1))),
+		m_max_count(MIN(max_count, WAITERS_FLAG - 1))
 {
 }
 
@@ -29,6 +30,15 @@ Result Semaphore::Wait(uint32_t timeout_ms)
 			return ResultErrorInterruptNotSupported;
 	}
 
+#if MACS_SYNC_FAST_PATH
+	if (TryWaitFast()) {
+#if MACS_SYNC_STATS
+		CountAcquire();
+#endif
+		return ResultOk;
+	}
+#endif
+
 	Result res = System::IsInPrivOrIrq() ? Wait_Priv(this, timeout_ms) : SvcExecPrivileged(this, reinterpret_cast<void*>(timeout_ms), NULL, EPM_Semaphore_Wait_Priv);
 	if (res != ResultOk)
 		return res;
@@ -42,6 +52,9 @@ Result Semaphore::Wait_Priv(Semaphore * pS, uint32_t timeout_ms)
 
 	Task * currentTask = Task::GetCurrent();
 	if (pS->TryDecrement()) {
+#if MACS_SYNC_STATS
+		pS->CountAcquire();
+#endif
 		currentTask->m_unblock_reason = Task::UnblockReasonNone;  
 		return ResultOk;
 	}
@@ -49,7 +62,9 @@ Result Semaphore::Wait_Priv(Semaphore * pS, uint32_t timeout_ms)
 	if (timeout_ms == 0)
 		return ResultTimeout;
 
-	return pS->BlockCurTask(timeout_ms);
+	Result res = pS->BlockCurTask(timeout_ms);
+	pS->UpdateWaitersFlag();
+	return res;
 }
 
 Result Semaphore::Signal()
@@ -60,6 +75,11 @@ Result Semaphore::Signal()
 	if (!System::IsSysCallAllowed())
 		return ResultErrorSysCallNotAllowed;
 
+#if MACS_SYNC_FAST_PATH
+	if (TrySignalFast())
+		return ResultOk;
+#endif
+
 	return System::IsInPrivOrIrq() ? Signal_Priv(this) : SvcExecPrivileged(this, NULL, NULL, EPM_Semaphore_Signal_Priv);
 }
 
@@ -67,15 +87,86 @@ Result Semaphore::Signal_Priv(Semaphore * pS)
 {
 	CriticalSection _cs_;
 
-	if (pS->m_count == pS->m_max_count)
+	if (pS->GetCurrentCount() == pS->m_max_count)
 		return ResultErrorInvalidState;
 
-	if (pS->IsHolding())
-		return pS->UnblockTask();
+	if (pS->IsHolding()) {
+		Result res = pS->UnblockTask();
+		pS->UpdateWaitersFlag();
+		return res;
+	}
 
 	++pS->m_count;
+	if (pS->IsWatched())
+		pS->NotifyWatchers();
 
 	return ResultOk;
 }
 
+Result Semaphore::SignalAndWait(Semaphore & signal, Semaphore & wait, uint32_t timeout_ms)
+{
+	if (!Sch().IsInitialized() || !Sch().IsStarted())
+		return ResultErrorInvalidState;
+
+	if (System::IsInInterrupt())
+		return ResultErrorInterruptNotSupported;
+
+	Result res = System::IsInPrivOrIrq() ? SignalAndWait_Priv(&signal, &wait, timeout_ms) : SvcExecPrivileged(&signal, &wait, reinterpret_cast<void*>(timeout_ms), EPM_Semaphore_SignalAndWait_Priv);
+	if (res != ResultOk)
+		return res;
+
+	return Task::GetCurrent()->m_unblock_reason == Task::UnblockReasonTimeout ? ResultTimeout : ResultOk;
+}
+
+// разбуженная сигналом задача получит процессор не раньше, чем текущая заблокируется
+Result Semaphore::SignalAndWait_Priv(Semaphore * pSig, Semaphore * pWait, uint32_t timeout_ms)
+{
+	CriticalSection _cs_;
+
+	// ожидание проверяется до сигнала: после поданного сигнала возможны только ResultOk и ResultTimeout
+	if (!Task::GetCurrent()->IsRunnable())
+		return ResultErrorInvalidState;
+
+	Result res = Signal_Priv(pSig);
+	if (res != ResultOk)
+		return res;
+
+	return Wait_Priv(pWait, timeout_ms);
+}
+
+void Semaphore::OnUnblockTask(Task * task, Task::UnblockReason reason)
+{
+	SyncObject::OnUnblockTask(task, reason);
+	UpdateWaitersFlag();
+}
+
+void Semaphore::OnDeleteTask(Task * task)
+{
+	SyncObject::OnDeleteTask(task);
+	UpdateWaitersFlag();
+}
+
+#if MACS_SYNC_FAST_PATH
+bool Semaphore::TryWaitFast()
+{
+	size_t count = m_count;
+	do {
+		if (!(count & ~WAITERS_FLAG))
+			return false;
+	} while (!AtomicCompareExchange(m_count, count, count - 1, OrderAcquire));
+	return true;
+}
+
+// будить ожидающих и сообщать о переполнении - дело ядра
+bool Semaphore::TrySignalFast()
+{
+	size_t count = m_count;
+	do {
+		if ((count & WAITERS_FLAG) || count >= m_max_count)
+			return false;
+	} while (!AtomicCompareExchange(m_count, count, count + 1, OrderRelease));
+	return true;
+}
+#endif
+
 }  
@@ -0,0 +1,274 @@
+/** @copyright AstroSoft Ltd */
+
+#include "critical_section.hpp"
+#include "wait_set.hpp"
+
+namespace macs
+{
+
+bool SyncObject::NotifyWatchers(bool single)
+{
+	bool fired = false;
+	WaitEntry * entry = m_watch_list;
+	while (entry) {
+		// сработавший набор снимает только свои элементы
+		WaitEntry * next = WaitEntryList::Next(entry);
+		if (entry->m_set->Notify(entry)) {
+			fired = true;
+			if (single)
+				break;
+		}
+		entry = next;
+	}
+	return fired;
+}
+
+WaitSet::WaitSet() :
+		m_count(0),
+		m_fired(0),
+		m_all(false)
+{
+}
+
+WaitSet::~WaitSet()
+{
+	CriticalSection _cs_;
+
+	Disarm();
+	DropLinks();
+}
+
+Result WaitSet::Add(Semaphore & sem)
+{
+	return Add(sem, WaitEntry::KindSemaphore);
+}
+
+Result WaitSet::Add(Mutex & mutex)
+{
+	return Add(mutex, WaitEntry::KindMutex);
+}
+
+Result WaitSet::Add(Event & event)
+{
+	return Add(event, WaitEntry::KindEvent);
+}
+
+Result WaitSet::Add(SyncObject & obj, WaitEntry::Kind kind)
+{
+	CriticalSection _cs_;
+
+	if (IsHolding())
+		return ResultErrorInvalidState;
+
+	if (m_count == MAX_OBJECTS)
+		return ResultErrorInvalidArgs;
+
+	for (size_t i = 0; i < m_count; ++i)
+		if (m_entries[i].m_obj == &obj)
+			return ResultErrorInvalidArgs;
+
+	WaitEntry & entry = m_entries[m_count++];
+	entry.m_obj = &obj;
+	entry.m_set = this;
+	entry.m_kind = kind;
+	entry.m_fired = false;
+	entry.m_next_watch = nullptr;
+	entry.m_prev_watch = nullptr;
+
+	return ResultOk;
+}
+
+Result WaitSet::Clear()
+{
+	CriticalSection _cs_;
+
+	if (IsHolding())
+		return ResultErrorInvalidState;
+
+	m_count = 0;
+	return ResultOk;
+}
+
+Result WaitSet::WaitAny(size_t & index, uint32_t timeout_ms)
+{
+	Result res = Wait(timeout_ms, false);
+	if (res == ResultOk)
+		index = m_fired;
+	return res;
+}
+
+Result WaitSet::WaitAll(uint32_t timeout_ms)
+{
+	return Wait(timeout_ms, true);
+}
+
+Result WaitSet::Wait(uint32_t timeout_ms, bool all)
+{
+	if (!Sch().IsInitialized() || !Sch().IsStarted())
+		return ResultErrorInvalidState;
+
+	if (System::IsInInterrupt())
+		return ResultErrorInterruptNotSupported;
+
+	Result res = System::IsInPrivOrIrq() ? Wait_Priv(this, timeout_ms, all) : SvcExecPrivileged(this, reinterpret_cast<void*>(timeout_ms), reinterpret_cast<void*>(all), EPM_WaitSet_Wait_Priv);
+	if (res != ResultOk)
+		return res;
+
+	return Task::GetCurrent()->m_unblock_reason == Task::UnblockReasonTimeout ? ResultTimeout : ResultOk;
+}
+
+Result WaitSet::Wait_Priv(WaitSet * pW, uint32_t timeout_ms, bool all)
+{
+	CriticalSection _cs_;
+
+	if (pW->IsHolding())
+		return ResultErrorInvalidState;
+
+	if (!pW->m_count)
+		return ResultErrorInvalidArgs;
+
+	pW->m_all = all;
+	for (size_t i = 0; i < pW->m_count; ++i)
+		pW->m_entries[i].m_fired = false;
+
+	Task * cur_task = Task::GetCurrent();
+	if (pW->TryComplete(cur_task)) {
+		cur_task->m_unblock_reason = Task::UnblockReasonNone;
+		return ResultOk;
+	}
+
+	if (timeout_ms == 0)
+		return ResultTimeout;
+
+	pW->Arm();
+	return pW->BlockCurTask(timeout_ms);
+}
+
+bool WaitSet::IsReady(const WaitEntry & entry, Task * task) const
+{
+	switch (entry.m_kind) {
+	case WaitEntry::KindSemaphore:
+	case WaitEntry::KindQueue:
+		return static_cast<Semaphore *>(entry.m_obj)->GetCurrentCount() != 0;
+	case WaitEntry::KindMutex:
+	{
+		Mutex * mutex = static_cast<Mutex *>(entry.m_obj);
+		Task * owner = mutex->GetOwner();
+		if (owner == task)
+			return mutex->m_recursive && mutex->m_lock_cnt < BYTE_MAX;
+		return !owner;
+	}
+	case WaitEntry::KindEvent:
+		return entry.m_fired;
+	}
+	return false;
+}
+
+void WaitSet::Acquire(WaitEntry & entry, Task * task)
+{
+#if MACS_SYNC_STATS
+	if (entry.m_kind == WaitEntry::KindSemaphore || entry.m_kind == WaitEntry::KindMutex)
+		entry.m_obj->CountAcquire();
+#endif
+	switch (entry.m_kind) {
+	case WaitEntry::KindSemaphore:
+		static_cast<Semaphore *>(entry.m_obj)->TryDecrement();
+		break;
+	case WaitEntry::KindMutex:
+	{
+		Mutex * mutex = static_cast<Mutex *>(entry.m_obj);
+#if MACS_SYNC_FAST_PATH
+		mutex->Adopt();
+#endif
+		if (mutex->m_owner == task)
+			++mutex->m_lock_cnt;
+		else
+			mutex->Take(task);
+	}
+		break;
+	case WaitEntry::KindEvent:
+		entry.m_fired = false;
+		break;
+	case WaitEntry::KindQueue:
+		break;
+	}
+}
+
+// для задачи task: забирает один готовый объект или все сразу
+bool WaitSet::TryComplete(Task * task)
+{
+	if (!m_all) {
+		for (size_t i = 0; i < m_count; ++i)
+			if (IsReady(m_entries[i], task)) {
+				Acquire(m_entries[i], task);
+				m_fired = i;
+				return true;
+			}
+		return false;
+	}
+
+	for (size_t i = 0; i < m_count; ++i)
+		if (!IsReady(m_entries[i], task))
+			return false;
+	for (size_t i = 0; i < m_count; ++i)
+		Acquire(m_entries[i], task);
+	m_fired = m_count - 1;
+	return true;
+}
+
+void WaitSet::Arm()
+{
+	for (size_t i = 0; i < m_count; ++i) {
+		WaitEntry & entry = m_entries[i];
+		WaitEntryList::Add(entry.m_obj->m_watch_list, &entry);
+		if (entry.m_kind == WaitEntry::KindSemaphore || entry.m_kind == WaitEntry::KindQueue)
+			static_cast<Semaphore *>(entry.m_obj)->UpdateWaitersFlag();
+		else if (entry.m_kind == WaitEntry::KindMutex)
+			static_cast<Mutex *>(entry.m_obj)->Watch();
+	}
+}
+
+void WaitSet::Disarm()
+{
+	for (size_t i = 0; i < m_count; ++i) {
+		WaitEntry & entry = m_entries[i];
+		if (!WaitEntryList::IsLinked(&entry))
+			continue;
+		WaitEntryList::Del(entry.m_obj->m_watch_list, &entry);
+		if (entry.m_kind == WaitEntry::KindSemaphore || entry.m_kind == WaitEntry::KindQueue)
+			static_cast<Semaphore *>(entry.m_obj)->UpdateWaitersFlag();
+		else if (entry.m_kind == WaitEntry::KindMutex)
+			static_cast<Mutex *>(entry.m_obj)->Unwatch();
+	}
+}
+
+// из критической секции объекта entry, ставшего доступным
+bool WaitSet::Notify(WaitEntry * entry)
+{
+	if (!IsHolding())
+		return false;
+
+	if (entry->m_kind == WaitEntry::KindEvent)
+		entry->m_fired = true;
+
+	if (!TryComplete(m_blocked_task_list))
+		return false;
+
+	Disarm();
+	UnblockTask();
+	return true;
+}
+
+void WaitSet::OnUnblockTask(Task * task, Task::UnblockReason reason)
+{
+	SyncObject::OnUnblockTask(task, reason);
+	Disarm();
+}
+
+void WaitSet::OnDeleteTask(Task * task)
+{
+	SyncObject::OnDeleteTask(task);
+	Disarm();
+}
+
+}
@@ -7,6 +7,8 @@
 #include "critical_section.hpp"
 #include "scheduler.hpp"
 #include "stack_frame.hpp"
+#include "rw_lock.hpp"
+#include "mutex.hpp"
 
 namespace macs
 {
@@ -25,11 +27,35 @@ void Task::Init(const char * name, size_t stack_len, uint32_t * stack_mem)
 #endif		
 
 	m_dream_ticks = 0;
+	m_run_ticks = 0;
 	m_next_sched_task = nullptr;
+	m_prev_sched_task = nullptr;
 	m_next_sync_task = nullptr;
+	m_prev_sync_task = nullptr;
 	m_unblock_func = nullptr;
 	m_owned_obj_list = nullptr;
+	m_read_hold_list = nullptr;
+#if MACS_SYNC_FAST_PATH
+	m_fast_mutex_list = nullptr;
+	m_fast_pending = nullptr;
+#endif
 	m_unblock_reason = UnblockReasonNone;
+	m_notify_value = 0;
+	m_notify_clear = 0;
+	m_notify_taken = 0;
+	m_notify_pending = false;
+	m_notify_waiting = false;
+#if MACS_EDF_ENABLED
+	m_period_ticks = 0;
+	m_deadline_ticks = 0;
+	m_release = 0;
+	m_deadline = 0;
+	m_deadline_misses = 0;
+#endif
+#if MACS_SYNC_STATS
+	m_stat_obj = nullptr;
+	m_block_start = 0;
+#endif
 
 	if (name) {
 #if MACS_TASK_NAME_LENGTH > 0	 
@@ -107,6 +133,142 @@ void Task::Yield()
 	Sch().Yield();
 }
 
+Result Task::Notify(Task * task, uint32_t bits, NotifyAction action)
+{
+	if (!Sch().IsInitialized() || !Sch().IsStarted())
+		return ResultErrorInvalidState;
+
+	if (!System::IsSysCallAllowed())
+		return ResultErrorSysCallNotAllowed;
+
+	if (!task)
+		return ResultErrorInvalidArgs;
+
+	return System::IsInPrivOrIrq() ? Notify_Priv(task, bits, action) : SvcExecPrivileged(task, reinterpret_cast<void*>(bits), reinterpret_cast<void*>(action), EPM_Task_Notify_Priv);
+}
+
+Result Task::Notify_Priv(Task * task, uint32_t bits, NotifyAction action)
+{
+	CriticalSection _cs_;
+
+	if (task->m_state == StateInactive)
+		return ResultErrorInvalidState;
+
+	switch (action) {
+	case NotifySetBits:
+		task->m_notify_value |= bits;
+		break;
+	case NotifyIncrement:
+		++task->m_notify_value;
+		break;
+	case NotifyNoOverwrite:
+		if (task->m_notify_pending)
+			return ResultErrorInvalidState;
+		task->m_notify_value = bits;
+		break;
+	case NotifyOverwrite:
+		task->m_notify_value = bits;
+		break;
+	default:
+		return ResultErrorInvalidArgs;
+	}
+	task->m_notify_pending = true;
+
+	// ожидающей задаче слово отдается сразу, до пробуждения
+	if (!task->m_notify_waiting)
+		return ResultOk;
+	task->TakeNotify(task->m_notify_clear);
+	return UnblockTask_Priv(&Sch(), task);
+}
+
+Result Task::WaitNotify(uint32_t clear_mask, uint32_t timeout_ms, uint32_t * value)
+{
+	if (!Sch().IsInitialized() || !Sch().IsStarted())
+		return ResultErrorInvalidState;
+
+	if (System::IsInInterrupt())
+		return ResultErrorInterruptNotSupported;
+
+	Result res = System::IsInPrivOrIrq() ? WaitNotify_Priv(clear_mask, timeout_ms) : SvcExecPrivileged(reinterpret_cast<void*>(clear_mask), reinterpret_cast<void*>(timeout_ms), NULL, EPM_Task_WaitNotify_Priv);
+	if (res != ResultOk)
+		return res;
+
+	Task * cur_task = GetCurrent();
+	if (cur_task->m_unblock_reason == UnblockReasonTimeout)
+		return ResultTimeout;
+
+	if (value)
+		*value = cur_task->m_notify_taken;
+	return ResultOk;
+}
+
+Result Task::WaitNotify_Priv(uint32_t clear_mask, uint32_t timeout_ms)
+{
+	CriticalSection _cs_;
+
+	Task * cur_task = GetCurrent();
+	if (cur_task->m_notify_pending) {
+		cur_task->TakeNotify(clear_mask);
+		cur_task->m_unblock_reason = UnblockReasonNone;
+		return ResultOk;
+	}
+
+	if (timeout_ms == 0)
+		return ResultTimeout;
+
+	cur_task->m_notify_clear = clear_mask;
+	cur_task->m_notify_waiting = true;
+	return BlockCurrentTask_Priv(&Sch(), timeout_ms, nullptr);
+}
+
+#if MACS_EDF_ENABLED
+// поля сроков меняет только сама задача, пока она выполняется и не стоит ни в одной очереди
+Result Task::SetPeriod(uint32_t period_ms, uint32_t deadline_ms)
+{
+	Task * cur_task = GetCurrent();
+	if (!cur_task)
+		return ResultErrorInvalidState;
+
+	uint32_t period_ticks = MsToTicks(period_ms);
+	uint32_t deadline_ticks = deadline_ms ? MsToTicks(deadline_ms) : period_ticks;
+	if ((period_ms && !period_ticks) || deadline_ticks > period_ticks || (period_ticks && !deadline_ticks))
+		return ResultErrorInvalidArgs;
+
+	cur_task->m_period_ticks = period_ticks;
+	cur_task->m_deadline_ticks = deadline_ticks;
+	cur_task->m_release = Sch().GetTickCount();
+	cur_task->m_deadline = cur_task->m_release + deadline_ticks;
+	cur_task->m_deadline_misses = 0;
+	return ResultOk;
+}
+
+Result Task::WaitNextPeriod()
+{
+	Task * cur_task = GetCurrent();
+	if (!cur_task || !cur_task->m_period_ticks)
+		return ResultErrorInvalidState;
+
+	tick_t now = Sch().GetTickCount();
+	if ((int32_t)(now - cur_task->m_deadline) > 0)
+		++cur_task->m_deadline_misses;
+
+	// опоздавшая задача выпускается сразу, пропущенные периоды не догоняются
+	cur_task->m_release += cur_task->m_period_ticks;
+	if ((int32_t)(cur_task->m_release - now) < 0)
+		cur_task->m_release = now;
+	cur_task->m_deadline = cur_task->m_release + cur_task->m_deadline_ticks;
+
+	uint32_t left = cur_task->m_release - now;
+	if (!left) {
+		Yield();
+		return ResultOk;
+	}
+
+	Result res = Delay((TicksToUs(left) + 999) / 1000);
+	return res == ResultTimeout ? ResultOk : res;
+}
+#endif
+
 void Task::SetBlockSync(SyncObject * sync_obj)
 {
 	_ASSERT(sync_obj);
@@ -121,6 +283,12 @@ void Task::AddOwnedSync(SyncOwnedObject * sync_obj)
 	OwnedSyncObjList::Add(m_owned_obj_list, sync_obj);
 }
 
+// все захваченные объекты помнят один и тот же исходный приоритет владельца
+Task::Priority Task::GetBasePriority() const
+{
+	return m_owned_obj_list ? m_owned_obj_list->m_owner_original_priority : m_priority;
+}
+
 void Task::DropBlockSync(SyncObject * sync_obj)
 {
 	_ASSERT(sync_obj);_ASSERT(m_unblock_func == sync_obj);
@@ -143,6 +311,10 @@ void Task::DetachFromSync()
 	}
 	while (m_owned_obj_list)
 		m_owned_obj_list->OnDeleteTask(this);
+	RwLock::DropReader(this);
+#if MACS_SYNC_FAST_PATH
+	Mutex::DropFastOwner(this);
+#endif
 }
 
 void PrintPriority(String & str, Task::Priority prior, bool brief)
@@ -184,11 +356,74 @@ void PrintPriority(String & str, Task::Priority prior, bool brief)
 	}
 }
 
+#if MACS_SYNC_STATS
+DLIST_DECLARE(SyncStatList, SyncObject, m_next_stat_obj, m_prev_stat_obj);
+
+SyncObject * SyncObject::m_stat_list = nullptr;
+
+void SyncObject::LinkStat(bool link)
+{
+	if (link) {
+		m_next_stat_obj = nullptr;
+		m_prev_stat_obj = nullptr;
+	}
+	System::IsInPrivOrIrq() ? LinkStat_Priv(this, link) : SvcExecPrivileged(this, reinterpret_cast<void*>(link), NULL, EPM_SyncObject_LinkStat_Priv);
+}
+
+Result SyncObject::LinkStat_Priv(SyncObject * obj, bool link)
+{
+	CriticalSection _cs_;
+
+	if (link)
+		SyncStatList::Add(m_stat_list, obj);
+	else
+		SyncStatList::Del(m_stat_list, obj);
+	return ResultOk;
+}
+
+SyncObject::~SyncObject()
+{
+	LinkStat(false);
+}
+
+void SyncObject::ResetStats()
+{
+	memset(&m_stats, 0, sizeof(m_stats));
+}
+
+// длина очереди считается только на пути с блокировкой
+void SyncObject::CountBlock(Task * task)
+{
+	++m_stats.m_contended;
+	ulong queue = TaskSyncList::Qty(m_blocked_task_list);
+	if (queue > m_stats.m_max_queue)
+		m_stats.m_max_queue = queue;
+	task->m_stat_obj = this;
+	task->m_block_start = System::GetCurCpuTick();
+}
+
+void SyncObject::CountWake(Task * task, Task::UnblockReason reason)
+{
+	ulong cycles = System::GetCurCpuTick() - task->m_block_start;
+	m_stats.m_blocked_cycles += cycles;
+	if (cycles > m_stats.m_max_blocked_cycles)
+		m_stats.m_max_blocked_cycles = cycles;
+
+	if (reason == Task::UnblockReasonTimeout)
+		++m_stats.m_timeouts;
+	else
+		++m_stats.m_acquires;
+}
+#endif
+
 Result SyncObject::BlockCurTask(uint32_t timeout_ms)
 {
 	Task * cur_task = Sch().GetCurrentTask();
 	TaskSyncList::Add(m_blocked_task_list, cur_task);
 	cur_task->SetBlockSync(this);
+#if MACS_SYNC_STATS
+	CountBlock(cur_task);
+#endif
 	return BlockCurrentTask_Priv(&Sch(), timeout_ms, this);
 }
 
@@ -205,6 +440,9 @@ void SyncObject::DropLinks()
 	while (m_blocked_task_list) {
 		Task * task = TaskSyncList::Fetch(m_blocked_task_list);
 		task->DropBlockSync(this);
+#if MACS_SYNC_STATS
+		task->m_stat_obj = nullptr;
+#endif
 	}
 }
 
@@ -221,6 +459,71 @@ void SyncObject::OnDeleteTask(Task * task)
 	TaskSyncList::Del(m_blocked_task_list, task);
 }
 
+// очередь упорядочена по приоритету
+void SyncObject::OnChangePriority(Task * task)
+{
+	if (!TaskSyncList::IsLinked(task))
+		return;
+	TaskSyncList::Del(m_blocked_task_list, task);
+	TaskSyncList::Add(m_blocked_task_list, task);
+}
+
+Task::Priority SyncOwnedObject::InheritedPriority() const
+{
+	Task::Priority inh_prior = m_owner_original_priority;
+	SyncOwnedObject * pobj = m_owner->m_owned_obj_list;
+	while (pobj) {
+		if (pobj->CeilingPriority() > inh_prior)
+			inh_prior = pobj->CeilingPriority();
+#if MACS_MUTEX_PRIORITY_INVERSION
+		Task * waiter = pobj->TopWaiter();
+		if (waiter && waiter->GetPriority() > inh_prior)
+			inh_prior = waiter->GetPriority();
+#endif
+		pobj = OwnedSyncObjList::Next(pobj);
+	}
+	return inh_prior;
+}
+
+#if MACS_MUTEX_PRIORITY_INVERSION
+extern Result IntSetTaskPriority_Priv(Scheduler * pS, Task * task, Task::Priority priority, bool internal_usage);
+#endif
+
+void SyncOwnedObject::UpdateOwnerPriority()
+{
+#if MACS_MUTEX_PRIORITY_INVERSION
+	SyncOwnedObject * obj = this;
+	for (uint depth = 0; obj && obj->m_owner && depth < MACS_PRIORITY_INHERITANCE_DEPTH; ++depth) {
+		Task * owner = obj->m_owner;
+		Task::Priority inh_prior = obj->InheritedPriority();
+		if (owner->GetPriority() == inh_prior)
+			return;
+#if MACS_SYNC_STATS
+		if (inh_prior > owner->GetPriority())
+			++obj->m_stats.m_boosts;
+#endif
+
+		// заодно переставляет владельца в очереди объекта, которого он ждет
+		IntSetTaskPriority_Priv(&Sch(), owner, inh_prior, true);
+
+		obj = owner->m_state == Task::StateBlocked && owner->m_unblock_func ? owner->m_unblock_func->Inheritor() : nullptr;
+	}
+#endif
+}
+
+#if MACS_MUTEX_PRIORITY_INVERSION
+Task::Priority SyncOwnedObject::RemoveFromOwner()
+{
+	m_owner->RemoveOwnedSync(this);
+	return InheritedPriority();
+}
+#else
+void SyncOwnedObject::RemoveFromOwner()
+{
+	m_owner->RemoveOwnedSync(this);
+}
+#endif
+
 TaskIrq::TaskIrq(const char* name) :
 		Task(name)
 {
@@ -36,6 +36,38 @@
 #define MACS_MUTEX_PRIORITY_INVERSION 1   
 #endif
 
+#ifndef MACS_PRIORITY_INHERITANCE_DEPTH
+#define MACS_PRIORITY_INHERITANCE_DEPTH  8u   
+#endif
+
+#ifndef MACS_EDF_ENABLED
+#define MACS_EDF_ENABLED         0   
+#endif
+
+#ifndef MACS_EDF_PRIORITY
+#define MACS_EDF_PRIORITY        Task::PriorityAboveNormal   
+#endif
+
+#ifndef MACS_SYNC_FAST_PATH
+#define MACS_SYNC_FAST_PATH      1
+#endif
+
+#ifndef MACS_RWLOCK_MAX_READERS
+#define MACS_RWLOCK_MAX_READERS  4u
+#endif
+
+#ifndef MACS_WAIT_SET_SIZE
+#define MACS_WAIT_SET_SIZE       8u
+#endif
+
+#ifndef MACS_MASK_BUDGET_ENABLED
+#define MACS_MASK_BUDGET_ENABLED 0      
+#endif
+
+#ifndef MACS_SYNC_STATS
+#define MACS_SYNC_STATS          0      
+#endif
+
 #ifndef MACS_PROFILING_ENABLED
 #define MACS_PROFILING_ENABLED   0      
 #endif
@@ -56,6 +88,68 @@
 #define MACS_SLEEP_ON_IDLE       0      
 #endif
 
+#ifndef MACS_IDLE_JOBS
+#define MACS_IDLE_JOBS           0      
+#endif
+
+#ifndef MACS_IDLE_JOB_BUDGET_US
+#define MACS_IDLE_JOB_BUDGET_US  500u   
+#endif
+
 #ifndef MACS_PRINTF_ALLOWED
 #define MACS_PRINTF_ALLOWED      0      
 #endif
+
+#ifndef MACS_LOG_ENABLED
+#define MACS_LOG_ENABLED         0
+#endif
+
+#define MACS_LOG_LEVEL_NONE      0
+#define MACS_LOG_LEVEL_ERR       1
+#define MACS_LOG_LEVEL_WRN       2
+#define MACS_LOG_LEVEL_INF       3
+#define MACS_LOG_LEVEL_DBG       4
+
+#ifndef MACS_LOG_LEVEL
+#define MACS_LOG_LEVEL           MACS_LOG_LEVEL_INF
+#endif
+
+#ifndef MACS_LOG_BUF_LEN
+#define MACS_LOG_BUF_LEN         32u
+#endif
+
+#ifndef MACS_LOG_BINARY
+#define MACS_LOG_BINARY          0
+#endif
+
+#ifndef MACS_USE_UART
+#define MACS_USE_UART            0
+#endif
+
+#ifndef MACS_UART_RX_BUF_LEN
+#define MACS_UART_RX_BUF_LEN     256u
+#endif
+
+#ifndef MACS_UART_TX_BUF_LEN
+#define MACS_UART_TX_BUF_LEN     256u
+#endif
+
+#ifndef MACS_USE_BUTTONS
+#define MACS_USE_BUTTONS         0
+#endif
+
+#ifndef MACS_BUTTON_MAX
+#define MACS_BUTTON_MAX          4u
+#endif
+
+#ifndef MACS_BUTTON_QUEUE_LEN
+#define MACS_BUTTON_QUEUE_LEN    16u
+#endif
+
+#ifndef MACS_POWER_MANAGEMENT
+#define MACS_POWER_MANAGEMENT    0
+#endif
+
+#ifndef MACS_POWER_MIN_STOP_MS
+#define MACS_POWER_MIN_STOP_MS   20u
+#endif
@@ -0,0 +1,415 @@
+/** @copyright AstroSoft Ltd */
+
+#define USE_MDR1986VE9x
+#include "tunes.h"
+
+#if MACS_USE_BUTTONS
+
+#if MACS_USE_TIMERS
+#error "Buttons use TIMER3, which is also owned by Timer"
+#endif
+
+#include "nullptr.h"
+#include "system.hpp"
+#include "scheduler.hpp"
+#include "semaphore.hpp"
+#include "utils.hpp"
+#include "critical_section.hpp"
+#include "button.hpp"
+#include "power.hpp"
+
+extern "C"
+{
+#include "MDR32F9Qx_rst_clk.h"
+#include "MDR32F9Qx_port.h"
+#include "MDR32F9Qx_timer.h"
+}
+
+static const uint32_t QUEUE_LEN = MACS_BUTTON_QUEUE_LEN;
+
+typedef char ButtonQueueLenCheck[(QUEUE_LEN & (QUEUE_LEN - 1)) == 0 ? 1 : -1];
+
+// кнопки без EXT_INT опрашиваются постоянно: фронт отмечается в прерывании с точностью до периода
+static const uint32_t SCAN_PERIOD_US = 250;
+static const uint EXT_INT_LINES = 4;
+
+struct PortHw
+{
+	MDR_PORT_TypeDef * m_handle;
+	uint32_t m_clk;
+};
+
+static const PortHw s_ports[] = {
+	{MDR_PORTA, RST_CLK_PCLK_PORTA},
+	{MDR_PORTB, RST_CLK_PCLK_PORTB},
+	{MDR_PORTC, RST_CLK_PCLK_PORTC},
+	{MDR_PORTD, RST_CLK_PCLK_PORTD},
+	{MDR_PORTE, RST_CLK_PCLK_PORTE},
+	{MDR_PORTF, RST_CLK_PCLK_PORTF}};
+
+static const IRQn_Type s_ext_irq[EXT_INT_LINES] = {EXT_INT1_IRQn, EXT_INT2_IRQn, EXT_INT3_IRQn, EXT_INT4_IRQn};
+
+enum ButtonState
+{
+	BS_RELEASED,
+	BS_PRESS_BOUNCE,
+	BS_PRESSED,
+	BS_RELEASE_BOUNCE
+};
+
+struct ButtonData
+{
+	MDR_PORT_TypeDef * m_port;
+	uint16_t m_pin;
+	uint8_t m_ext_int;
+	bool m_active_low;
+
+	uint8_t m_state;
+	uint32_t m_cnt;        // подряд идущих отсчетов в ожидаемом состоянии
+	uint32_t m_miss;       // отсчетов против ожидаемого состояния
+	uint32_t m_held;
+	bool m_long_sent;
+	uint32_t m_edge_us;
+};
+
+// состояние кнопок меняют только прерывания EXT_INTx и TIMER3 одного приоритета, друг друга они не вытесняют;
+// очередь событий - кольцо с одним писателем (прерывание) и одним читателем (задача)
+struct ButtonsData
+{
+	bool m_active;
+	uint m_count;
+	uint m_polled;
+	uint32_t m_debounce_cnt;     // в периодах опроса
+	uint32_t m_long_press_cnt;
+	bool m_timer_on;
+	ButtonData m_buttons[Buttons::MAX_BUTTONS];
+
+	Buttons::Event m_queue[QUEUE_LEN];
+	volatile uint32_t m_head;
+	volatile uint32_t m_tail;
+	volatile ulong m_lost;
+	Semaphore m_sem;
+
+	ButtonsData() :
+			m_active(false),
+			m_count(0),
+			m_polled(0),
+			m_debounce_cnt(0),
+			m_long_press_cnt(0),
+			m_timer_on(false),
+			m_head(0),
+			m_tail(0),
+			m_lost(0),
+			m_sem(0, QUEUE_LEN)
+	{
+	}
+};
+
+static ButtonsData s_data;
+
+static inline bool IsActive(const ButtonData & b)
+{
+	bool high = (b.m_port->RXTX & b.m_pin) != 0;
+	return high != b.m_active_low;
+}
+
+static void StartScan()
+{
+	if (s_data.m_timer_on)
+		return;
+	s_data.m_timer_on = true;
+#if MACS_POWER_MANAGEMENT
+	// TIMER3 тактируется от HCLK и в останове не считает
+	Power::Inhibit();
+#endif
+	TIMER_SetCounter(MDR_TIMER3, 0);
+	TIMER_Cmd(MDR_TIMER3, ENABLE);
+}
+
+static void StopScan()
+{
+	if (!s_data.m_timer_on)
+		return;
+	TIMER_Cmd(MDR_TIMER3, DISABLE);
+	s_data.m_timer_on = false;
+#if MACS_POWER_MANAGEMENT
+	Power::Allow();
+#endif
+}
+
+static void ArmExtInt(const ButtonData & b)
+{
+	if (!b.m_ext_int)
+		return;
+	IRQn_Type irq = s_ext_irq[b.m_ext_int - 1];
+	NVIC_ClearPendingIRQ(irq);
+	NVIC_EnableIRQ(irq);
+}
+
+static void PutEvent(uint button, Buttons::EventType type, uint32_t time_us)
+{
+	if (s_data.m_head - s_data.m_tail == QUEUE_LEN) {
+		++s_data.m_lost;
+		return;
+	}
+	Buttons::Event & event = s_data.m_queue[s_data.m_head % QUEUE_LEN];
+	event.m_button = button;
+	event.m_type = type;
+	event.m_time_us = time_us;
+	++s_data.m_head;
+	s_data.m_sem.Signal();
+}
+
+static void Scan(uint idx, uint32_t now_us)
+{
+	ButtonData & b = s_data.m_buttons[idx];
+	bool active = IsActive(b);
+	uint32_t debounce = s_data.m_debounce_cnt;
+
+	switch (b.m_state) {
+	case BS_RELEASED:
+		// нажатие кнопок с EXT_INT точнее отметит прерывание
+		if (active && !b.m_ext_int) {
+			b.m_edge_us = now_us;
+			b.m_cnt = 1;
+			b.m_miss = 0;
+			b.m_state = BS_PRESS_BOUNCE;
+		}
+		break;
+	case BS_PRESS_BOUNCE:
+		if (active) {
+			if (++b.m_cnt >= debounce) {
+				b.m_held = b.m_cnt;
+				b.m_long_sent = false;
+				b.m_state = BS_PRESSED;
+				PutEvent(idx, Buttons::EventPress, b.m_edge_us);
+			}
+		} else {
+			b.m_cnt = 0;
+			// помеха, а не нажатие
+			if (++b.m_miss >= debounce) {
+				b.m_state = BS_RELEASED;
+				ArmExtInt(b);
+			}
+		}
+		break;
+	case BS_PRESSED:
+		if (active) {
+			++b.m_held;
+			if (!b.m_long_sent && b.m_held >= s_data.m_long_press_cnt) {
+				b.m_long_sent = true;
+				PutEvent(idx, Buttons::EventLongPress, now_us);
+			}
+		} else {
+			b.m_edge_us = now_us;
+			b.m_cnt = 1;
+			b.m_miss = 0;
+			b.m_state = BS_RELEASE_BOUNCE;
+		}
+		break;
+	case BS_RELEASE_BOUNCE:
+		if (!active) {
+			if (++b.m_cnt >= debounce) {
+				b.m_state = BS_RELEASED;
+				PutEvent(idx, Buttons::EventRelease, b.m_edge_us);
+				ArmExtInt(b);
+			}
+		} else {
+			b.m_cnt = 0;
+			if (++b.m_miss >= debounce)
+				b.m_state = BS_PRESSED;
+		}
+		break;
+	}
+}
+
+Result Buttons::Initialize(const Pin * pins, uint count, uint32_t debounce_ms, uint32_t long_press_ms)
+{
+	if (!pins || !count || count > MAX_BUTTONS || !debounce_ms || long_press_ms <= debounce_ms)
+		return ResultErrorInvalidArgs;
+
+	uint ext_used = 0;
+	for (uint i = 0; i < count; ++i) {
+		if (pins[i].m_port >= countof(s_ports) || pins[i].m_ext_int > EXT_INT_LINES)
+			return ResultErrorInvalidArgs;
+		if (pins[i].m_ext_int) {
+			uint line = 1u << pins[i].m_ext_int;
+			if (ext_used & line)
+				return ResultErrorInvalidArgs;
+			ext_used |= line;
+		}
+	}
+
+	DeInitialize();
+
+	RST_CLK_PCLKcmd(RST_CLK_PCLK_TIMER3, ENABLE);
+
+	s_data.m_count = count;
+	s_data.m_polled = 0;
+	s_data.m_debounce_cnt = debounce_ms * 1000 / SCAN_PERIOD_US;
+	s_data.m_long_press_cnt = long_press_ms * 1000 / SCAN_PERIOD_US;
+
+	for (uint i = 0; i < count; ++i) {
+		const PortHw & hw = s_ports[pins[i].m_port];
+		RST_CLK_PCLKcmd(hw.m_clk, ENABLE);
+
+		PORT_InitTypeDef conf;
+		PORT_StructInit(&conf);
+		conf.PORT_Pin = pins[i].m_pin;
+		conf.PORT_OE = PORT_OE_IN;
+		conf.PORT_FUNC = (PORT_FUNC_TypeDef)pins[i].m_func;
+		conf.PORT_MODE = PORT_MODE_DIGITAL;
+		conf.PORT_GFEN = PORT_GFEN_ON;
+		conf.PORT_PULL_UP = pins[i].m_active_low ? PORT_PULL_UP_ON : PORT_PULL_UP_OFF;
+		conf.PORT_PULL_DOWN = pins[i].m_active_low ? PORT_PULL_DOWN_OFF : PORT_PULL_DOWN_ON;
+		PORT_Init(hw.m_handle, &conf);
+
+		ButtonData & b = s_data.m_buttons[i];
+		b.m_port = hw.m_handle;
+		b.m_pin = pins[i].m_pin;
+		b.m_ext_int = pins[i].m_ext_int;
+		b.m_active_low = pins[i].m_active_low;
+		b.m_state = BS_RELEASED;
+		if (!b.m_ext_int)
+			++s_data.m_polled;
+	}
+
+	TIMER_CntInitTypeDef conf;
+	TIMER_CntStructInit(&conf);
+	conf.TIMER_Prescaler = System::GetCpuFreq() / 1000000 - 1;
+	conf.TIMER_Period = SCAN_PERIOD_US - 1;
+	TIMER_CntInit(MDR_TIMER3, &conf);
+	TIMER_BRGInit(MDR_TIMER3, TIMER_HCLKdiv1);
+	TIMER_ITConfig(MDR_TIMER3, TIMER_STATUS_CNT_ARR, ENABLE);
+
+	System::SetIrqPriority(Timer3_IRQn, System::MAX_SYSCALL_INTERRUPT_PRIORITY);
+	NVIC_EnableIRQ(Timer3_IRQn);
+
+	s_data.m_active = true;
+
+	for (uint i = 0; i < count; ++i)
+		if (s_data.m_buttons[i].m_ext_int) {
+			System::SetIrqPriority(s_ext_irq[s_data.m_buttons[i].m_ext_int - 1], System::MAX_SYSCALL_INTERRUPT_PRIORITY);
+			ArmExtInt(s_data.m_buttons[i]);
+		}
+
+	if (s_data.m_polled)
+		StartScan();
+
+	return ResultOk;
+}
+
+void Buttons::OnCpuFreqChange()
+{
+	if (s_data.m_active)
+		TIMER_SetCntPrescaler(MDR_TIMER3, System::GetCpuFreq() / 1000000 - 1);
+}
+
+Result Buttons::DeInitialize()
+{
+	if (!s_data.m_active)
+		return ResultOk;
+
+	for (uint i = 0; i < s_data.m_count; ++i)
+		if (s_data.m_buttons[i].m_ext_int)
+			NVIC_DisableIRQ(s_ext_irq[s_data.m_buttons[i].m_ext_int - 1]);
+	NVIC_DisableIRQ(Timer3_IRQn);
+	StopScan();
+	TIMER_DeInit(MDR_TIMER3);
+
+	s_data.m_active = false;
+	return ResultOk;
+}
+
+Result Buttons::Wait(Event & event, uint32_t timeout_ms)
+{
+	if (!s_data.m_active)
+		return ResultErrorInvalidState;
+
+	Result res = s_data.m_sem.Wait(timeout_ms);
+	if (res != ResultOk)
+		return res;
+
+	event = s_data.m_queue[s_data.m_tail % QUEUE_LEN];
+	++s_data.m_tail;
+	return ResultOk;
+}
+
+ulong Buttons::GetLost()
+{
+	return s_data.m_lost;
+}
+
+uint32_t Buttons::TimestampUs()
+{
+	uint32_t ticks;
+	uint32_t val;
+	{
+		// тик не сменится между чтением счетчика и SysTick
+		CriticalSection _cs_;
+		ticks = Sch().GetTickCount();
+		val = SysTick->VAL;
+		// SysTick перезагрузился, но его прерывание еще не обработано
+		if (SCB->ICSR & SCB_ICSR_PENDSTSET_Msk) {
+			val = SysTick->VAL;
+			++ticks;
+		}
+	}
+
+	uint32_t cycles = SysTick->LOAD - val;
+	return ticks * (1000000 / System::GetTickRate()) + cycles / (System::GetCpuFreq() / 1000000);
+}
+
+static void OnExtInt(uint line)
+{
+	NVIC_DisableIRQ(s_ext_irq[line - 1]);
+
+	uint32_t now_us = Buttons::TimestampUs();
+	for (uint i = 0; i < s_data.m_count; ++i) {
+		ButtonData & b = s_data.m_buttons[i];
+		if (b.m_ext_int != line || b.m_state != BS_RELEASED)
+			continue;
+		b.m_edge_us = now_us;
+		b.m_cnt = 0;
+		b.m_miss = 0;
+		b.m_state = BS_PRESS_BOUNCE;
+	}
+	StartScan();
+}
+
+extern "C"
+{
+void Timer3_IRQHandler()
+{
+	TIMER_ClearITPendingBit(MDR_TIMER3, TIMER_STATUS_CNT_ARR);
+
+	uint32_t now_us = Buttons::TimestampUs();
+	bool busy = s_data.m_polled != 0;
+	for (uint i = 0; i < s_data.m_count; ++i) {
+		Scan(i, now_us);
+		busy |= s_data.m_buttons[i].m_state != BS_RELEASED;
+	}
+
+	// все отпущены - ждем следующего фронта без прерываний таймера
+	if (!busy)
+		StopScan();
+}
+void EXT_INT1_IRQHandler()
+{
+	OnExtInt(1);
+}
+void EXT_INT2_IRQHandler()
+{
+	OnExtInt(2);
+}
+void EXT_INT3_IRQHandler()
+{
+	OnExtInt(3);
+}
+void EXT_INT4_IRQHandler()
+{
+	OnExtInt(4);
+}
+}
+
+#endif
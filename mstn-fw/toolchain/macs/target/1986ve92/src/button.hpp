@@ -0,0 +1,61 @@
+/** @copyright AstroSoft Ltd */
+#pragma once
+
+#include "common.hpp"
+
+// Кнопки на выводах портов. Первый фронт нажатия ловится прерыванием EXT_INTx и получает метку времени
+// с точностью до такта SysTick, дребезг отрабатывается в прерывании TIMER3, который работает только пока
+// какая-нибудь кнопка не отпущена. Кнопки без линии EXT_INT TIMER3 опрашивает постоянно каждые 250 мкс,
+// фронт отмечается в его прерывании; процессор спит между прерываниями, но останов при этом запрещен.
+class Buttons
+{
+public:
+	enum Port
+	{
+		PortA,
+		PortB,
+		PortC,
+		PortD,
+		PortE,
+		PortF
+	};
+
+	struct Pin
+	{
+		uint8_t m_port;        // Port
+		uint16_t m_pin;        // PORT_Pin_x
+		uint8_t m_func;        // PORT_FUNC_x, заводящая вывод на EXT_INTx
+		uint8_t m_ext_int;     // 1..4, 0 - только опрос
+		bool m_active_low;
+	};
+
+	enum EventType
+	{
+		EventPress,
+		EventRelease,
+		EventLongPress
+	};
+
+	struct Event
+	{
+		uint8_t m_button;      // индекс в таблице Initialize
+		uint8_t m_type;        // EventType
+		uint32_t m_time_us;    // первый фронт (для длинного нажатия - момент срабатывания), переполняется
+	};
+
+	static const uint MAX_BUTTONS = MACS_BUTTON_MAX;
+
+	static Result Initialize(const Pin * pins, uint count, uint32_t debounce_ms = 20, uint32_t long_press_ms = 800);
+	static Result DeInitialize();
+
+	// только из задач
+	static Result Wait(Event & event, uint32_t timeout_ms = INFINITE_TIMEOUT);
+
+	static ulong GetLost();
+
+	// метка времени в мкс на базе SysTick; из прерываний и привилегированных задач
+	static uint32_t TimestampUs();
+
+	// перестройка предделителя TIMER3; вызывается из System::SetCpuFreq
+	static void OnCpuFreqChange();
+};
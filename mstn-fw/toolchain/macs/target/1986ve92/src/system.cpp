@@ -1,11 +1,263 @@
 /** @copyright AstroSoft Ltd */
 
+#define USE_MDR1986VE9x
 #include "system.hpp"
+#include "uart.hpp"
+#include "button.hpp"
 
+extern "C"
+{
+#include "MDR32F9Qx_config.h"
+#include "MDR32F9Qx_rst_clk.h"
+}
+
+#ifndef F_CPU
+#define F_CPU  80000000
+#endif
+
+static const uint32_t FLASH_FREQ_PER_DELAY = 25000000;
+
+static const uint32_t CLK_READY_TIMEOUT = 0x10000;
+
+static bool WaitClockStatus(uint32_t flag)
+{
+	for (uint32_t i = 0; i < CLK_READY_TIMEOUT; ++i)
+		if (MDR_RST_CLK->CLOCK_STATUS & flag)
+			return true;
+	return false;
+}
+
+// такт ожидания flash на каждые 25 МГц
+static void SetFlashDelay(uint32_t freq_hz)
+{
+	uint32_t delay = (freq_hz - 1) / FLASH_FREQ_PER_DELAY;
+	MDR_EEPROM->CMD = (MDR_EEPROM->CMD & ~EEPROM_CMD_DELAY_Msk) | (delay << EEPROM_CMD_DELAY_Pos);
+}
+
+// ток внутреннего регулятора: 0 - до 10 МГц, 5 - до 40 МГц, 6 - до 80 МГц
+static void SetRegulatorMode(uint32_t freq_hz)
+{
+	uint32_t mode = freq_hz <= 10000000 ? 0 : freq_hz <= 40000000 ? 5 : 6;
+	MDR_BKP->REG_0E = (MDR_BKP->REG_0E & ~(BKP_REG_0E_LOW_Msk | BKP_REG_0E_SELECTRI_Msk))
+		| (mode << BKP_REG_0E_LOW_Pos) | (mode << BKP_REG_0E_SELECTRI_Pos);
+}
+
+// перед разгоном поднимаются задержка flash и ток регулятора, после замедления - снижаются
+static bool SwitchCpuClock(uint32_t freq_hz)
+{
+	uint32_t mul = freq_hz / HSE_Value;
+	bool faster = freq_hz > SystemCoreClock;
+	if (faster) {
+		SetRegulatorMode(freq_hz);
+		SetFlashDelay(freq_hz);
+	}
+
+	// пока PLL перестраивается, ядро работает от генератора напрямую
+	RST_CLK_CPU_PLLuse(DISABLE);
+	RST_CLK_CPUclkPrescaler(RST_CLK_CPUclkDIV1);
+	RST_CLK_CPUclkSelection(RST_CLK_CPUclkCPU_C3);
+	RST_CLK_CPU_PLLcmd(DISABLE);
+	RST_CLK_CPU_PLLconfig(RST_CLK_CPU_PLLsrcHSEdiv1, mul - 1);
+
+	bool ok = true;
+	if (mul > 1) {
+		RST_CLK_CPU_PLLcmd(ENABLE);
+		ok = RST_CLK_CPU_PLLstatus() == SUCCESS;
+		if (ok)
+			RST_CLK_CPU_PLLuse(ENABLE);
+		else
+			RST_CLK_CPU_PLLcmd(DISABLE);
+	}
+
+	SystemCoreClockUpdate();
+	if (!faster || !ok) {
+		SetFlashDelay(SystemCoreClock);
+		SetRegulatorMode(SystemCoreClock);
+	}
+	return ok;
+}
+
+static inline bool IsValidCpuFreq(uint32_t freq_hz)
+{
+	return freq_hz >= HSE_Value && freq_hz <= System::CPU_FREQ_HIGH && freq_hz % HSE_Value == 0;
+}
+
+// частота LSI, по которой отсчитывается останов: номинал, пока нет измерения
+static uint32_t s_lsi_hz = LSI_Value;
+
+#if MACS_POWER_MANAGEMENT
+// тактов LSI на измерение: около 13 мс при номинале
+static const uint32_t LSI_CAL_CYCLES = 512;
+static const uint32_t RTC_DIV_MAX = 0xFFFFF;
+static const uint32_t RTC_SEL_LSI = 0;
+
+// регистры RTC тактируются от LSI, значение берется по двум одинаковым чтениям
+static uint32_t ReadRtcDiv()
+{
+	uint32_t div;
+	do
+		div = MDR_BKP->RTC_DIV;
+	while (div != MDR_BKP->RTC_DIV);
+	return div;
+}
+
+static void WaitRtcWrite()
+{
+	for (uint32_t i = 0; i < CLK_READY_TIMEOUT && (MDR_BKP->RTC_CS & BKP_RTC_CS_WEC); ++i)
+		;
+}
+
+static inline uint32_t SysTickSince(uint32_t start)
+{
+	return (start - SysTick->VAL) & SysTick_LOAD_RELOAD_Msk;
+}
+
+// пока предделитель RTC не отсчитает cycles тактов LSI от from; false - за limit тактов ядра не дождались
+static bool WaitLsiCycles(uint32_t from, uint32_t cycles, uint32_t start, uint32_t limit)
+{
+	while (((ReadRtcDiv() - from) & RTC_DIV_MAX) < cycles)
+		if (SysTickSince(start) > limit)
+			return false;
+	return true;
+}
+
+// предделитель RTC от LSI считает такты LSI, SysTick - такты ядра от HSE, отсчет от фронта LSI.
+// RTC, уже запущенный приложением, не трогается, тогда остается номинал
+static void CalibrateLsi()
+{
+	uint32_t reg_0f = MDR_BKP->REG_0F;
+	if (reg_0f & BKP_REG_0F_RTC_EN)
+		return;
+	RST_CLK_LSIcmd(ENABLE);
+	if (RST_CLK_LSIstatus() != SUCCESS)
+		return;
+
+	MDR_BKP->REG_0F = (MDR_BKP->REG_0F & ~BKP_REG_0F_RTC_SEL_Msk) | (RTC_SEL_LSI << BKP_REG_0F_RTC_SEL_Pos);
+	WaitRtcWrite();
+	MDR_BKP->RTC_PRL = RTC_DIV_MAX;
+	WaitRtcWrite();
+	MDR_BKP->REG_0F |= BKP_REG_0F_RTC_EN;
+
+	// ждем не дольше вчетверо от номинала
+	uint64_t limit = (uint64_t)4 * LSI_CAL_CYCLES * SystemCoreClock / LSI_Value;
+	if (limit > SysTick_LOAD_RELOAD_Msk / 2)
+		limit = SysTick_LOAD_RELOAD_Msk / 2;
+
+	SysTick->LOAD = SysTick_LOAD_RELOAD_Msk;
+	SysTick->VAL = 0;
+	SysTick->CTRL = SysTick_CTRL_CLKSOURCE_Msk | SysTick_CTRL_ENABLE_Msk;
+
+	uint32_t start = SysTick->VAL;
+	uint32_t div = ReadRtcDiv();
+	bool ok = WaitLsiCycles(div, 1, start, (uint32_t)limit);
+	uint32_t edge = SysTick->VAL;
+	ok = ok && WaitLsiCycles(div + 1, LSI_CAL_CYCLES, edge, (uint32_t)limit);
+	uint32_t cycles = SysTickSince(edge);
+	SysTick->CTRL = 0;
+
+	MDR_BKP->REG_0F &= ~BKP_REG_0F_RTC_EN;
+	WaitRtcWrite();
+	MDR_BKP->REG_0F = (MDR_BKP->REG_0F & ~BKP_REG_0F_RTC_SEL_Msk) | (reg_0f & BKP_REG_0F_RTC_SEL_Msk);
+	if (!(reg_0f & BKP_REG_0F_LSI_ON))
+		RST_CLK_LSIcmd(DISABLE);
+
+	if (!ok || !cycles)
+		return;
+	// вне двукратного разброса - ошибка измерения
+	uint32_t hz = (uint32_t)((uint64_t)LSI_CAL_CYCLES * SystemCoreClock / cycles);
+	if (hz >= LSI_Value / 2 && hz <= LSI_Value * 2)
+		s_lsi_hz = hz;
+}
+#endif
+
+// до запуска планировщика: SysTick настроит InitScheduler
 void System::InitCpu()
 {
+	RST_CLK_PCLKcmd(RST_CLK_PCLK_EEPROM | RST_CLK_PCLK_BKP, ENABLE);
+	RST_CLK_HSEconfig(RST_CLK_HSE_ON);
+	if (RST_CLK_HSEstatus() != SUCCESS)
+		return;
+
+	SwitchCpuClock(IsValidCpuFreq(F_CPU) ? F_CPU : HSE_Value);
+#if MACS_POWER_MANAGEMENT
+	CalibrateLsi();
+#endif
+}
+
+Result System::SetCpuFreq_Priv(uint32_t freq_hz)
+{
+	if (!IsValidCpuFreq(freq_hz))
+		return ResultErrorInvalidArgs;
+	if (freq_hz == SystemCoreClock)
+		return ResultOk;
+	if (!(MDR_RST_CLK->CLOCK_STATUS & RST_CLK_CLOCK_STATUS_HSE_RDY))
+		return ResultErrorInvalidState;
+
+	uint32_t mask = DisableIrq();
+	bool ok = SwitchCpuClock(freq_hz);
+	if (SysTick->CTRL & SysTick_CTRL_ENABLE_Msk)
+		SetTickRate(GetTickRate());
+#if MACS_USE_UART
+	Uart::OnCpuFreqChange();
+#endif
+#if MACS_USE_BUTTONS
+	Buttons::OnCpuFreqChange();
+#endif
+	EnableIrq(mask);
+
+	return ok ? ResultOk : ResultErrorInvalidState;
 }
 
 void System::HardFaultHandler()
 {
 }
+
+// HCLK переводится на LSI, HSE и PLL выключаются, сон отсчитывает SysTick от LSI по измеренной частоте
+uint32_t System::EnterStopMode(uint32_t max_us)
+{
+	RST_CLK_PCLKcmd(RST_CLK_PCLK_BKP, ENABLE);
+	RST_CLK_LSIcmd(ENABLE);
+	if (RST_CLK_LSIstatus() != SUCCESS)
+		return 0;
+
+	uint64_t cycles = (uint64_t)max_us * s_lsi_hz / 1000000;
+	if (cycles < 2)
+		return 0;
+	if (cycles > SysTick_LOAD_RELOAD_Msk)
+		cycles = SysTick_LOAD_RELOAD_Msk;
+
+	uint32_t cpu_clock = MDR_RST_CLK->CPU_CLOCK;
+	uint32_t pll_control = MDR_RST_CLK->PLL_CONTROL;
+	uint32_t hs_control = MDR_RST_CLK->HS_CONTROL;
+
+	SysTick->CTRL = 0;
+	SysTick->LOAD = (uint32_t)cycles - 1;
+	SysTick->VAL = 0;
+
+	MDR_RST_CLK->CPU_CLOCK = (cpu_clock & ~RST_CLK_CPU_CLOCK_HCLK_SEL_Msk) | RST_CLK_CPUclkLSI;
+	MDR_RST_CLK->PLL_CONTROL = pll_control & ~RST_CLK_PLL_CONTROL_PLL_CPU_ON;
+	MDR_RST_CLK->HS_CONTROL = hs_control & ~RST_CLK_HS_CONTROL_HSE_ON;
+
+	SysTick->CTRL = SysTick_CTRL_CLKSOURCE_Msk | SysTick_CTRL_TICKINT_Msk | SysTick_CTRL_ENABLE_Msk;
+	__DSB();
+	__WFI();
+
+	uint32_t ctrl = SysTick->CTRL;
+	uint32_t val = SysTick->VAL;
+	SysTick->CTRL = 0;
+	SCB->ICSR = SCB_ICSR_PENDSTCLR_Msk;
+
+	uint32_t slept = (ctrl & SysTick_CTRL_COUNTFLAG_Msk) ? (uint32_t)cycles : (uint32_t)cycles - 1 - val;
+
+	// такты восстанавливаются в прежнем порядке: генератор, PLL, переключение HCLK
+	MDR_RST_CLK->HS_CONTROL = hs_control;
+	if (hs_control & RST_CLK_HS_CONTROL_HSE_ON)
+		WaitClockStatus(RST_CLK_CLOCK_STATUS_HSE_RDY);
+	MDR_RST_CLK->PLL_CONTROL = pll_control;
+	if (pll_control & RST_CLK_PLL_CONTROL_PLL_CPU_ON)
+		WaitClockStatus(RST_CLK_CLOCK_STATUS_PLL_CPU_RDY);
+	MDR_RST_CLK->CPU_CLOCK = cpu_clock;
+
+	uint32_t slept_us = (uint32_t)((uint64_t)slept * 1000000 / s_lsi_hz);
+	return slept_us ? slept_us : 1;
+}
@@ -15,6 +15,20 @@ class System: public SystemBase
 public:
 	static const uint32_t HEAP_SIZE = MACS_HEAP_SIZE;
 
+	// профили частоты при кварце 8 МГц: HSE напрямую или через PLL
+	static const uint32_t CPU_FREQ_LOW = 8000000;
+	static const uint32_t CPU_FREQ_MID = 32000000;
+	static const uint32_t CPU_FREQ_HIGH = 80000000;
+
+	// EXT_INTx не зависят от тактов; UART и таймеры тактируются от HCLK
+	static const uint STOP_WAKE_SOURCES = WakeGpio;
+
 	static void InitCpu();
 	static void HardFaultHandler();
+
+	// частота кратна HSE и не выше CPU_FREQ_HIGH; UART перестраиваются на лету,
+	// байт на линии в момент переключения может исказиться
+	static Result SetCpuFreq_Priv(uint32_t freq_hz);
+
+	static uint32_t EnterStopMode(uint32_t max_us);
 };
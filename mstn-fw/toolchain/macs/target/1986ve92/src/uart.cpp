@@ -0,0 +1,567 @@
+/** @copyright AstroSoft Ltd */
+
+#define USE_MDR1986VE9x
+#include "tunes.h"
+
+#if MACS_USE_UART
+
+#include "nullptr.h"
+#include "system.hpp"
+#include "semaphore.hpp"
+#include "mutex.hpp"
+#include "task.hpp"
+#include "utils.hpp"
+#include "uart.hpp"
+
+extern "C"
+{
+#include "MDR32F9Qx_rst_clk.h"
+#include "MDR32F9Qx_port.h"
+#include "MDR32F9Qx_uart.h"
+}
+
+static const uint32_t RX_BUF_LEN = MACS_UART_RX_BUF_LEN;
+static const uint32_t TX_BUF_LEN = MACS_UART_TX_BUF_LEN;
+
+typedef char UartRxBufLenCheck[(RX_BUF_LEN & (RX_BUF_LEN - 1)) == 0 ? 1 : -1];
+typedef char UartTxBufLenCheck[(TX_BUF_LEN & (TX_BUF_LEN - 1)) == 0 ? 1 : -1];
+
+static const uint UART_FIFO_LEN = 16;
+static const uint RX_IRQ_LEVEL = 8;
+
+static const uint32_t PERIPH_REGION = 0x40000000;
+static const uint32_t PERIPH_BIT_BAND = 0x42000000;
+
+// управляющая структура канала PL230
+struct DmaCtrl
+{
+	volatile uint32_t m_src_end;
+	volatile uint32_t m_dst_end;
+	volatile uint32_t m_ctrl;
+	volatile uint32_t m_unused;
+};
+
+static const uint DMA_CHANNELS = 4;  // UART1 TX/RX, UART2 TX/RX
+static const uint32_t DMA_MAX_CHUNK = 1024;
+static const uint32_t DMA_DST_INC_NONE = 3u << 30;
+static const uint32_t DMA_CYCLE_BASIC = 1;
+
+static DmaCtrl s_dma_ctrl[DMA_CHANNELS] __attribute__((aligned(1024)));
+
+struct UartHw
+{
+	MDR_UART_TypeDef * m_handle;
+	IRQn_Type m_irq_n;
+	uint32_t m_clk;
+	MDR_PORT_TypeDef * m_port;
+	uint32_t m_port_clk;
+	uint16_t m_tx_pin;
+	uint16_t m_rx_pin;
+	PORT_FUNC_TypeDef m_func;
+	uint m_dma_tx_chnl;
+};
+
+static const UartHw s_hw[] = {
+	{MDR_UART1, UART1_IRQn, RST_CLK_PCLK_UART1, MDR_PORTB, RST_CLK_PCLK_PORTB, PORT_Pin_5, PORT_Pin_6, PORT_FUNC_ALTER, 0},
+	{MDR_UART2, UART2_IRQn, RST_CLK_PCLK_UART2, MDR_PORTF, RST_CLK_PCLK_PORTF, PORT_Pin_1, PORT_Pin_0, PORT_FUNC_OVERRID, 2}};
+
+static const uint NUMBER_OF_UARTS = countof(s_hw);
+
+// кольца: голова принимающего и хвост передающего двигаются только в прерывании
+struct UartData
+{
+	const UartHw * m_hw;
+	bool m_active;
+	Uart::Mode m_mode;
+	uint32_t m_baud_rate;
+
+	byte m_rx_buf[RX_BUF_LEN];
+	volatile uint32_t m_rx_head;
+	volatile uint32_t m_rx_tail;
+	volatile uint32_t m_rx_need;
+	volatile bool m_rx_idle;
+	volatile ulong m_rx_lost;
+	BinarySemaphore m_rx_sem;
+	Task * volatile m_rx_task;
+	uint32_t m_rx_bits;
+
+	byte m_tx_buf[TX_BUF_LEN];
+	volatile uint32_t m_tx_head;
+	volatile uint32_t m_tx_tail;
+	volatile uint32_t m_tx_need;
+	volatile uint32_t m_tx_chunk;
+	volatile bool m_tx_busy;
+	BinarySemaphore m_tx_sem;
+	Mutex m_tx_lock;
+};
+
+static UartData s_uarts[NUMBER_OF_UARTS];
+static Uart * s_console = nullptr;
+
+// атомарная запись бита периферии через bit-band, без запрета прерываний
+static inline volatile uint32_t & PeriphBit(volatile uint32_t & reg, uint bit)
+{
+	return *(volatile uint32_t *)(PERIPH_BIT_BAND + (((uint32_t)&reg - PERIPH_REGION) << 5) + (bit << 2));
+}
+
+static inline uint32_t RxCount(const UartData & u)
+{
+	return u.m_rx_head - u.m_rx_tail;
+}
+
+static inline uint32_t TxFree(const UartData & u)
+{
+	return TX_BUF_LEN - (u.m_tx_head - u.m_tx_tail);
+}
+
+static inline bool CanBlock()
+{
+	return Sch().IsStarted() && !System::IsInInterrupt();
+}
+
+static uint32_t RestOfTimeout(tick_t start, uint32_t timeout_ms)
+{
+	if (timeout_ms == INFINITE_TIMEOUT)
+		return INFINITE_TIMEOUT;
+	uint32_t elapsed_ms = TicksToUs(Sch().GetTickCount() - start) / 1000;
+	return elapsed_ms < timeout_ms ? timeout_ms - elapsed_ms : 0;
+}
+
+static void InitDma()
+{
+	static bool s_is_first_time = true;
+	if (!s_is_first_time)
+		return;
+	s_is_first_time = false;
+
+	// без тактирования SSP их запросы DMA не снимаются
+	RST_CLK_PCLKcmd(RST_CLK_PCLK_DMA | RST_CLK_PCLK_SSP1 | RST_CLK_PCLK_SSP2, ENABLE);
+
+	MDR_DMA->CHNL_ENABLE_CLR = ~0u;
+	MDR_DMA->CHNL_REQ_MASK_SET = ~0u;
+	MDR_DMA->CHNL_USEBURST_CLR = ~0u;
+	MDR_DMA->CHNL_PRI_ALT_CLR = ~0u;
+	MDR_DMA->CTRL_BASE_PTR = (uint32_t)s_dma_ctrl;
+	MDR_DMA->CFG = 1;
+
+	System::SetIrqPriority(DMA_IRQn, System::MAX_SYSCALL_INTERRUPT_PRIORITY);
+	NVIC_EnableIRQ(DMA_IRQn);
+}
+
+static void ReceiveBytes(UartData & u, uint max_cnt)
+{
+	MDR_UART_TypeDef * uart = u.m_hw->m_handle;
+	while (max_cnt-- && !(uart->FR & UART_FLAG_RXFE)) {
+		uint32_t data = uart->DR;
+		if (data & (UART_DR_OE | UART_DR_BE | UART_DR_PE | UART_DR_FE)) {
+			++u.m_rx_lost;
+			if (data & (UART_DR_BE | UART_DR_PE | UART_DR_FE))
+				continue;
+		}
+		if (RxCount(u) == RX_BUF_LEN) {
+			++u.m_rx_lost;
+			continue;
+		}
+		u.m_rx_buf[u.m_rx_head % RX_BUF_LEN] = (byte)data;
+		++u.m_rx_head;
+	}
+}
+
+static void NotifyReader(UartData & u)
+{
+	uint32_t need = u.m_rx_need;
+	if (need && (RxCount(u) >= need || u.m_rx_idle)) {
+		u.m_rx_need = 0;
+		u.m_rx_sem.Signal();
+	}
+	Task * task = u.m_rx_task;
+	if (task && RxCount(u))
+		Task::Notify(task, u.m_rx_bits);
+}
+
+static void NotifyWriter(UartData & u)
+{
+	uint32_t need = u.m_tx_need;
+	if (need && TxFree(u) >= need) {
+		u.m_tx_need = 0;
+		u.m_tx_sem.Signal();
+	}
+}
+
+static void FillTxFifo(UartData & u)
+{
+	MDR_UART_TypeDef * uart = u.m_hw->m_handle;
+	while (u.m_tx_tail != u.m_tx_head && !(uart->FR & UART_FLAG_TXFF)) {
+		uart->DR = u.m_tx_buf[u.m_tx_tail % TX_BUF_LEN];
+		++u.m_tx_tail;
+	}
+}
+
+static void StartDmaChunk(UartData & u)
+{
+	uint32_t pos = u.m_tx_tail % TX_BUF_LEN;
+	uint32_t cnt = MIN(u.m_tx_head - u.m_tx_tail, TX_BUF_LEN - pos);
+	cnt = MIN(cnt, DMA_MAX_CHUNK);
+
+	uint chnl = u.m_hw->m_dma_tx_chnl;
+	DmaCtrl & ctrl = s_dma_ctrl[chnl];
+	ctrl.m_src_end = (uint32_t)&u.m_tx_buf[pos + cnt - 1];
+	ctrl.m_dst_end = (uint32_t)&u.m_hw->m_handle->DR;
+	ctrl.m_ctrl = DMA_DST_INC_NONE | ((cnt - 1) << 4) | DMA_CYCLE_BASIC;
+
+	u.m_tx_chunk = cnt;
+	u.m_tx_busy = true;
+	MDR_DMA->CHNL_ENABLE_SET = 1u << chnl;
+	u.m_hw->m_handle->DMACR |= UART_DMA_TXE;
+}
+
+// запуск передачи из задачи: пока передатчик простаивает, прерывание кольцо не трогает
+static void KickTx(UartData & u)
+{
+	if (u.m_mode == Uart::ModeDma) {
+		if (!u.m_tx_busy && u.m_tx_tail != u.m_tx_head)
+			StartDmaChunk(u);
+		return;
+	}
+
+	volatile uint32_t & txim = PeriphBit(u.m_hw->m_handle->IMSC, UART_IMSC_TXIM_Pos);
+	if (!txim) {
+		FillTxFifo(u);
+		txim = 1;
+	}
+}
+
+static void IrqHandler(UartData & u)
+{
+	MDR_UART_TypeDef * uart = u.m_hw->m_handle;
+	uint32_t status = uart->MIS;
+
+	// в FIFO всегда оставляем байт, чтобы конец кадра отметил таймаут приема
+	if (status & UART_IT_RT) {
+		ReceiveBytes(u, UART_FIFO_LEN);
+		u.m_rx_idle = true;
+		uart->ICR = UART_IT_RT;
+		NotifyReader(u);
+	} else if (status & UART_IT_RX) {
+		ReceiveBytes(u, RX_IRQ_LEVEL - 1);
+		u.m_rx_idle = false;
+		NotifyReader(u);
+	}
+
+	if (status & UART_IT_TX) {
+		FillTxFifo(u);
+		if (u.m_tx_tail == u.m_tx_head)
+			PeriphBit(uart->IMSC, UART_IMSC_TXIM_Pos) = 0;
+		NotifyWriter(u);
+	}
+}
+
+static void DmaIrqHandler(UartData & u)
+{
+	if (!u.m_active || u.m_mode != Uart::ModeDma || !u.m_tx_busy)
+		return;
+	if (MDR_DMA->CHNL_ENABLE_SET & (1u << u.m_hw->m_dma_tx_chnl))
+		return;
+
+	// иначе запрос UART продолжит дергать прерывание DMA
+	u.m_hw->m_handle->DMACR &= ~UART_DMA_TXE;
+	u.m_tx_tail += u.m_tx_chunk;
+	u.m_tx_busy = false;
+	if (u.m_tx_tail != u.m_tx_head)
+		StartDmaChunk(u);
+	NotifyWriter(u);
+}
+
+Uart::Uart(Port port) :
+		m_uart(&s_uarts[port])
+{
+	m_uart->m_hw = &s_hw[port];
+}
+
+Uart::~Uart()
+{
+	DeInitialize();
+}
+
+Result Uart::Initialize(uint32_t baud_rate, Mode mode)
+{
+	DeInitialize();
+
+	UartData & u = *m_uart;
+	const UartHw & hw = *u.m_hw;
+
+	RST_CLK_PCLKcmd(hw.m_clk | hw.m_port_clk, ENABLE);
+
+	PORT_InitTypeDef pins;
+	PORT_StructInit(&pins);
+	pins.PORT_FUNC = hw.m_func;
+	pins.PORT_MODE = PORT_MODE_DIGITAL;
+	pins.PORT_SPEED = PORT_SPEED_MAXFAST;
+	pins.PORT_Pin = hw.m_tx_pin;
+	pins.PORT_OE = PORT_OE_OUT;
+	PORT_Init(hw.m_port, &pins);
+	pins.PORT_Pin = hw.m_rx_pin;
+	pins.PORT_OE = PORT_OE_IN;
+	PORT_Init(hw.m_port, &pins);
+
+	UART_BRGInit(hw.m_handle, UART_HCLKdiv1);
+
+	UART_InitTypeDef conf;
+	UART_StructInit(&conf);
+	conf.UART_BaudRate = baud_rate;
+	conf.UART_WordLength = UART_WordLength8b;
+	conf.UART_StopBits = UART_StopBits1;
+	conf.UART_Parity = UART_Parity_No;
+	conf.UART_FIFOMode = UART_FIFO_ON;
+	conf.UART_HardwareFlowControl = UART_HardwareFlowControl_RXE | UART_HardwareFlowControl_TXE;
+	if (UART_Init(hw.m_handle, &conf) != BaudRateValid)
+		return ResultErrorInvalidArgs;
+
+	u.m_rx_head = u.m_rx_tail = 0;
+	u.m_rx_need = 0;
+	u.m_rx_idle = false;
+	u.m_rx_lost = 0;
+	u.m_tx_head = u.m_tx_tail = 0;
+	u.m_tx_need = 0;
+	u.m_tx_busy = false;
+	u.m_mode = mode;
+	u.m_baud_rate = baud_rate;
+
+	if (mode == ModeDma) {
+		InitDma();
+		MDR_DMA->CHNL_REQ_MASK_CLR = 1u << hw.m_dma_tx_chnl;
+	}
+
+	UART_DMAConfig(hw.m_handle, UART_IT_FIFO_LVL_8words, UART_IT_FIFO_LVL_2words);
+	UART_ITConfig(hw.m_handle, UART_IT_RX | UART_IT_RT, ENABLE);
+
+	System::SetIrqPriority(hw.m_irq_n, System::MAX_SYSCALL_INTERRUPT_PRIORITY);
+	NVIC_EnableIRQ(hw.m_irq_n);
+
+	u.m_active = true;
+	UART_Cmd(hw.m_handle, ENABLE);
+
+	return ResultOk;
+}
+
+// новый делитель вступает в силу при записи LCR_H
+void Uart::OnCpuFreqChange()
+{
+	for (uint i = 0; i < NUMBER_OF_UARTS; ++i) {
+		const UartData & u = s_uarts[i];
+		if (!u.m_active)
+			continue;
+		MDR_UART_TypeDef * uart = u.m_hw->m_handle;
+		uint32_t div = (System::GetCpuFreq() * 4 + u.m_baud_rate / 2) / u.m_baud_rate;
+		uart->IBRD = div >> 6;
+		uart->FBRD = div & 0x3F;
+		uart->LCR_H = uart->LCR_H;
+	}
+}
+
+Result Uart::DeInitialize()
+{
+	UartData & u = *m_uart;
+	if (!u.m_active)
+		return ResultOk;
+
+	u.m_active = false;
+	NVIC_DisableIRQ(u.m_hw->m_irq_n);
+	if (u.m_mode == ModeDma) {
+		MDR_DMA->CHNL_ENABLE_CLR = 1u << u.m_hw->m_dma_tx_chnl;
+		MDR_DMA->CHNL_REQ_MASK_SET = 1u << u.m_hw->m_dma_tx_chnl;
+	}
+	UART_DeInit(u.m_hw->m_handle);
+	if (s_console == this)
+		s_console = nullptr;
+
+	return ResultOk;
+}
+
+Result Uart::Write(const void * data, size_t len, size_t * written, uint32_t timeout_ms)
+{
+	UartData & u = *m_uart;
+	if (!u.m_active)
+		return ResultErrorInvalidState;
+	if (System::IsInInterrupt())
+		return ResultErrorInterruptNotSupported;
+
+	const bool can_block = CanBlock();
+	if (can_block)
+		u.m_tx_lock.Lock();
+
+	const byte * src = static_cast<const byte *>(data);
+	const tick_t start = Sch().GetTickCount();
+	size_t done = 0;
+	Result res = ResultOk;
+
+	while (done < len) {
+		uint32_t cnt = MIN(TxFree(u), len - done);
+		for (uint32_t i = 0; i < cnt; ++i)
+			u.m_tx_buf[(u.m_tx_head + i) % TX_BUF_LEN] = src[done + i];
+		__DMB();
+		u.m_tx_head += cnt;
+		done += cnt;
+		KickTx(u);
+
+		if (done == len)
+			break;
+
+		// до старта планировщика ждем освобождения места опросом
+		if (!can_block)
+			continue;
+
+		u.m_tx_need = MIN(len - done, TX_BUF_LEN / 2);
+		if (TxFree(u) >= u.m_tx_need) {
+			u.m_tx_need = 0;
+			continue;
+		}
+		res = u.m_tx_sem.Wait(RestOfTimeout(start, timeout_ms));
+		u.m_tx_need = 0;
+		if (res != ResultOk)
+			break;
+	}
+
+	if (can_block)
+		u.m_tx_lock.Unlock();
+	if (written)
+		*written = done;
+	return res;
+}
+
+Result Uart::Read(void * data, size_t len, size_t * received, uint32_t timeout_ms)
+{
+	UartData & u = *m_uart;
+	if (!u.m_active)
+		return ResultErrorInvalidState;
+
+	byte * dst = static_cast<byte *>(data);
+	const tick_t start = Sch().GetTickCount();
+	size_t done = 0;
+	Result res = ResultOk;
+
+	while (done < len) {
+		uint32_t cnt = MIN(RxCount(u), len - done);
+		for (uint32_t i = 0; i < cnt; ++i)
+			dst[done + i] = u.m_rx_buf[(u.m_rx_tail + i) % RX_BUF_LEN];
+		__DMB();
+		u.m_rx_tail += cnt;
+		done += cnt;
+
+		if (done == len || (done && u.m_rx_idle && !RxCount(u)))
+			break;
+		if (RxCount(u))
+			continue;
+
+		if (!CanBlock() || timeout_ms == 0) {
+			res = ResultTimeout;
+			break;
+		}
+
+		u.m_rx_need = len - done;
+		if (RxCount(u) || (done && u.m_rx_idle)) {
+			u.m_rx_need = 0;
+			continue;
+		}
+		res = u.m_rx_sem.Wait(RestOfTimeout(start, timeout_ms));
+		u.m_rx_need = 0;
+		if (res != ResultOk)
+			break;
+	}
+
+	if (received)
+		*received = done;
+	return res;
+}
+
+void Uart::SetRxNotify(Task * task, uint32_t bits)
+{
+	UartData & u = *m_uart;
+	u.m_rx_task = nullptr;
+	__DMB();
+	u.m_rx_bits = bits;
+	__DMB();
+	u.m_rx_task = task;
+}
+
+Result Uart::Flush(uint32_t timeout_ms)
+{
+	UartData & u = *m_uart;
+	if (!u.m_active)
+		return ResultErrorInvalidState;
+	if (!CanBlock())
+		return ResultErrorInterruptNotSupported;
+
+	const tick_t start = Sch().GetTickCount();
+	Result res = ResultOk;
+
+	u.m_tx_lock.Lock();
+	while (TxFree(u) != TX_BUF_LEN) {
+		u.m_tx_need = TX_BUF_LEN;
+		if (TxFree(u) == TX_BUF_LEN)
+			break;
+		res = u.m_tx_sem.Wait(RestOfTimeout(start, timeout_ms));
+		if (res != ResultOk)
+			break;
+	}
+	u.m_tx_need = 0;
+	u.m_tx_lock.Unlock();
+
+	// остаток FIFO уходит не дольше чем за 16 символов
+	while (res == ResultOk && (u.m_tx_busy || UART_GetFlagStatus(u.m_hw->m_handle, UART_FLAG_BUSY) == SET))
+		;
+
+	return res;
+}
+
+size_t Uart::GetRxCount() const
+{
+	return RxCount(*m_uart);
+}
+
+ulong Uart::GetRxLost() const
+{
+	return m_uart->m_rx_lost;
+}
+
+void Uart::SetConsole()
+{
+	s_console = this;
+}
+
+extern "C"
+{
+void UART1_IRQHandler()
+{
+	IrqHandler(s_uarts[0]);
+}
+void UART2_IRQHandler()
+{
+	IrqHandler(s_uarts[1]);
+}
+void DMA_IRQHandler()
+{
+	for (uint index = 0; index < NUMBER_OF_UARTS; ++index)
+		DmaIrqHandler(s_uarts[index]);
+}
+
+int MacsConsoleWrite(const char * ptr, int len)
+{
+	if (!s_console)
+		return -1;
+	size_t written = 0;
+	s_console->Write(ptr, len, &written);
+	return written;
+}
+
+int MacsConsoleRead(char * ptr, int len)
+{
+	if (!s_console)
+		return -1;
+	size_t received = 0;
+	s_console->Read(ptr, len, &received);
+	return received;
+}
+}
+
+#endif
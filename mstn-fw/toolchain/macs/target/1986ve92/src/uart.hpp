@@ -0,0 +1,57 @@
+/** @copyright AstroSoft Ltd */
+#pragma once
+
+#include "common.hpp"
+
+struct UartData;
+
+namespace macs
+{
+class Task;
+}
+
+class Uart
+{
+public:
+	enum Port
+	{
+		Port1,
+		Port2
+	};
+
+	enum Mode
+	{
+		ModeIrq,
+		ModeDma
+	};
+
+	explicit Uart(Port port);
+	~Uart();
+
+	Result Initialize(uint32_t baud_rate, Mode mode = ModeIrq);
+	Result DeInitialize();
+
+	// возвращает управление, когда передано все или истек таймаут
+	Result Write(const void * data, size_t len, size_t * written = nullptr, uint32_t timeout_ms = INFINITE_TIMEOUT);
+	// возвращает управление, когда принято len байт, линия затихла после кадра или истек таймаут
+	Result Read(void * data, size_t len, size_t * received, uint32_t timeout_ms = INFINITE_TIMEOUT);
+	Result Flush(uint32_t timeout_ms = INFINITE_TIMEOUT);
+
+	// задача получает Task::Notify(bits) из прерывания приема, когда в кольце появляются байты:
+	// так она ждет приема вместе с другими уведомлениями, а забирает байты Read с нулевым таймаутом
+	void SetRxNotify(Task * task, uint32_t bits);
+
+	size_t GetRxCount() const;
+	ulong GetRxLost() const;
+
+	// сделать порт бэкендом _write/_read
+	void SetConsole();
+
+	// пересчет делителей всех открытых портов; вызывается из System::SetCpuFreq
+	static void OnCpuFreqChange();
+
+private:
+	CLS_COPY(Uart)
+
+	UartData * m_uart;
+};
@@ -11,6 +11,7 @@ void *__dso_handle __attribute__ ((weak));
 #include <sys/times.h>
 #include <limits.h>
 #include <signal.h>
+#include <unistd.h>
 
 void __initialize_args (int* p_argc, char*** p_argv);
 
@@ -228,10 +229,19 @@ _open(char* file __attribute__((unused)), int flags __attribute__((unused)),
 	return -1;
 }
 
+// Console backend, provided by the UART driver (uart.cpp) when MACS_USE_UART is on.
+int MacsConsoleWrite(const char* ptr, int len) __attribute__((weak));
+int MacsConsoleRead(char* ptr, int len) __attribute__((weak));
+
 int __attribute__((weak))
-_read(int file __attribute__((unused)), char* ptr __attribute__((unused)),
-	int len __attribute__((unused)))
+_read(int file, char* ptr, int len)
 {
+	if (file == STDIN_FILENO && MacsConsoleRead)
+	  {
+	    int res = MacsConsoleRead(ptr, len);
+	    if (res >= 0)
+	      return res;
+	  }
 	errno = ENOSYS;
 	return -1;
 }
@@ -282,9 +292,14 @@ _wait(int* status __attribute__((unused)))
 }
 
 int __attribute__((weak))
-_write(int file __attribute__((unused)), char* ptr __attribute__((unused)),
-	int len __attribute__((unused)))
+_write(int file, char* ptr, int len)
 {
+	if ((file == STDOUT_FILENO || file == STDERR_FILENO) && MacsConsoleWrite)
+	  {
+	    int res = MacsConsoleWrite(ptr, len);
+	    if (res >= 0)
+	      return res;
+	  }
 	errno = ENOSYS;
 	return -1;
 }
@@ -2,30 +2,28 @@
 
 void Default_Handler (void) __attribute__((weak));
 
-/* ARMCM3 Specific Interrupts */
-void WDT_IRQHandler      (void) __attribute__ ((weak, alias("Default_Handler")));
-void RTC_IRQHandler      (void) __attribute__ ((weak, alias("Default_Handler")));
-void TIM0_IRQHandler     (void) __attribute__ ((weak, alias("Default_Handler")));
-void TIM2_IRQHandler     (void) __attribute__ ((weak, alias("Default_Handler")));
-void MCIA_IRQHandler     (void) __attribute__ ((weak, alias("Default_Handler")));
-void MCIB_IRQHandler     (void) __attribute__ ((weak, alias("Default_Handler")));
-void UART0_IRQHandler    (void) __attribute__ ((weak, alias("Default_Handler")));
-void UART1_IRQHandler    (void) __attribute__ ((weak, alias("Default_Handler")));
-void UART2_IRQHandler    (void) __attribute__ ((weak, alias("Default_Handler")));
-void UART4_IRQHandler    (void) __attribute__ ((weak, alias("Default_Handler")));
-void AACI_IRQHandler     (void) __attribute__ ((weak, alias("Default_Handler")));
-void CLCD_IRQHandler     (void) __attribute__ ((weak, alias("Default_Handler")));
-void ENET_IRQHandler     (void) __attribute__ ((weak, alias("Default_Handler")));
-void USBDC_IRQHandler    (void) __attribute__ ((weak, alias("Default_Handler")));
-void USBHC_IRQHandler    (void) __attribute__ ((weak, alias("Default_Handler")));
-void CHLCD_IRQHandler    (void) __attribute__ ((weak, alias("Default_Handler")));
-void FLEXRAY_IRQHandler  (void) __attribute__ ((weak, alias("Default_Handler")));
-void CAN_IRQHandler      (void) __attribute__ ((weak, alias("Default_Handler")));
-void LIN_IRQHandler      (void) __attribute__ ((weak, alias("Default_Handler")));
-void I2C_IRQHandler      (void) __attribute__ ((weak, alias("Default_Handler")));
-void CPU_CLCD_IRQHandler (void) __attribute__ ((weak, alias("Default_Handler")));
-void UART3_IRQHandler    (void) __attribute__ ((weak, alias("Default_Handler")));
-void SPI_IRQHandler      (void) __attribute__ ((weak, alias("Default_Handler")));
+/* MDR32F9Qx Specific Interrupts */
+void CAN1_IRQHandler         (void) __attribute__ ((weak, alias("Default_Handler")));
+void CAN2_IRQHandler         (void) __attribute__ ((weak, alias("Default_Handler")));
+void USB_IRQHandler          (void) __attribute__ ((weak, alias("Default_Handler")));
+void DMA_IRQHandler          (void) __attribute__ ((weak, alias("Default_Handler")));
+void UART1_IRQHandler        (void) __attribute__ ((weak, alias("Default_Handler")));
+void UART2_IRQHandler        (void) __attribute__ ((weak, alias("Default_Handler")));
+void SSP1_IRQHandler         (void) __attribute__ ((weak, alias("Default_Handler")));
+void I2C_IRQHandler          (void) __attribute__ ((weak, alias("Default_Handler")));
+void POWER_IRQHandler        (void) __attribute__ ((weak, alias("Default_Handler")));
+void WWDG_IRQHandler         (void) __attribute__ ((weak, alias("Default_Handler")));
+void Timer1_IRQHandler       (void) __attribute__ ((weak, alias("Default_Handler")));
+void Timer2_IRQHandler       (void) __attribute__ ((weak, alias("Default_Handler")));
+void Timer3_IRQHandler       (void) __attribute__ ((weak, alias("Default_Handler")));
+void ADC_IRQHandler          (void) __attribute__ ((weak, alias("Default_Handler")));
+void COMPARATOR_IRQHandler   (void) __attribute__ ((weak, alias("Default_Handler")));
+void SSP2_IRQHandler         (void) __attribute__ ((weak, alias("Default_Handler")));
+void BACKUP_IRQHandler       (void) __attribute__ ((weak, alias("Default_Handler")));
+void EXT_INT1_IRQHandler     (void) __attribute__ ((weak, alias("Default_Handler")));
+void EXT_INT2_IRQHandler     (void) __attribute__ ((weak, alias("Default_Handler")));
+void EXT_INT3_IRQHandler     (void) __attribute__ ((weak, alias("Default_Handler")));
+void EXT_INT4_IRQHandler     (void) __attribute__ ((weak, alias("Default_Handler")));
 
 extern unsigned int __stack;
 
@@ -63,38 +61,38 @@ pHandler __isr_vectors[] __attribute__ ((section(".isr_vector"),used)) =  {
         SysTick_Handler,                          // The SysTick handler
 
 		/* External interrupts */
-		WDT_IRQHandler,                           /*  0:  Watchdog Timer            */
-		RTC_IRQHandler,                           /*  1:  Real Time Clock           */
-		TIM0_IRQHandler,                          /*  2:  Timer0 / Timer1           */
-		TIM2_IRQHandler,                          /*  3:  Timer2 / Timer3           */
-		MCIA_IRQHandler,                          /*  4:  MCIa                      */
-		MCIB_IRQHandler,                          /*  5:  MCIb                      */
-		UART0_IRQHandler,                         /*  6:  UART0 - DUT FPGA          */
-		UART1_IRQHandler,                         /*  7:  UART1 - DUT FPGA          */
-		UART2_IRQHandler,                         /*  8:  UART2 - DUT FPGA          */
-		UART4_IRQHandler,                         /*  9:  UART4 - not connected     */
-		AACI_IRQHandler,                          /* 10: AACI / AC97                */
-		CLCD_IRQHandler,                          /* 11: CLCD Combined Interrupt    */
-		ENET_IRQHandler,                          /* 12: Ethernet                   */
-		USBDC_IRQHandler,                         /* 13: USB Device                 */
-		USBHC_IRQHandler,                         /* 14: USB Host Controller        */
-		CHLCD_IRQHandler,                         /* 15: Character LCD              */
-		FLEXRAY_IRQHandler,                       /* 16: Flexray                    */
-		CAN_IRQHandler,                           /* 17: CAN                        */
-		LIN_IRQHandler,                           /* 18: LIN                        */
-		I2C_IRQHandler,                           /* 19: I2C ADC/DAC                */
-		0,                                        /* 20: Reserved                   */
+		CAN1_IRQHandler,                          /*  0: CAN1                       */
+		CAN2_IRQHandler,                          /*  1: CAN2                       */
+		USB_IRQHandler,                           /*  2: USB                        */
+		0,                                        /*  3: Reserved                   */
+		0,                                        /*  4: Reserved                   */
+		DMA_IRQHandler,                           /*  5: DMA                        */
+		UART1_IRQHandler,                         /*  6: UART1                      */
+		UART2_IRQHandler,                         /*  7: UART2                      */
+		SSP1_IRQHandler,                          /*  8: SSP1                       */
+		0,                                        /*  9: Reserved                   */
+		I2C_IRQHandler,                           /* 10: I2C                        */
+		POWER_IRQHandler,                         /* 11: POWER                      */
+		WWDG_IRQHandler,                          /* 12: WWDG                       */
+		0,                                        /* 13: Reserved                   */
+		Timer1_IRQHandler,                        /* 14: Timer1                     */
+		Timer2_IRQHandler,                        /* 15: Timer2                     */
+		Timer3_IRQHandler,                        /* 16: Timer3                     */
+		ADC_IRQHandler,                           /* 17: ADC                        */
+		0,                                        /* 18: Reserved                   */
+		COMPARATOR_IRQHandler,                    /* 19: COMPARATOR                 */
+		SSP2_IRQHandler,                          /* 20: SSP2                       */
 		0,                                        /* 21: Reserved                   */
 		0,                                        /* 22: Reserved                   */
 		0,                                        /* 23: Reserved                   */
 		0,                                        /* 24: Reserved                   */
 		0,                                        /* 25: Reserved                   */
 		0,                                        /* 26: Reserved                   */
-		0,                                        /* 27: Reserved                   */
-		CPU_CLCD_IRQHandler,                      /* 28: Reserved - CPU FPGA CLCD   */
-		0,                                        /* 29: Reserved - CPU FPGA        */
-		UART3_IRQHandler,                         /* 30: UART3    - CPU FPGA        */
-		SPI_IRQHandler                            /* 31: SPI Touchscreen - CPU FPGA */
+		BACKUP_IRQHandler,                        /* 27: BACKUP                     */
+		EXT_INT1_IRQHandler,                      /* 28: EXT_INT1                   */
+		EXT_INT2_IRQHandler,                      /* 29: EXT_INT2                   */
+		EXT_INT3_IRQHandler,                      /* 30: EXT_INT3                   */
+		EXT_INT4_IRQHandler                       /* 31: EXT_INT4                   */
 };
 
 // Processor ends up here if an unexpected interrupt occurs or a specific
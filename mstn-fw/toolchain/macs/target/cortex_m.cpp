@@ -55,6 +55,11 @@ bool SystemBase::SetTickRate(uint32_t rate_hz)
 	return true;
 }
 
+Result SystemBase::SetCpuFreq(uint32_t freq_hz)
+{
+	return IsInPrivOrIrq() ? System::SetCpuFreq_Priv(freq_hz) : SvcExecPrivileged(reinterpret_cast<void *>(freq_hz), NULL, NULL, EPM_SetCpuFreq_Priv);
+}
+
 bool SystemBase::InitScheduler()
 {
 	NVIC_SetPriority(PendSV_IRQn, INTERRUPT_MIN_PRIORITY);
@@ -73,6 +78,13 @@ void SystemBase::SwitchContext()
 }
 
 #if MACS_MCU_CORE >= MACS_CORTEX_M3
+// после сброса блок трассировки выключен и CYCCNT стоит
+void SystemBase::InitCpuTick()
+{
+	CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+	DWT->CYCCNT = 0;
+	DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+}
 ulong SystemBase::GetCurCpuTick()
 {
 	return DWT->CYCCNT;
@@ -82,6 +94,9 @@ void SystemBase::SetCurCpuTick(ulong tk)
 	DWT->CYCCNT = tk;
 }
 #else
+void SystemBase::InitCpuTick()
+{
+}
 ulong SystemBase::GetCurCpuTick()
 {
 	return 0;
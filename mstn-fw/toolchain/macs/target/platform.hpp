@@ -26,6 +26,12 @@
 #define MACS_PLATFORM_INCLUDE_1  "MDR1986VE1T.h"
 #endif	
 
+// без LDREX/STREX быстрый путь синхронизации невозможен
+#if MACS_MCU_CORE < MACS_CORTEX_M3
+#undef MACS_SYNC_FAST_PATH
+#define MACS_SYNC_FAST_PATH  0
+#endif
+
 #include "stack_frame.hpp"
 
 #if MACS_USE_MPU
@@ -142,6 +148,10 @@ public:
 	{
 		return m_len - m_top.GetVirginLen(m_margin);
 	}
+	inline StackPtr GetMargin() const
+	{
+		return m_margin;
+	}
 	bool Check();
 #if MACS_MPU_PROTECT_STACK		
 	inline void SetMpuMine() {m_margin.SetMpuMine();}
@@ -219,11 +229,21 @@ public:
 
 	static bool SetTickRate(uint32_t rate_hz);
 
+	// смена частоты ядра вместе с SysTick и тактируемой от HCLK периферией
+	static Result SetCpuFreq(uint32_t freq_hz);
+	static inline Result SetCpuFreq_Priv(uint32_t freq_hz)
+	{
+		return ResultErrorNotSupported;
+	}
+
 	static inline bool SetTickPeriod(float inPeriod)
 	{
 		return SetTickRate(1000 / inPeriod);
 	}
 
+	// счетчик тактов DWT->CYCCNT: его читают WaitNs/ReadUs, бюджет запрета прерываний,
+	// статистика объектов синхронизации, фоновые задания и профилировщик
+	static void InitCpuTick();
 	static ulong GetCurCpuTick();
 	static void SetCurCpuTick(ulong tk);
 	static ulong AskCurCpuTick();
@@ -279,4 +299,21 @@ public:
 	static void InternalSwitchContext();
 
 	static void EnterSleepMode();
+
+	enum WakeSource
+	{
+		WakeGpio = 1u << 0,
+		WakeUart = 1u << 1,
+		WakeTimer = 1u << 2
+	};
+
+	// источники, способные разбудить процессор из останова на этой платформе
+	static const uint STOP_WAKE_SOURCES = 0;
+
+	// останов не дольше max_us при запрещенных прерываниях; возвращает проспанное время,
+	// такты восстановлены, SysTick выключен. 0 - останов не поддерживается
+	static inline uint32_t EnterStopMode(uint32_t max_us)
+	{
+		return 0;
+	}
 };
@@ -58,6 +58,199 @@ void System::InitCpu()
 {
 	HAL_Init();
 	InitClock();
+
+	// LSE запускается заранее: к первому Stop он успеет выйти на режим, если кварц установлен
+	RCC->APB1ENR |= RCC_APB1ENR_PWREN;
+	PWR->CR |= PWR_CR_DBP;
+	RCC->BDCR |= RCC_BDCR_LSEON;
+}
+
+static const uint32_t LSE_HZ = 32768;
+static const uint32_t LSI_CAPTURES = 4;   // замеров по 8 периодов LSI
+
+// частота RTCCLK; SSR считает ее периоды, деленные на s_rtc_prediv_a, секунда - s_rtc_second отсчетов SSR
+static uint32_t s_rtc_hz;
+static uint32_t s_rtc_prediv_a;
+static uint32_t s_rtc_second;
+
+static inline void RtcUnlock()
+{
+	RTC->WPR = 0xCA;
+	RTC->WPR = 0x53;
+}
+
+static inline void RtcLock()
+{
+	RTC->WPR = 0xFF;
+}
+
+static inline uint32_t Bcd(uint32_t val)
+{
+	return (val >> 4) * 10 + (val & 0x0F);
+}
+
+// Частота LSI (17..47 кГц) по тактам TIM5, идущим от HSE через PLL: LSI подключен к TIM5 CH4,
+// захват на каждый 8-й его фронт
+static uint32_t MeasureLsi()
+{
+	uint32_t timer_hz = HAL_RCC_GetPCLK1Freq();
+	if ((RCC->CFGR & RCC_CFGR_PPRE1) != RCC_CFGR_PPRE1_DIV1)
+		timer_hz *= 2;
+
+	RCC->APB1ENR |= RCC_APB1ENR_TIM5EN;
+	TIM5->OR = TIM_OR_TI4_RMP_0;
+	TIM5->PSC = 0;
+	TIM5->ARR = 0xFFFFFFFF;
+	TIM5->CCMR2 = TIM_CCMR2_CC4S_0 | TIM_CCMR2_IC4PSC;
+	TIM5->CCER = TIM_CCER_CC4E;
+	TIM5->EGR = TIM_EGR_UG;
+	TIM5->SR = 0;
+	TIM5->CR1 = TIM_CR1_CEN;
+
+	uint32_t first = 0;
+	for (uint32_t i = 0; i <= LSI_CAPTURES; ++i) {
+		while (!(TIM5->SR & TIM_SR_CC4IF))
+			;
+		uint32_t capture = TIM5->CCR4;
+		if (!i)
+			first = capture;
+		else if (i == LSI_CAPTURES)
+			first = capture - first;
+	}
+
+	TIM5->CR1 = 0;
+	TIM5->CCER = 0;
+	TIM5->OR = 0;
+	RCC->APB1ENR &= ~RCC_APB1ENR_TIM5EN;
+	return (uint32_t)((uint64_t)timer_hz * 8 * LSI_CAPTURES / first);
+}
+
+// RTC от LSE, а без кварца от LSI с замеренной частотой. RTCSEL меняется только сбросом домена
+// резервного питания, поэтому RTC, включенный прошлой загрузкой от другого источника, сбрасывается.
+// Секунду отсчитывает синхронный делитель (до 2^15), асинхронный включается, только если LSI быстрее
+static void InitWakeupRtc()
+{
+	RCC->APB1ENR |= RCC_APB1ENR_PWREN;
+	PWR->CR |= PWR_CR_DBP;
+
+	bool lse = RCC->BDCR & RCC_BDCR_LSERDY;
+	uint32_t rtcsel = lse ? RCC_BDCR_RTCSEL_0 : RCC_BDCR_RTCSEL_1;
+	if ((RCC->BDCR & RCC_BDCR_RTCEN) && (RCC->BDCR & RCC_BDCR_RTCSEL) != rtcsel) {
+		RCC->BDCR |= RCC_BDCR_BDRST;
+		RCC->BDCR &= ~RCC_BDCR_BDRST;
+		if (lse) {
+			RCC->BDCR |= RCC_BDCR_LSEON;
+			while (!(RCC->BDCR & RCC_BDCR_LSERDY))
+				;
+		}
+	}
+
+	if (lse) {
+		s_rtc_hz = LSE_HZ;
+	} else {
+		RCC->BDCR &= ~RCC_BDCR_LSEON;
+		RCC->CSR |= RCC_CSR_LSION;
+		while (!(RCC->CSR & RCC_CSR_LSIRDY))
+			;
+		s_rtc_hz = MeasureLsi();
+	}
+	if (!(RCC->BDCR & RCC_BDCR_RTCEN))
+		RCC->BDCR = (RCC->BDCR & ~RCC_BDCR_RTCSEL) | rtcsel | RCC_BDCR_RTCEN;
+
+	s_rtc_prediv_a = s_rtc_hz > LSE_HZ ? 2 : 1;
+	s_rtc_second = s_rtc_hz / s_rtc_prediv_a;
+
+	RtcUnlock();
+	RTC->ISR |= RTC_ISR_INIT;
+	while (!(RTC->ISR & RTC_ISR_INITF))
+		;
+	RTC->PRER = ((s_rtc_prediv_a - 1) << RTC_PRER_PREDIV_A_Pos) | (s_rtc_second - 1);
+	RTC->CR |= RTC_CR_BYPSHAD;
+	RTC->ISR &= ~RTC_ISR_INIT;
+	RtcLock();
+
+	EXTI->IMR |= EXTI_IMR_MR22;
+	EXTI->RTSR |= EXTI_RTSR_TR22;
+	System::SetIrqPriority(RTC_WKUP_IRQn, System::MAX_SYSCALL_INTERRUPT_PRIORITY);
+	NVIC_EnableIRQ(RTC_WKUP_IRQn);
+}
+
+// отсчеты SSR с начала суток
+static uint32_t RtcNow()
+{
+	uint32_t ssr;
+	uint32_t tr;
+	do {
+		ssr = RTC->SSR;
+		tr = RTC->TR;
+	} while (ssr != RTC->SSR);
+
+	uint32_t sec = Bcd((tr >> RTC_TR_HU_Pos) & 0x3F) * 3600 + Bcd((tr >> RTC_TR_MNU_Pos) & 0x7F) * 60 + Bcd(tr & 0x7F);
+	return sec * s_rtc_second + (s_rtc_second - 1 - ssr);
+}
+
+// Stop с пробуждением от таймера RTC; после выхода система тактируется от HSI, HSE и PLL включаются заново.
+// Первый вызов только запускает RTC: замер LSI идет при работающем SysTick, и простой проходит в Sleep
+uint32_t System::EnterStopMode(uint32_t max_us)
+{
+	static bool s_rtc_ready = false;
+	if (!s_rtc_ready) {
+		InitWakeupRtc();
+		s_rtc_ready = true;
+		return 0;
+	}
+
+	uint32_t wut = (uint64_t)max_us * s_rtc_hz / 16 / 1000000;
+	if (wut < 2)
+		return 0;
+	wut = MIN(wut, 0x10000u);
+
+	RtcUnlock();
+	RTC->CR &= ~RTC_CR_WUTE;
+	while (!(RTC->ISR & RTC_ISR_WUTWF))
+		;
+	RTC->WUTR = wut - 1;
+	RTC->CR = (RTC->CR & ~RTC_CR_WUCKSEL) | RTC_CR_WUTIE | RTC_CR_WUTE;
+	RtcLock();
+
+	uint32_t rcc_cr = RCC->CR;
+	uint32_t rcc_cfgr = RCC->CFGR;
+	uint32_t start = RtcNow();
+
+	SysTick->CTRL = 0;
+	PWR->CR = (PWR->CR & ~PWR_CR_PDDS) | PWR_CR_LPDS;
+	SCB->SCR |= SCB_SCR_SLEEPDEEP_Msk;
+	__DSB();
+	__WFI();
+	SCB->SCR &= ~SCB_SCR_SLEEPDEEP_Msk;
+
+	if (rcc_cr & RCC_CR_HSEON) {
+		RCC->CR |= RCC_CR_HSEON;
+		while (!(RCC->CR & RCC_CR_HSERDY))
+			;
+	}
+	if (rcc_cr & RCC_CR_PLLON) {
+		RCC->CR |= RCC_CR_PLLON;
+		while (!(RCC->CR & RCC_CR_PLLRDY))
+			;
+	}
+	RCC->CFGR = (RCC->CFGR & ~RCC_CFGR_SW) | (rcc_cfgr & RCC_CFGR_SW);
+	while ((RCC->CFGR & RCC_CFGR_SWS) != (rcc_cfgr & RCC_CFGR_SWS))
+		;
+
+	uint32_t end = RtcNow();
+
+	RtcUnlock();
+	RTC->CR &= ~(RTC_CR_WUTE | RTC_CR_WUTIE);
+	RTC->ISR &= ~RTC_ISR_WUTF;
+	RtcLock();
+	EXTI->PR = EXTI_PR_PR22;
+	NVIC_ClearPendingIRQ(RTC_WKUP_IRQn);
+	SCB->ICSR = SCB_ICSR_PENDSTCLR_Msk;
+
+	uint32_t slept = end >= start ? end - start : 86400 * s_rtc_second - start + end;
+	uint32_t slept_us = (uint32_t)((uint64_t)slept * s_rtc_prediv_a * 1000000 / s_rtc_hz);
+	return slept_us ? slept_us : 1;
 }
 
 void System::HardFaultHandler()
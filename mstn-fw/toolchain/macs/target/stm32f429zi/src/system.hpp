@@ -22,6 +22,11 @@ public:
 	static bool SetUpIrqHandling(int irq_num, bool vector, bool enable);
 	static void RaiseIrq(int irq_num);
 
+	// в Stop работают только линии EXTI
+	static const uint STOP_WAKE_SOURCES = WakeGpio;
+
+	static uint32_t EnterStopMode(uint32_t max_us);
+
 private:
 	static void InitClock();
 };
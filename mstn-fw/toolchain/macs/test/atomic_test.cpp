@@ -0,0 +1,173 @@
+/** @copyright AstroSoft Ltd */
+
+// Атомарные операции atomic.hpp на пути M1 (секция PRIMASK): результаты операций для 8/16/32 бит
+// и указателей, восстановление PRIMASK во вложенных секциях, обертки Excl*,
+// нагрузка на fetch-add и compare-exchange из прерывания и из нескольких потоков.
+// Запрет прерываний на ПК (host/host.cpp) задерживает сигнал таймера - прерывание sim::StartIrq -
+// и исключает другие потоки. Путь LDREX/STREX (M3/M4) на ПК не собирается.
+
+#include <pthread.h>
+#include "atomic.hpp"
+#include "sim.hpp"
+
+static void TestSingle()
+{
+	volatile uint32_t u32 = 10;
+	CHECK(AtomicFetchAdd(u32, 5) == 10 && u32 == 15);
+	CHECK(AtomicFetchSub(u32, 20) == 15 && u32 == (uint32_t)-5);
+	CHECK(AtomicExchange(u32, 0xF0F0u) == (uint32_t)-5 && u32 == 0xF0F0u);
+	CHECK(AtomicSetBits(u32, 0x0F00u) == 0xF0F0u && u32 == 0xFFF0u);
+	CHECK(AtomicClearBits(u32, 0x00F0u) == 0xFFF0u && u32 == 0xFF00u);
+	CHECK(AtomicLoad(u32, OrderAcquire) == 0xFF00u);
+	AtomicStore(u32, 7u, OrderRelease);
+	CHECK(u32 == 7);
+
+	// перенос через разрядность типа
+	volatile uint8_t u8 = 0xFF;
+	CHECK(AtomicFetchAdd(u8, 2) == 0xFF && u8 == 1);
+	volatile uint16_t u16 = 0;
+	CHECK(AtomicFetchSub(u16, 1) == 0 && u16 == 0xFFFF);
+	volatile int32_t i32 = -1;
+	CHECK(AtomicFetchAdd(i32, 1) == -1 && i32 == 0);
+
+	// при неудаче expected получает текущее значение, переменная не меняется
+	volatile uint16_t cas = 100;
+	uint16_t expected = 99;
+	CHECK(!AtomicCompareExchange(cas, expected, 200) && expected == 100 && cas == 100);
+	CHECK(AtomicCompareExchange(cas, expected, 200) && expected == 100 && cas == 200);
+
+	static int a, b;
+	int * volatile ptr = &a;
+	int * old = &b;
+	CHECK(!AtomicCompareExchange(ptr, old, &b) && old == &a && ptr == &a);
+	CHECK(AtomicCompareExchange(ptr, old, &b) && ptr == &b);
+	CHECK(AtomicExchange(ptr, (int *)nullptr) == &b && ptr == nullptr);
+
+	// обертки common.hpp: ExclSet и ExclSetPtr - прежнее значение, ExclIncCnt и ExclChg - новое
+	uint8_t flag = 0;
+	CHECK(ExclSet(flag) == 0 && ExclSet(flag) == 1 && flag == 1);
+	uint8_t cnt8 = 0xFF;
+	CHECK(ExclIncCnt(cnt8) == 0);
+	ulong cnt = 41;
+	CHECK(ExclIncCnt(cnt) == 42);
+	long val = 5;
+	CHECK(ExclChg(val, -7) == -2 && val == -2);
+	void * p = &a;
+	CHECK(ExclSetPtr(p, &b) == &a && p == &b);
+}
+
+// секция операции возвращает PRIMASK, каким он был: внутри чужой секции прерывания остаются запрещены
+static void TestPrimask()
+{
+	volatile uint32_t var = 0;
+	CHECK(__get_PRIMASK() == 0);
+	AtomicFetchAdd(var, 1);
+	CHECK(__get_PRIMASK() == 0);
+
+	uint32_t mask = System::DisableIrq();
+	AtomicFetchAdd(var, 1);
+	uint32_t expected = 2;
+	CHECK(AtomicCompareExchange(var, expected, 3u));
+	expected = 0;
+	CHECK(!AtomicCompareExchange(var, expected, 4u));
+	CHECK(__get_PRIMASK() == 1);
+	System::EnableIrq(mask);
+	CHECK(__get_PRIMASK() == 0 && var == 3);
+}
+
+static volatile uint32_t s_irq_sum;
+static volatile uint32_t s_irq_cas_sum;
+static volatile uint32_t s_irq_count;
+
+static void IncrementByCas(volatile uint32_t & var)
+{
+	uint32_t cur = AtomicLoad(var, OrderRelaxed);
+	while (!AtomicCompareExchange(var, cur, cur + 1))
+		;
+}
+
+static void OnIrq()
+{
+	AtomicFetchAdd(s_irq_sum, 1);
+	IncrementByCas(s_irq_cas_sum);
+	++s_irq_count;
+}
+
+// прерывание приходит между любыми командами задачи, но не внутри секции операции
+static void TestIrq()
+{
+	const uint32_t IRQS = 5000;
+	uint32_t loops = 0;
+	sim::StartIrq(OnIrq, 20);
+	while (s_irq_count < IRQS) {
+		AtomicFetchAdd(s_irq_sum, 1);
+		IncrementByCas(s_irq_cas_sum);
+		++loops;
+	}
+	sim::StopIrq();
+
+	CHECK(s_irq_sum == loops + s_irq_count);
+	CHECK(s_irq_cas_sum == loops + s_irq_count);
+	CHECK(__get_PRIMASK() == 0);
+}
+
+static const unsigned THREADS = 8;
+static const unsigned LOOPS = 200000;
+
+static volatile uint32_t s_sum;
+static volatile uint16_t s_sum16;
+static volatile uint32_t s_cas_sum;
+static volatile uint8_t s_spin;
+static uint32_t s_guarded;
+static uint32_t s_guarded_errors;
+
+static void * StressThread(void * arg)
+{
+	uintptr_t id = (uintptr_t)arg;
+	for (unsigned i = 0; i < LOOPS; ++i) {
+		AtomicFetchAdd(s_sum, (uint32_t)(id + 1));
+		AtomicFetchAdd(s_sum16, (uint16_t)1, OrderRelaxed);
+
+		// приращение через compare-exchange с повтором, как максимум в профайлере
+		IncrementByCas(s_cas_sum);
+
+		// замок на compare-exchange: между захватом и освобождением никто не вмешивается
+		if (i % 8 == 0) {
+			uint8_t unlocked = 0;
+			while (!AtomicCompareExchange(s_spin, unlocked, (uint8_t)1, OrderAcquire))
+				unlocked = 0;
+			uint32_t before = s_guarded;
+			s_guarded = before + 1;
+			if (s_guarded != before + 1)
+				++s_guarded_errors;
+			AtomicStore(s_spin, (uint8_t)0, OrderRelease);
+		}
+	}
+	return nullptr;
+}
+
+static void TestStress()
+{
+	pthread_t threads[THREADS];
+	for (uintptr_t i = 0; i < THREADS; ++i)
+		CHECK(pthread_create(&threads[i], nullptr, StressThread, (void *)i) == 0);
+	for (unsigned i = 0; i < THREADS; ++i)
+		pthread_join(threads[i], nullptr);
+
+	CHECK(s_sum == LOOPS * THREADS * (THREADS + 1) / 2);
+	CHECK(s_sum16 == (uint16_t)(LOOPS * THREADS));
+	CHECK(s_cas_sum == LOOPS * THREADS);
+	CHECK(s_guarded == THREADS * ((LOOPS + 7) / 8));
+	CHECK(s_guarded_errors == 0);
+	CHECK(s_spin == 0);
+}
+
+int main()
+{
+	TestSingle();
+	TestPrimask();
+	TestIrq();
+	TestStress();
+
+	return sim::Result();
+}
@@ -0,0 +1,134 @@
+/** @copyright AstroSoft Ltd */
+
+// Замер круга запрос-ответ через две очереди: Push запроса и Pop ответа против одного CallReply.
+// Клиент и сервер - непривилегированные задачи-потоки; на круг считаются вызовы SVC и переключения задач
+// при сервере выше клиента, на одном приоритете с ним и ниже.
+// Сервер выше: после Push он вытесняет клиента и отвечает, Pop берет готовый ответ без SVC, а CallReply
+// блокирует клиента до ответа, и сервер будит его лишним SVC. На одном приоритете Push не вытесняет,
+// и CallReply экономит вызов, объединяя выпуск запроса с блокировкой.
+
+#include "message_queue.hpp"
+#include "sim.hpp"
+
+using sim::TestTask;
+using sim::ThreadTask;
+
+static const uint32_t ROUNDS = 100;
+
+static MessageQueue<uint32_t> s_requests(4);
+static MessageQueue<uint32_t> s_replies(4);
+
+enum CallMode
+{
+	CallPushPop,
+	CallReplyMode
+};
+
+struct Counts
+{
+	ulong m_svc;
+	ulong m_switches;
+};
+
+class Server: public ThreadTask
+{
+public:
+	Server() :
+			ThreadTask("Server")
+	{
+	}
+private:
+	virtual void Execute()
+	{
+		uint32_t request;
+		for (;;) {
+			s_requests.Pop(request);
+			s_replies.Push(request + 1);
+		}
+	}
+};
+
+// ROUNDS кругов по сигналу m_go
+class Client: public ThreadTask
+{
+public:
+	Client() :
+			ThreadTask("Client"),
+			m_mode(CallPushPop)
+	{
+	}
+
+	BinarySemaphore m_go;
+	CallMode m_mode;
+	Counts m_counts;
+
+private:
+	virtual void Execute()
+	{
+		for (;;) {
+			m_go.Wait();
+			ulong svc = sim::SvcCalls();
+			ulong switches = sim::ContextSwitches();
+			for (uint32_t i = 0; i < ROUNDS; ++i) {
+				uint32_t reply = 0;
+				if (m_mode == CallPushPop) {
+					s_requests.Push(i);
+					s_replies.Pop(reply);
+				} else {
+					s_requests.CallReply(i, s_replies, reply);
+				}
+				CHECK(reply == i + 1);
+			}
+			m_counts.m_svc = sim::SvcCalls() - svc;
+			m_counts.m_switches = sim::ContextSwitches() - switches;
+		}
+	}
+};
+
+static TestTask s_driver("Driver");
+static Server s_server;
+static Client s_client;
+
+static Counts Measure(CallMode mode)
+{
+	s_client.m_mode = mode;
+	s_client.m_go.Signal();
+	sim::Dispatch();
+	CHECK(Task::GetCurrent() == &s_driver);
+	return s_client.m_counts;
+}
+
+int main()
+{
+	static const struct
+	{
+		const char * m_name;
+		Task::Priority m_server;
+	} configs[] = {
+		{"server above", Task::PriorityHigh},
+		{"same", Task::PriorityNormal},
+		{"server below", Task::PriorityBelowNormal}};
+
+	sim::ModelPrivilege(true);
+	Task::Add(&s_driver, Task::PriorityLow);
+	Task::Add(&s_server, Task::PriorityHigh);
+	Task::Add(&s_client, Task::PriorityNormal);
+	sim::Start();
+	CHECK(Task::GetCurrent() == &s_driver);
+
+	printf("%-14s %16s %16s %16s %16s\n", "", "Push+Pop svc", "switches", "CallReply svc", "switches");
+	for (size_t i = 0; i < countof(configs); ++i) {
+		CHECK(s_server.SetPriority(configs[i].m_server) == ResultOk);
+		Counts two = Measure(CallPushPop);
+		Counts one = Measure(CallReplyMode);
+		printf("%-14s %16.2f %16.2f %16.2f %16.2f\n", configs[i].m_name,
+				(double)two.m_svc / ROUNDS, (double)two.m_switches / ROUNDS,
+				(double)one.m_svc / ROUNDS, (double)one.m_switches / ROUNDS);
+
+		CHECK(one.m_switches <= two.m_switches);
+		if (configs[i].m_server == Task::PriorityNormal)
+			CHECK(one.m_svc < two.m_svc);
+	}
+
+	return sim::Result();
+}
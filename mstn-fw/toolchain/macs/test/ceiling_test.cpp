@@ -0,0 +1,103 @@
+/** @copyright AstroSoft Ltd */
+
+// Мьютекс с потолком приоритета (Mutex(ceiling)): подъем владельца, вложенные захваты, нарушение потолка
+
+#include "mutex.hpp"
+#include "sim.hpp"
+
+using sim::TestTask;
+
+static TestTask s_low("Low");
+static TestTask s_high("High");
+
+static Mutex s_ceil_high(Task::PriorityHigh);
+static Mutex s_ceil_above(Task::PriorityAboveNormal);
+static Mutex s_plain;
+
+// Low: захват потолка High, затем вложенный захват потолка AboveNormal
+static void TestNestedLowerCeiling()
+{
+	CHECK(Task::GetCurrent() == &s_low);
+
+	CHECK(s_ceil_high.Lock() == ResultOk);
+	CHECK(s_low.GetPriority() == Task::PriorityHigh);
+	CHECK(s_low.GetBasePriority() == Task::PriorityLow);
+
+	CHECK(s_ceil_above.Lock() == ResultOk);
+	CHECK(s_ceil_above.IsLocked());
+	CHECK(s_low.GetPriority() == Task::PriorityHigh);
+
+	CHECK(s_ceil_above.Unlock() == ResultOk);
+	CHECK(s_low.GetPriority() == Task::PriorityHigh);
+	CHECK(s_ceil_high.Unlock() == ResultOk);
+	CHECK(s_low.GetPriority() == Task::PriorityLow);
+}
+
+// тот же вложенный захват в обратном порядке поднимает владельца ступенями
+static void TestNestedHigherCeiling()
+{
+	CHECK(s_ceil_above.Lock() == ResultOk);
+	CHECK(s_low.GetPriority() == Task::PriorityAboveNormal);
+	CHECK(s_ceil_high.Lock() == ResultOk);
+	CHECK(s_low.GetPriority() == Task::PriorityHigh);
+
+	CHECK(s_ceil_high.Unlock() == ResultOk);
+	CHECK(s_low.GetPriority() == Task::PriorityAboveNormal);
+	CHECK(s_ceil_above.Unlock() == ResultOk);
+	CHECK(s_low.GetPriority() == Task::PriorityLow);
+}
+
+// Low поднят наследованием выше потолка и захватывает мьютекс с потолком - это не нарушение
+static void TestInheritedAboveCeiling()
+{
+	CHECK(s_plain.Lock() == ResultOk);
+
+	// High просыпается и ждет мьютекс Low
+	sim::Tick(20);
+	CHECK(Task::GetCurrent() == &s_high);
+	s_plain.Lock();
+	sim::Dispatch();
+	CHECK(Task::GetCurrent() == &s_low);
+	CHECK(s_low.GetPriority() == Task::PriorityHigh);
+
+	CHECK(s_ceil_above.Lock() == ResultOk);
+	CHECK(s_low.GetPriority() == Task::PriorityHigh);
+	CHECK(s_ceil_above.Unlock() == ResultOk);
+
+	// отдал мьютекс - High вытесняет Low
+	s_plain.Unlock();
+	sim::Dispatch();
+	CHECK(Task::GetCurrent() == &s_high);
+	CHECK(s_plain.IsLocked());
+	CHECK(s_low.GetPriority() == Task::PriorityLow);
+	CHECK(s_plain.Unlock() == ResultOk);
+}
+
+// собственный приоритет выше потолка - ошибка протокола
+static void TestCeilingViolation()
+{
+	CHECK(Task::GetCurrent() == &s_high);
+	CHECK(s_ceil_above.Lock() == ResultErrorInvalidArgs);
+	CHECK(!s_ceil_above.IsLocked());
+	CHECK(s_ceil_high.Lock() == ResultOk);
+	CHECK(s_ceil_high.Unlock() == ResultOk);
+}
+
+int main()
+{
+	Task::Add(&s_low, Task::PriorityLow);
+	Task::Add(&s_high, Task::PriorityHigh);
+	sim::Start();
+
+	// High спит, пока Low проверяет вложенные захваты
+	CHECK(Task::GetCurrent() == &s_high);
+	Task::Delay(10);
+	sim::Dispatch();
+
+	TestNestedLowerCeiling();
+	TestNestedHigherCeiling();
+	TestInheritedAboveCeiling();
+	TestCeilingViolation();
+
+	return sim::Result();
+}
@@ -0,0 +1,299 @@
+/** @copyright AstroSoft Ltd */
+
+// EDF в полосе MACS_EDF_PRIORITY (MACS_EDF_ENABLED=1).
+// Проверка планируемости: наборы периодических задач (C, T, D) исполняются ядром по тикам,
+// пропуски сроков сравниваются с аналитикой - тестом спроса на процессор (dbf) и загрузкой U > 1.
+// Замер: упорядоченный список готовых задач (DListOrd, как TaskWorkList) против двоичной кучи
+// на том же потоке выпусков - сравнения и время на выпуск при N готовых задачах в полосе.
+
+#include <chrono>
+#include "scheduler.hpp"
+#include "sim.hpp"
+
+using sim::TestTask;
+
+struct PeriodicSpec
+{
+	uint32_t m_c;
+	uint32_t m_t;
+	uint32_t m_d;
+};
+
+static const unsigned MAX_SET = 4;
+
+static uint32_t Gcd(uint32_t a, uint32_t b)
+{
+	while (b) {
+		uint32_t r = a % b;
+		a = b;
+		b = r;
+	}
+	return a;
+}
+
+static uint32_t Hyperperiod(const PeriodicSpec * set, unsigned n)
+{
+	uint32_t h = 1;
+	for (unsigned i = 0; i < n; ++i)
+		h = h / Gcd(h, set[i].m_t) * set[i].m_t;
+	return h;
+}
+
+// спрос на процессор за любой интервал длины L не больше L - набор планируем по EDF при любых фазах;
+// при D <= T достаточно проверить сроки до гиперпериода плюс наибольшего D
+static bool DemandBoundOk(const PeriodicSpec * set, unsigned n)
+{
+	uint32_t max_d = 0;
+	for (unsigned i = 0; i < n; ++i)
+		max_d = set[i].m_d > max_d ? set[i].m_d : max_d;
+
+	uint32_t horizon = Hyperperiod(set, n) + max_d;
+	for (uint32_t len = 1; len <= horizon; ++len) {
+		uint32_t demand = 0;
+		for (unsigned i = 0; i < n; ++i)
+			if (len >= set[i].m_d)
+				demand += ((len - set[i].m_d) / set[i].m_t + 1) * set[i].m_c;
+		if (demand > len)
+			return false;
+	}
+	return true;
+}
+
+static bool Overloaded(const PeriodicSpec * set, unsigned n)
+{
+	// сумма C/T > 1 в целых: сумма C * H/T > H
+	uint32_t h = Hyperperiod(set, n), busy = 0;
+	for (unsigned i = 0; i < n; ++i)
+		busy += set[i].m_c * (h / set[i].m_t);
+	return busy > h;
+}
+
+static TestTask s_driver("Driver");
+
+// задачи набора получают по тику работы, пока у текущей не кончится C, затем WaitNextPeriod;
+// пропуск - работа закончена позже срока или не закончена к сроку
+static uint32_t RunSet(const PeriodicSpec * set, unsigned n, uint32_t ticks)
+{
+	TestTask * tasks[MAX_SET];
+	uint32_t left[MAX_SET];
+	uint32_t misses = 0;
+
+	CHECK(Task::GetCurrent() == &s_driver);
+	for (unsigned i = 0; i < n; ++i) {
+		tasks[i] = new TestTask("Job");
+		left[i] = set[i].m_c;
+		CHECK(Task::Add(tasks[i], MACS_EDF_PRIORITY) == ResultOk);
+	}
+	Task::Delay(ticks + 1);
+	sim::Dispatch();
+
+	// задачи встают на период в одном тике, первый выпуск - через период
+	for (unsigned i = 0; i < n; ++i) {
+		CHECK(Task::GetCurrent() == tasks[i]);
+		CHECK(Task::SetPeriod(set[i].m_t, set[i].m_d) == ResultOk);
+		CHECK(Task::WaitNextPeriod() == ResultOk);
+		sim::Dispatch();
+	}
+
+	while (Task::GetCurrent() != &s_driver) {
+		Task * cur = Task::GetCurrent();
+		tick_t now = Sch().GetTickCount();
+		for (unsigned i = 0; i < n; ++i) {
+			if (cur != tasks[i] || --left[i])
+				continue;
+			// работа закончена к концу тика now
+			if ((int32_t)(now + 1 - tasks[i]->GetDeadline()) > 0)
+				++misses;
+			left[i] = set[i].m_c;
+			Task::WaitNextPeriod();
+			sim::Dispatch();
+		}
+		sim::Tick(1);
+	}
+
+	tick_t now = Sch().GetTickCount();
+	for (unsigned i = 0; i < n; ++i) {
+		if (left[i] != set[i].m_c && (int32_t)(now - tasks[i]->GetDeadline()) > 0)
+			++misses;
+		CHECK(tasks[i]->Delete() == ResultOk);
+	}
+	return misses;
+}
+
+static void CheckSet(const char * name, const PeriodicSpec * set, unsigned n)
+{
+	bool schedulable = DemandBoundOk(set, n);
+	uint32_t misses = RunSet(set, n, 4 * Hyperperiod(set, n));
+	printf("%-28s dbf %-3s misses %u\n", name, schedulable ? "ok" : "no", misses);
+
+	if (schedulable)
+		CHECK(misses == 0);
+	if (Overloaded(set, n))
+		CHECK(misses > 0);
+}
+
+static void TestSchedulability()
+{
+	// U = 0.97: по RM вторая задача опаздывает (отклик 8 > 7), по EDF - нет
+	const PeriodicSpec rm_fails[] = { {2, 5, 5}, {4, 7, 7} };
+	CheckSet("U=0.97, fails under RM", rm_fails, 2);
+
+	// U = 1 ровно
+	const PeriodicSpec full[] = { {1, 4, 4}, {2, 6, 6}, {5, 12, 12} };
+	CheckSet("U=1.00", full, 3);
+
+	// сроки короче периодов
+	const PeriodicSpec constrained[] = { {1, 4, 3}, {2, 6, 5}, {3, 12, 10} };
+	CheckSet("U=0.83, D<T", constrained, 3);
+
+	// U = 1.1
+	const PeriodicSpec overload[] = { {3, 5, 5}, {3, 6, 6} };
+	CheckSet("U=1.10", overload, 2);
+}
+
+// модель готовой задачи полосы: срок и поля очереди
+struct Job
+{
+	Job * m_next;
+	Job ** m_prev;
+	tick_t m_deadline;
+	uint32_t m_period;
+	uint32_t m_heap_pos;
+};
+
+static ulong s_compares;
+
+static inline bool EarlierDeadline(Job * a, Job * b)
+{
+	++s_compares;
+	return (int32_t)(a->m_deadline - b->m_deadline) < 0;
+}
+
+DLISTORD_DECLARE(JobList, Job, m_next, m_prev, EarlierDeadline);
+
+// двоичная куча с позицией в элементе: снятие произвольной задачи (блокировка, удаление) - O(log N)
+class JobHeap
+{
+public:
+	JobHeap() :
+			m_count(0)
+	{
+	}
+	void Push(Job * job)
+	{
+		job->m_heap_pos = m_count;
+		m_heap[m_count++] = job;
+		Up(job->m_heap_pos);
+	}
+	Job * Pop()
+	{
+		Job * top = m_heap[0];
+		Place(m_heap[--m_count], 0);
+		Down(0);
+		return top;
+	}
+private:
+	void Place(Job * job, uint32_t pos)
+	{
+		m_heap[pos] = job;
+		job->m_heap_pos = pos;
+	}
+	void Up(uint32_t pos)
+	{
+		Job * job = m_heap[pos];
+		while (pos && EarlierDeadline(job, m_heap[(pos - 1) / 2])) {
+			Place(m_heap[(pos - 1) / 2], pos);
+			pos = (pos - 1) / 2;
+		}
+		Place(job, pos);
+	}
+	void Down(uint32_t pos)
+	{
+		Job * job = m_heap[pos];
+		for (;;) {
+			uint32_t child = 2 * pos + 1;
+			if (child >= m_count)
+				break;
+			if (child + 1 < m_count && EarlierDeadline(m_heap[child + 1], m_heap[child]))
+				++child;
+			if (!EarlierDeadline(m_heap[child], job))
+				break;
+			Place(m_heap[child], pos);
+			pos = child;
+		}
+		Place(job, pos);
+	}
+
+	static const uint32_t MAX_JOBS = 64;
+	Job * m_heap[MAX_JOBS];
+	uint32_t m_count;
+};
+
+static void InitJobs(Job * jobs, unsigned n)
+{
+	for (unsigned i = 0; i < n; ++i) {
+		jobs[i].m_period = 10 + 7 * i;
+		jobs[i].m_deadline = jobs[i].m_period;
+	}
+}
+
+// выпуск: задача с ближайшим сроком отработала и встает обратно со следующим сроком
+static void TestReadyListCost()
+{
+	const unsigned SIZES[] = { 2, 4, 8, 16, 32, 64 };
+	const unsigned RELEASES = 200000;
+
+	printf("%4s %12s %12s %10s %10s\n", "N", "list cmp", "heap cmp", "list ns", "heap ns");
+	for (unsigned s = 0; s < sizeof(SIZES) / sizeof(SIZES[0]); ++s) {
+		unsigned n = SIZES[s];
+		Job list_jobs[64] = {}, heap_jobs[64] = {};
+		InitJobs(list_jobs, n);
+		InitJobs(heap_jobs, n);
+
+		Job * list = nullptr;
+		JobHeap heap;
+		for (unsigned i = 0; i < n; ++i) {
+			JobList::Add(list, &list_jobs[i]);
+			heap.Push(&heap_jobs[i]);
+		}
+
+		s_compares = 0;
+		tick_t list_sum = 0;
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		for (unsigned r = 0; r < RELEASES; ++r) {
+			Job * job = JobList::Fetch(list);
+			list_sum += job->m_deadline;
+			job->m_deadline += job->m_period;
+			JobList::Add(list, job);
+		}
+		double list_ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / RELEASES;
+		double list_cmp = (double)s_compares / RELEASES;
+
+		s_compares = 0;
+		tick_t heap_sum = 0;
+		start = std::chrono::steady_clock::now();
+		for (unsigned r = 0; r < RELEASES; ++r) {
+			Job * job = heap.Pop();
+			heap_sum += job->m_deadline;
+			job->m_deadline += job->m_period;
+			heap.Push(job);
+		}
+		double heap_ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / RELEASES;
+		double heap_cmp = (double)s_compares / RELEASES;
+
+		// обе очереди выдают задачи в порядке сроков
+		CHECK(list_sum == heap_sum);
+		printf("%4u %12.1f %12.1f %10.1f %10.1f\n", n, list_cmp, heap_cmp, list_ns, heap_ns);
+	}
+}
+
+int main()
+{
+	Task::Add(&s_driver, Task::PriorityHigh);
+	sim::Start();
+
+	TestSchedulability();
+	TestReadyListCost();
+
+	return sim::Result();
+}
@@ -0,0 +1,97 @@
+/** @copyright AstroSoft Ltd */
+
+// Быстрый путь мьютекса (MACS_SYNC_FAST_PATH): удаление задачи освобождает мьютексы,
+// захваченные ею без входа в ядро, и взятые ядром на учет при конфликте
+
+#include "mutex.hpp"
+#include "sim.hpp"
+
+using sim::TestTask;
+
+// A и B удаляются тестом вместе с памятью
+static TestTask * s_a;
+static TestTask * s_b;
+static TestTask s_c("C");
+
+static Mutex s_m1;
+static Mutex s_m2;
+static Mutex s_m3;
+
+// A держит m1 и m3 быстрым путем, B ждет m1; C удаляет A - m1 переходит к B, m3 свободен
+static void TestDeleteFastOwner()
+{
+	CHECK(Task::GetCurrent() == s_a);
+	CHECK(s_m1.Lock() == ResultOk);
+	CHECK(s_m2.Lock() == ResultOk);
+	CHECK(s_m3.Lock() == ResultOk);
+	CHECK(s_m2.Unlock() == ResultOk);
+	CHECK(s_m1.IsLocked() && !s_m2.IsLocked() && s_m3.IsLocked());
+	Task::Delay(10);
+	sim::Dispatch();
+
+	CHECK(Task::GetCurrent() == s_b);
+	s_m1.Lock();
+	sim::Dispatch();
+
+	CHECK(Task::GetCurrent() == &s_c);
+	CHECK(s_a->Delete() == ResultOk);
+	CHECK(!s_m3.IsLocked());
+	sim::Dispatch();
+
+	CHECK(Task::GetCurrent() == s_b);
+	CHECK(s_b->Reason() == Task::UnblockReasonRequest);
+	CHECK(s_m1.IsLocked());
+	CHECK(s_m1.Unlock() == ResultOk);
+	CHECK(!s_m1.IsLocked());
+}
+
+// мьютекс, взятый ядром на учет и отданный через ядро, уходит из списка B;
+// удаление B освобождает только то, что B держит
+static void TestDeleteAfterAdopt()
+{
+	CHECK(s_m1.Lock() == ResultOk);
+	Task::Delay(10);
+	sim::Dispatch();
+
+	CHECK(Task::GetCurrent() == &s_c);
+	s_m1.Lock();
+	sim::Dispatch();
+	CHECK(Task::GetCurrent() != &s_c);
+
+	sim::Tick(20);
+	CHECK(Task::GetCurrent() == s_b);
+	CHECK(s_m1.Unlock() == ResultOk);
+	CHECK(s_c.Reason() == Task::UnblockReasonRequest);
+	CHECK(s_m2.Lock() == ResultOk);
+	Task::Delay(10);
+	sim::Dispatch();
+
+	CHECK(Task::GetCurrent() == &s_c);
+	CHECK(s_m1.IsLocked());
+	CHECK(s_b->Delete() == ResultOk);
+	CHECK(!s_m2.IsLocked());
+	CHECK(s_m1.IsLocked());
+	CHECK(s_m1.Unlock() == ResultOk);
+
+	// C снова берет m1 быстрым путем и отдает - список C цел
+	CHECK(s_m1.Lock() == ResultOk);
+	CHECK(s_m2.Lock() == ResultOk);
+	CHECK(s_m1.Unlock() == ResultOk);
+	CHECK(s_m2.Unlock() == ResultOk);
+	CHECK(!s_m1.IsLocked() && !s_m2.IsLocked());
+}
+
+int main()
+{
+	s_a = new TestTask("A");
+	s_b = new TestTask("B");
+	Task::Add(s_a, Task::PriorityHigh);
+	Task::Add(s_b, Task::PriorityNormal);
+	Task::Add(&s_c, Task::PriorityLow);
+	sim::Start();
+
+	TestDeleteFastOwner();
+	TestDeleteAfterAdopt();
+
+	return sim::Result();
+}
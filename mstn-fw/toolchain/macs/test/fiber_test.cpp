@@ -0,0 +1,208 @@
+/** @copyright AstroSoft Ltd */
+
+// Волокна на одном хозяине: сон, ожидание семафора, таймаут ожидания и семафоры сверх набора ожидания,
+// которые хозяин опрашивает каждый тик. Хозяин проходит по волокнам через Step(), его Execute() не исполняется.
+
+#include "fiber.hpp"
+#include "sim.hpp"
+
+using sim::TestTask;
+
+class TestHost: public FiberHost
+{
+public:
+	TestHost() :
+			FiberHost("Host")
+	{
+	}
+	using FiberHost::Step;
+};
+
+// спит SLEEPS раз и завершается
+class SleepFiber: public Fiber
+{
+public:
+	static const uint SLEEPS = 3;
+
+	explicit SleepFiber(uint32_t period_ms) :
+			m_count(0),
+			m_period_ms(period_ms)
+	{
+	}
+	uint m_count;
+
+private:
+	virtual void Run()
+	{
+		FIBER_BEGIN();
+		while (++m_count <= SLEEPS)
+			FIBER_SLEEP(m_period_ms);
+		FIBER_END();
+	}
+
+	uint32_t m_period_ms;
+};
+
+// ждет семафор, пока не истечет таймаут
+class WaitFiber: public Fiber
+{
+public:
+	WaitFiber(Semaphore & sem, uint32_t timeout_ms) :
+			m_count(0),
+			m_last(ResultErrorInvalidState),
+			m_sem(sem),
+			m_timeout_ms(timeout_ms)
+	{
+	}
+	uint m_count;
+	Result m_last;
+
+private:
+	virtual void Run()
+	{
+		FIBER_BEGIN();
+		for (;;) {
+			FIBER_WAIT(m_sem, m_timeout_ms);
+			m_last = GetWaitResult();
+			++m_count;
+			if (m_last == ResultTimeout)
+				break;
+		}
+		FIBER_END();
+	}
+
+	Semaphore & m_sem;
+	uint32_t m_timeout_ms;
+};
+
+static TestHost s_host;
+static TestTask s_driver("Driver");
+
+// проходы хозяина, пока он не заснет; текущей становится Driver
+static void RunHost()
+{
+	for (int i = 0; i < 10 && Task::GetCurrent() == &s_host; ++i) {
+		s_host.Step();
+		sim::Dispatch();
+	}
+	CHECK(Task::GetCurrent() == &s_driver);
+}
+
+// тики до пробуждения хозяина
+static uint32_t TicksUntilHost(uint32_t max_ticks)
+{
+	uint32_t ticks = 0;
+	while (Task::GetCurrent() != &s_host && ticks < max_ticks) {
+		sim::Tick();
+		++ticks;
+	}
+	return ticks;
+}
+
+static void TestSleep()
+{
+	static SleepFiber fiber(10);
+	s_host.Add(fiber);
+	sim::Dispatch();
+	RunHost();
+	CHECK(fiber.m_count == 1);
+
+	for (uint i = 2; i <= SleepFiber::SLEEPS + 1; ++i) {
+		uint32_t ticks = TicksUntilHost(100);
+		CHECK(ticks >= 10 && ticks <= 11);
+		RunHost();
+		CHECK(fiber.m_count == i);
+	}
+	CHECK(fiber.GetState() == Fiber::StateFinished);
+
+	// завершенное волокно хозяина не будит
+	CHECK(TicksUntilHost(100) == 100);
+}
+
+static Semaphore s_sem;
+
+static void TestSemaphoreWait()
+{
+	static WaitFiber fiber(s_sem, INFINITE_TIMEOUT);
+	s_host.Add(fiber);
+	sim::Dispatch();
+	RunHost();
+	CHECK(fiber.m_count == 0);
+	CHECK(fiber.GetState() == Fiber::StateWaiting);
+
+	// набор только будит хозяина, счетчик забирает волокно
+	s_sem.Signal();
+	sim::Dispatch();
+	CHECK(Task::GetCurrent() == &s_host);
+	CHECK(s_sem.GetCurrentCount() == 1);
+	RunHost();
+	CHECK(fiber.m_count == 1 && fiber.m_last == ResultOk);
+	CHECK(s_sem.GetCurrentCount() == 0);
+	CHECK(fiber.GetState() == Fiber::StateWaiting);
+}
+
+static Semaphore s_never;
+
+static void TestTimeout()
+{
+	static WaitFiber fiber(s_never, 5);
+	s_host.Add(fiber);
+	sim::Dispatch();
+	RunHost();
+	CHECK(fiber.m_count == 0);
+
+	uint32_t ticks = TicksUntilHost(100);
+	CHECK(ticks >= 5 && ticks <= 6);
+	RunHost();
+	CHECK(fiber.m_count == 1 && fiber.m_last == ResultTimeout);
+	CHECK(fiber.GetState() == Fiber::StateFinished);
+}
+
+// волокна добавляются в голову списка: Kick, s_sem и последние добавленные займут набор,
+// а первые два волокна в него не поместятся
+static const size_t EXTRA = WaitSet::MAX_OBJECTS;
+
+static void TestWaitSetOverflow()
+{
+	static Semaphore sems[EXTRA];
+	static WaitFiber * fibers[EXTRA];
+	for (size_t i = 0; i < EXTRA; ++i) {
+		fibers[i] = new WaitFiber(sems[i], INFINITE_TIMEOUT);
+		s_host.Add(*fibers[i]);
+		sim::Dispatch();
+		RunHost();
+	}
+
+	// семафор в наборе будит хозяина сразу
+	sems[EXTRA - 1].Signal();
+	sim::Dispatch();
+	CHECK(Task::GetCurrent() == &s_host);
+	RunHost();
+	CHECK(fibers[EXTRA - 1]->m_count == 1);
+
+	// семафор вне набора подхватывается опросом на следующем тике
+	sems[0].Signal();
+	sim::Dispatch();
+	CHECK(Task::GetCurrent() == &s_driver);
+	CHECK(TicksUntilHost(100) <= 2);
+	RunHost();
+	CHECK(fibers[0]->m_count == 1 && fibers[0]->m_last == ResultOk);
+	CHECK(sems[0].GetCurrentCount() == 0);
+}
+
+int main()
+{
+	Task::Add(&s_driver, Task::PriorityLow);
+	Task::Add(&s_host, Task::PriorityHigh);
+	sim::Start();
+
+	CHECK(Task::GetCurrent() == &s_host);
+	RunHost();
+
+	TestSleep();
+	TestSemaphoreWait();
+	TestTimeout();
+	TestWaitSetOverflow();
+
+	return sim::Result();
+}
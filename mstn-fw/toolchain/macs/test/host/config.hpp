@@ -0,0 +1,3 @@
+#pragma once
+
+// настройки ядра задаются тестами из Makefile
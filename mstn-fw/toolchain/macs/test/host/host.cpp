@@ -0,0 +1,395 @@
+/** @copyright AstroSoft Ltd */
+
+#include <pthread.h>
+#include <signal.h>
+#include <sys/time.h>
+#include <stdlib.h>
+#include <execinfo.h>
+#include "system.hpp"
+#include "application.hpp"
+#include "sim.hpp"
+
+uint32_t SystemCoreClock = 80000000;
+
+// запрет прерываний один на процесс: поток, запретивший их, исключает остальные
+// и не принимает сигнал таймера, который играет роль прерывания (sim::StartIrq)
+static pthread_mutex_t s_irq_lock = PTHREAD_MUTEX_INITIALIZER;
+static __thread uint32_t s_primask = 0;
+static __thread sigset_t s_saved_sigmask;
+static ulong s_irq_masks = 0;
+
+uint32_t __get_PRIMASK()
+{
+	return s_primask;
+}
+
+void __set_PRIMASK(uint32_t primask)
+{
+	if (primask && !s_primask) {
+		sigset_t irq;
+		sigemptyset(&irq);
+		sigaddset(&irq, SIGALRM);
+		pthread_sigmask(SIG_BLOCK, &irq, &s_saved_sigmask);
+		pthread_mutex_lock(&s_irq_lock);
+		s_primask = primask;
+		++s_irq_masks;
+	} else if (!primask && s_primask) {
+		s_primask = 0;
+		pthread_mutex_unlock(&s_irq_lock);
+		pthread_sigmask(SIG_SETMASK, &s_saved_sigmask, nullptr);
+	}
+}
+
+void __disable_irq()
+{
+	__set_PRIMASK(1);
+}
+
+void __enable_irq()
+{
+	__set_PRIMASK(0);
+}
+
+static bool s_in_irq = false;
+static bool s_switch_pending = false;
+static ulong s_cycles = 0;
+static ulong s_switches = 0;
+
+// режим задач (sim::ModelPrivilege): обработчики SVC, SysTick и PendSV всегда привилегированные
+static bool s_model_priv = false;
+static bool s_task_priv = true;
+static bool s_in_handler = false;
+static ulong s_svc_calls = 0;
+
+uint32_t SystemBase::DisableIrq()
+{
+	uint32_t prev = __get_PRIMASK();
+	__disable_irq();
+	return prev;
+}
+
+void SystemBase::EnableIrq(uint32_t mask)
+{
+	__set_PRIMASK(mask);
+}
+
+bool SystemBase::IsInInterrupt()
+{
+	return s_in_irq;
+}
+
+bool SystemBase::IsInPrivMode()
+{
+	return !s_model_priv || s_task_priv || s_in_handler;
+}
+
+void SystemBase::SetPrivMode(bool is_on)
+{
+	s_task_priv = is_on;
+}
+
+void SystemBase::SwitchContext()
+{
+	s_switch_pending = true;
+}
+
+ulong SystemBase::GetCurCpuTick()
+{
+	return s_cycles;
+}
+
+void SystemBase::Crash(ALARM_REASON reason)
+{
+	fprintf(stderr, "kernel crash: alarm %d\n", reason);
+	abort();
+}
+
+StackPtr::CHECK_RES StackPtr::Check(StackPtr marg, size_t len)
+{
+	if (*marg.m_sp != StackPtr::TOP_MARKER)
+		return SP_CORRUPTED;
+	long rest = m_sp - marg.m_sp;
+	if (rest > (long)len)
+		return SP_UNDERFLOW;
+	if (rest < 0)
+		return SP_OVERFLOW;
+	return SP_OK;
+}
+
+void StackPtr::Instrument(StackPtr marg, bool do_full)
+{
+	if (do_full)
+		FillWithMark(marg.m_sp, m_sp);
+	else
+		*marg.m_sp = TOP_MARKER;
+}
+
+size_t StackPtr::GetVirginLen(StackPtr marg) const
+{
+	return GetVirginLen(marg.m_sp, m_sp);
+}
+
+// стек нужен ядру только для учета: кадр не строится, задача не исполняется
+void TaskStack::PreparePlatformSpecific(size_t, void *, void (*)(void), void (*)(void))
+{
+}
+
+void TaskStack::BuildPlatformSpecific(size_t guard, size_t len)
+{
+	if (!m_is_alien_mem) {
+		m_len = (len < MIN_SIZE ? MIN_SIZE : (len <= MAX_SIZE ? len : MAX_SIZE));
+		m_memory = new uint32_t[m_len + guard];
+	} else {
+		m_len = len - guard;
+	}
+
+	m_margin.Set(m_memory + guard);
+	m_top.Set(m_margin.m_sp + m_len);
+}
+
+namespace sim
+{
+// задача потока (sim::ThreadTask), nullptr - основной поток теста
+static __thread Task * s_thread_task = nullptr;
+static void SwitchTurn();
+}
+
+// вызов SVC: метод из той же таблицы, что у обработчика SVC_Handler
+extern "C" void * svcMethods[];
+
+extern "C" Result SvcExecPrivileged(void * vR0, void * vR1, void * vR2, uint32_t vR3)
+{
+	typedef Result (*PrivMethod)(void *, void *, void *);
+	if (vR3 >= (uint32_t)(uintptr_t)svcMethods[0] || !svcMethods[vR3 + 1]) {
+		fprintf(stderr, "SvcExecPrivileged: no method %u\n", vR3);
+		abort();
+	}
+	++s_svc_calls;
+	s_in_handler = true;
+	Result res = reinterpret_cast<PrivMethod>(svcMethods[vR3 + 1])(vR0, vR1, vR2);
+	s_in_handler = false;
+
+	// задача-поток переключается по выходу из SVC, как по PendSV
+	if (sim::s_thread_task)
+		sim::SwitchTurn();
+	return res;
+}
+
+namespace sim
+{
+
+static ALARM_REASON s_alarm = AR_NONE;
+static int s_failed = 0;
+static int s_checked = 0;
+
+class TestApp: public Application
+{
+public:
+	virtual ALARM_ACTION OnAlarm(ALARM_REASON reason)
+	{
+		// нарушенный инвариант ядра - дальше тест не идет
+		if (reason == AR_ASSERT_FAILED) {
+			void * frames[32];
+			fprintf(stderr, "kernel _ASSERT failed\n");
+			backtrace_symbols_fd(frames, backtrace(frames, 32), 2);
+			abort();
+		}
+		s_alarm = reason;
+		return AA_CONTINUE;
+	}
+};
+
+static TestApp s_app;
+
+// задачи-потоки: исполняется только поток текущей задачи, основной поток теста - пока текущая
+// задача не поток; ход передается под s_turn_lock
+static const size_t MAX_THREAD_TASKS = 8;
+static ThreadTask * s_thread_tasks[MAX_THREAD_TASKS];
+static size_t s_thread_count = 0;
+static pthread_mutex_t s_turn_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t s_turn_cond = PTHREAD_COND_INITIALIZER;
+
+ThreadTask::ThreadTask(const char * name) :
+		Task(name)
+{
+	if (s_thread_count == MAX_THREAD_TASKS) {
+		fprintf(stderr, "ThreadTask: too many\n");
+		abort();
+	}
+	s_thread_tasks[s_thread_count++] = this;
+}
+
+static bool IsMyTurn()
+{
+	Task * cur = Sch().GetCurrentTask();
+	if (s_thread_task)
+		return cur == s_thread_task;
+	for (size_t i = 0; i < s_thread_count; ++i)
+		if (cur == s_thread_tasks[i])
+			return false;
+	return true;
+}
+
+static void WaitTurn()
+{
+	while (!IsMyTurn())
+		pthread_cond_wait(&s_turn_cond, &s_turn_lock);
+}
+
+void * ThreadTask::ThreadMain(void * arg)
+{
+	ThreadTask * task = static_cast<ThreadTask *>(arg);
+	s_thread_task = task;
+	pthread_mutex_lock(&s_turn_lock);
+	WaitTurn();
+	pthread_mutex_unlock(&s_turn_lock);
+
+	task->Execute();
+
+	// вышедшая из тела задача больше не просыпается
+	for (;;)
+		Task::Delay(INFINITE_TIMEOUT);
+	return nullptr;
+}
+
+// переключение, поставленное ядром; PendSV - тоже обработчик
+static void SwitchPending()
+{
+	s_in_handler = true;
+	while (s_switch_pending) {
+		s_switch_pending = false;
+		Task * cur = Sch().GetCurrentTask();
+		Sch().SwitchContext(cur ? cur->m_stack.m_top : StackPtr());
+		if (Sch().GetCurrentTask() != cur)
+			++s_switches;
+	}
+	s_in_handler = false;
+}
+
+// переключение и передача хода потоку новой текущей задачи; возврат - когда ход снова у вызвавшего
+static void SwitchTurn()
+{
+	pthread_mutex_lock(&s_turn_lock);
+	SwitchPending();
+	pthread_cond_broadcast(&s_turn_cond);
+	WaitTurn();
+	pthread_mutex_unlock(&s_turn_lock);
+}
+
+void Start()
+{
+	Sch().Initialize();
+	for (size_t i = 0; i < s_thread_count; ++i) {
+		pthread_t thread;
+		pthread_create(&thread, nullptr, ThreadTask::ThreadMain, s_thread_tasks[i]);
+		pthread_detach(thread);
+	}
+	Sch().Start(true);
+	Dispatch();
+}
+
+void Dispatch()
+{
+	if (s_thread_count)
+		SwitchTurn();
+	else
+		SwitchPending();
+}
+
+void ModelPrivilege(bool on)
+{
+	s_model_priv = on;
+}
+
+ulong SvcCalls()
+{
+	return s_svc_calls;
+}
+
+ulong IrqMasks()
+{
+	return s_irq_masks;
+}
+
+ulong ContextSwitches()
+{
+	return s_switches;
+}
+
+void Tick(uint32_t ticks)
+{
+	while (ticks--) {
+		s_cycles += SystemCoreClock / System::GetTickRate();
+		s_in_handler = true;
+		if (SchedulerSysTickHandler())
+			System::SwitchContext();
+		s_in_handler = false;
+		Dispatch();
+	}
+}
+
+void AdvanceCycles(ulong cycles)
+{
+	s_cycles += cycles;
+}
+
+void SetInInterrupt(bool on)
+{
+	s_in_irq = on;
+}
+
+static void (*s_irq_handler)();
+
+static void OnAlarmSignal(int)
+{
+	s_irq_handler();
+}
+
+void StartIrq(void (*handler)(), uint32_t period_us)
+{
+	s_irq_handler = handler;
+	struct sigaction sa = {};
+	sa.sa_handler = OnAlarmSignal;
+	sa.sa_flags = SA_RESTART;
+	sigaction(SIGALRM, &sa, nullptr);
+
+	struct itimerval timer = {};
+	timer.it_interval.tv_usec = period_us;
+	timer.it_value.tv_usec = period_us;
+	setitimer(ITIMER_REAL, &timer, nullptr);
+}
+
+void StopIrq()
+{
+	struct itimerval timer = {};
+	setitimer(ITIMER_REAL, &timer, nullptr);
+	signal(SIGALRM, SIG_IGN);
+}
+
+ALARM_REASON LastAlarm()
+{
+	return s_alarm;
+}
+
+void ClearAlarm()
+{
+	s_alarm = AR_NONE;
+}
+
+bool Check(bool ok, const char * expr, const char * file, int line)
+{
+	++s_checked;
+	if (!ok) {
+		++s_failed;
+		fprintf(stderr, "%s:%d: FAILED: %s\n", file, line, expr);
+	}
+	return ok;
+}
+
+int Result()
+{
+	printf("%d checks, %d failed\n", s_checked, s_failed);
+	return s_failed ? 1 : 0;
+}
+
+}
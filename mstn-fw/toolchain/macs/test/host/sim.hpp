@@ -0,0 +1,77 @@
+/** @copyright AstroSoft Ltd */
+#pragma once
+
+#include <stdio.h>
+#include "scheduler.hpp"
+
+// Пошаговое исполнение ядра в тестах: действия выполняются от имени текущей задачи
+// (Task::GetCurrent()), блокирующий вызов только ставит переключение в очередь,
+// а Dispatch() его выполняет - после этого текущей становится следующая задача.
+namespace sim
+{
+
+// задача, которую ведет тест; Execute() не исполняется
+class TestTask: public Task
+{
+public:
+	explicit TestTask(const char * name) :
+			Task(name)
+	{
+	}
+	UnblockReason Reason() const
+	{
+		return GetUnblockReason();
+	}
+private:
+	virtual void Execute()
+	{
+	}
+};
+
+// задача, тело которой исполняется в собственном потоке ПК, пока она текущая: блокирующий вызов
+// возвращается только после пробуждения. Переключение, поставленное ее вызовом ядра, выполняется
+// по выходу из SVC (задача должна быть непривилегированной, см. ModelPrivilege). Основной поток
+// теста исполняется, пока текущая задача - не поток, и передает ход потокам через Dispatch().
+// Создается до Start(), потоки запускает Start()
+class ThreadTask: public Task
+{
+public:
+	explicit ThreadTask(const char * name);
+
+	static void * ThreadMain(void * arg);
+
+protected:
+	virtual void Execute() = 0;
+};
+
+void Start();
+void Dispatch();
+void Tick(uint32_t ticks = 1);
+void AdvanceCycles(ulong cycles);
+void SetInInterrupt(bool on);
+
+// счетчик переключений задач, выполненных Dispatch()
+ulong ContextSwitches();
+
+// непривилегированные задачи вызывают ядро через SVC, как на целевой платформе;
+// без этого режима все исполняется привилегированно и SVC не бывает
+void ModelPrivilege(bool on);
+// счетчик вызовов SvcExecPrivileged
+ulong SvcCalls();
+// счетчик запретов прерываний (PRIMASK 0 -> 1): входы в критические секции ядра
+ulong IrqMasks();
+
+// прерывание по таймеру ПК (SIGALRM) раз в period_us: вытесняет поток в любой точке вне секции PRIMASK
+void StartIrq(void (*handler)(), uint32_t period_us);
+void StopIrq();
+
+// последняя тревога ядра, AR_NONE - не было
+ALARM_REASON LastAlarm();
+void ClearAlarm();
+
+bool Check(bool ok, const char * expr, const char * file, int line);
+int Result();
+
+}
+
+#define CHECK(e) sim::Check((e), #e, __FILE__, __LINE__)
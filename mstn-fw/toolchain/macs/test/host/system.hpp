@@ -0,0 +1,255 @@
+/** @copyright AstroSoft Ltd */
+#pragma once
+
+// Платформа для сборки ядра на ПК (тесты): вместо target/<mcu>/src/system.hpp и platform.hpp.
+// Ядро и прерывания одни, переключение контекста делает тест вызовом sim::Dispatch(),
+// запрет прерываний общий для всех потоков процесса, как на одноядерном M1 (PRIMASK),
+// и задерживает прерывание-сигнал таймера (sim::StartIrq)
+
+#include <stdint.h>
+#include <stdlib.h>
+#include "common.hpp"
+
+// точки останова отладчика на ПК - аварийное завершение теста
+#undef KERNEL_BKPT
+#define KERNEL_BKPT(num)  abort()
+
+#define MACS_CORTEX_M0		1
+#define MACS_CORTEX_M0_P	5
+#define MACS_CORTEX_M1		10
+#define MACS_CORTEX_M3		30
+#define MACS_CORTEX_M4		40
+
+#define MACS_MCU_CORE  MACS_CORTEX_M1
+
+#include "stack_frame.hpp"
+
+uint32_t __get_PRIMASK();
+void __set_PRIMASK(uint32_t primask);
+void __disable_irq();
+void __enable_irq();
+
+inline void __DMB()
+{
+	__sync_synchronize();
+}
+inline void __DSB()
+{
+	__sync_synchronize();
+}
+inline void __ISB()
+{
+}
+
+class StackPtr
+{
+private:
+	static const uint32_t TOP_MARKER = 0xA52E3FC1;
+public:
+	enum CHECK_RES
+	{
+		SP_OK = 0,
+		SP_OVERFLOW,
+		SP_UNDERFLOW,
+		SP_CORRUPTED
+	};
+	uint32_t * m_sp;
+public:
+	StackPtr(uint32_t * sp = nullptr)
+	{
+		Set(sp);
+	}
+	inline void Set(uint32_t * sp)
+	{
+		m_sp = sp;
+	}
+	inline void Zero()
+	{
+		Set(nullptr);
+	}
+	size_t GetVirginLen(StackPtr marg) const;
+	CHECK_RES Check(StackPtr marg, size_t len);
+	void Instrument(StackPtr marg, bool do_full);
+private:
+	static void FillWithMark(uint32_t * ptr, uint32_t * lim);
+	static size_t GetVirginLen(uint32_t * beg, uint32_t * lim);
+};
+
+class TaskStack
+{
+private:
+	static const size_t WORK_SIZE = 0x10;
+public:
+	static const size_t MIN_SIZE = 0x12 + WORK_SIZE;
+	static const size_t ENOUGH_SIZE = 350;
+private:
+	static const size_t GUARD_SIZE = WORK_SIZE;
+	static const size_t MIN_REST = 2 * WORK_SIZE;
+	static const int GROW_SIZE = MIN_SIZE;
+public:
+	static const size_t MAX_SIZE = MACS_MAX_STACK_SIZE - GUARD_SIZE;
+private:
+	bool m_is_alien_mem;
+	size_t m_len;
+	uint32_t * m_memory;
+	StackPtr m_margin;
+	void PreparePlatformSpecific(size_t len, void * this_ptr, void (*run_func)(void), void (*exit_func)(void));
+public:
+	StackPtr m_top;
+public:
+	TaskStack()
+	{
+		m_is_alien_mem = false;
+		m_len = 0;
+		m_memory = nullptr;
+	}
+	~TaskStack()
+	{
+		Free();
+	}
+	void Build(size_t len, uint32_t * mem = nullptr);
+	void BuildPlatformSpecific(size_t guard, size_t len);
+	void Prepare(size_t len, void * this_ptr, void (*run_func)(void), void (*exit_func)(void));
+	void Free();
+	void Instrument()
+	{
+		m_top.Instrument(m_margin, true);
+	}
+	inline size_t GetLen() const
+	{
+		return m_len;
+	}
+	inline size_t GetUsage() const
+	{
+		return m_len - m_top.GetVirginLen(m_margin);
+	}
+	inline StackPtr GetMargin() const
+	{
+		return m_margin;
+	}
+	bool Check();
+};
+
+class SystemBase
+{
+private:
+	static uint32_t m_tick_rate_hz;
+public:
+	static uint32_t DisableIrq();
+	static void EnableIrq(uint32_t mask);
+
+	static int CurIrqNum()
+	{
+		return 0;
+	}
+	static bool IsInSysCall()
+	{
+		return false;
+	}
+	static bool inline SetUpIrqHandling(int, bool, bool)
+	{
+		return false;
+	}
+
+	static bool IsInInterrupt();
+	static bool IsInPrivMode();
+	static inline bool IsInPrivOrIrq()
+	{
+		return IsInPrivMode() || IsInInterrupt();
+	}
+	static bool IsSysCallAllowed()
+	{
+		return true;
+	}
+	static bool IsInMspMode()
+	{
+		return true;
+	}
+	static inline uint GetStackAlignment()
+	{
+		return 1;
+	}
+
+	static void FirstSwitchToTask(StackPtr, bool is_privileged)
+	{
+		SetPrivMode(is_privileged);
+	}
+	static void SetPrivMode(bool is_on);
+	static void SwitchContext();
+	static void InternalSwitchContext()
+	{
+		SwitchContext();
+	}
+	static bool InitScheduler()
+	{
+		return true;
+	}
+
+	static inline uint32_t GetCpuFreq()
+	{
+		return SystemCoreClock;
+	}
+	static inline uint32_t GetTickRate()
+	{
+		return m_tick_rate_hz;
+	}
+	static bool SetTickRate(uint32_t rate_hz)
+	{
+		m_tick_rate_hz = rate_hz;
+		return true;
+	}
+	static Result SetCpuFreq(uint32_t)
+	{
+		return ResultErrorNotSupported;
+	}
+	static inline Result SetCpuFreq_Priv(uint32_t)
+	{
+		return ResultErrorNotSupported;
+	}
+
+	static void InitCpuTick()
+	{
+	}
+	static ulong GetCurCpuTick();
+	static ulong AskCurCpuTick();
+
+	static inline ulong CpuTicksToNs(ulong cpu_ticks)
+	{
+		return (1000 * cpu_ticks) / (GetCpuFreq() / 1000000);
+	}
+	static inline ulong CpuTicksToUs(ulong cpu_ticks)
+	{
+		return cpu_ticks / (GetCpuFreq() / 1000000);
+	}
+
+	static void Crash(ALARM_REASON reason);
+
+	static void EnterSleepMode()
+	{
+	}
+
+	enum WakeSource
+	{
+		WakeGpio = 1u << 0,
+		WakeUart = 1u << 1,
+		WakeTimer = 1u << 2
+	};
+	static const uint STOP_WAKE_SOURCES = 0;
+	static inline uint32_t EnterStopMode(uint32_t)
+	{
+		return 0;
+	}
+};
+
+class System: public SystemBase
+{
+public:
+	static const uint32_t HEAP_SIZE = 16384;
+
+	static void InitCpu()
+	{
+	}
+	static void HardFaultHandler()
+	{
+	}
+};
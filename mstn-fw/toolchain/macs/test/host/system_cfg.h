@@ -0,0 +1,6 @@
+/** @copyright AstroSoft Ltd */
+#pragma once
+
+#define MACS_USE_MPU             0
+#define MACS_MPU_PROTECT_NULL    0
+#define MACS_MPU_PROTECT_STACK   0
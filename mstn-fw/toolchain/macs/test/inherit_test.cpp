@@ -0,0 +1,335 @@
+/** @copyright AstroSoft Ltd */
+
+// Наследование приоритета по цепочке блокировок: L держит m1, M держит m2 и ждет m1, H (W) ждет m2.
+// Подъем доходит до L через M, а снимается при освобождении, по таймауту и при удалении ожидающей задачи.
+// Замер: цена подъема и снятия по таймауту при глубине цепочки 1..3
+
+#include <chrono>
+#include "mutex.hpp"
+#include "semaphore.hpp"
+#include "sim.hpp"
+
+using sim::TestTask;
+
+static TestTask s_low("L");
+static TestTask s_mid("M");
+static TestTask s_high("H");
+
+static Mutex s_m1;
+static Mutex s_m2;
+
+// L берет m1, M берет m2 и ждет m1; задачи просыпаются через 10 тиков друг за другом
+static void BuildChain()
+{
+	CHECK(Task::GetCurrent() == &s_low);
+	CHECK(s_m1.Lock() == ResultOk);
+	sim::Tick(10);
+
+	CHECK(Task::GetCurrent() == &s_mid);
+	CHECK(s_m2.Lock() == ResultOk);
+	s_m1.Lock();
+	sim::Dispatch();
+	CHECK(Task::GetCurrent() == &s_low);
+	CHECK(s_low.GetPriority() == Task::PriorityNormal);
+}
+
+// L и M доделывают цепочку: L отдает m1, M отдает оба
+static void ReleaseChain()
+{
+	CHECK(Task::GetCurrent() == &s_low);
+	CHECK(s_m1.Unlock() == ResultOk);
+	sim::Dispatch();
+
+	CHECK(Task::GetCurrent() == &s_mid);
+	CHECK(s_mid.Reason() == Task::UnblockReasonRequest);
+	CHECK(s_low.GetPriority() == Task::PriorityLow);
+	CHECK(s_m1.Unlock() == ResultOk);
+	CHECK(s_m2.Unlock() == ResultOk);
+	CHECK(s_mid.GetPriority() == Task::PriorityNormal);
+	CHECK(!s_m1.IsLocked() && !s_m2.IsLocked());
+}
+
+// H поднимает обоих; освобождение m1 снимает подъем с L, освобождение m2 - с M
+static void TestChainUnlock()
+{
+	CHECK(Task::GetCurrent() == &s_high);
+	Task::Delay(20);
+	sim::Dispatch();
+	CHECK(Task::GetCurrent() == &s_mid);
+	Task::Delay(10);
+	sim::Dispatch();
+
+	BuildChain();
+	sim::Tick(10);
+
+	CHECK(Task::GetCurrent() == &s_high);
+	s_m2.Lock();
+	sim::Dispatch();
+	CHECK(Task::GetCurrent() == &s_low);
+	CHECK(s_mid.GetPriority() == Task::PriorityHigh);
+	CHECK(s_low.GetPriority() == Task::PriorityHigh);
+
+	// m1 переходит к M, L опускается, M держит m2 и остается поднят
+	CHECK(s_m1.Unlock() == ResultOk);
+	sim::Dispatch();
+	CHECK(Task::GetCurrent() == &s_mid);
+	CHECK(s_low.GetPriority() == Task::PriorityLow);
+	CHECK(s_mid.GetPriority() == Task::PriorityHigh);
+
+	CHECK(s_m1.Unlock() == ResultOk);
+	CHECK(s_mid.GetPriority() == Task::PriorityHigh);
+	CHECK(s_m2.Unlock() == ResultOk);
+	sim::Dispatch();
+	CHECK(Task::GetCurrent() == &s_high);
+	CHECK(s_high.Reason() == Task::UnblockReasonRequest);
+	CHECK(s_mid.GetPriority() == Task::PriorityNormal);
+	CHECK(s_m2.Unlock() == ResultOk);
+}
+
+// таймаут H снимает подъем по всей цепочке, хотя m1 и m2 еще заняты
+static void TestChainTimeout()
+{
+	CHECK(Task::GetCurrent() == &s_high);
+	Task::Delay(20);
+	sim::Dispatch();
+	CHECK(Task::GetCurrent() == &s_mid);
+	Task::Delay(10);
+	sim::Dispatch();
+
+	BuildChain();
+	sim::Tick(10);
+
+	CHECK(Task::GetCurrent() == &s_high);
+	s_m2.Lock(5);
+	sim::Dispatch();
+	CHECK(Task::GetCurrent() == &s_low);
+	CHECK(s_low.GetPriority() == Task::PriorityHigh);
+
+	sim::Tick(5);
+	CHECK(Task::GetCurrent() == &s_high);
+	CHECK(s_high.Reason() == Task::UnblockReasonTimeout);
+	CHECK(s_mid.GetPriority() == Task::PriorityNormal);
+	CHECK(s_low.GetPriority() == Task::PriorityNormal);
+	CHECK(s_m1.IsLocked() && s_m2.IsLocked());
+
+	Task::Delay(10);
+	sim::Dispatch();
+	ReleaseChain();
+	sim::Tick(10);
+}
+
+// удаление ожидающей W снимает подъем по всей цепочке
+static void TestChainDelete()
+{
+	CHECK(Task::GetCurrent() == &s_high);
+	TestTask * w = new TestTask("W");
+	CHECK(Task::Add(w, Task::PriorityAboveNormal) == ResultOk);
+	Task::Delay(30);
+	sim::Dispatch();
+	CHECK(Task::GetCurrent() == w);
+	Task::Delay(20);
+	sim::Dispatch();
+	CHECK(Task::GetCurrent() == &s_mid);
+	Task::Delay(10);
+	sim::Dispatch();
+
+	BuildChain();
+	sim::Tick(10);
+
+	CHECK(Task::GetCurrent() == w);
+	s_m2.Lock();
+	sim::Dispatch();
+	CHECK(Task::GetCurrent() == &s_low);
+	CHECK(s_mid.GetPriority() == Task::PriorityAboveNormal);
+	CHECK(s_low.GetPriority() == Task::PriorityAboveNormal);
+	sim::Tick(10);
+
+	CHECK(Task::GetCurrent() == &s_high);
+	CHECK(w->Delete() == ResultOk);
+	CHECK(s_mid.GetPriority() == Task::PriorityNormal);
+	CHECK(s_low.GetPriority() == Task::PriorityNormal);
+
+	Task::Delay(10);
+	sim::Dispatch();
+	ReleaseChain();
+}
+
+// Цепочка глубины d: C0 держит свой мьютекс, Ci держит свой и ждет мьютекс C(i-1), верхняя Cd ждет
+// мьютекс C(d-1) с таймаутом. Задачи ждут команды на семафоре go, ведет их L
+static const uint MAX_DEPTH = 3;
+static const uint ROUNDS = 200;
+
+struct ChainLink
+{
+	TestTask * m_task;
+	Task::Priority m_priority;
+	BinarySemaphore m_go;
+	Mutex m_mutex;
+	bool m_holding;  // C0: держит свой мьютекс
+	bool m_waiting;  // ждет мьютекс нижней
+	bool m_top;      // верхняя: ждет с таймаутом
+};
+
+static ChainLink s_chain[MAX_DEPTH + 1];
+static uint s_depth;
+
+struct ChainCost
+{
+	uint32_t m_boosts;
+	uint32_t m_deboosts;
+	std::chrono::nanoseconds m_boost_time;
+	std::chrono::nanoseconds m_deboost_time;
+};
+
+static ChainCost s_cost;
+
+// задачи цепочки, чей приоритет поменялся: по одному IntSetTaskPriority_Priv на каждую
+static uint32_t Changed(const Task::Priority * before, uint count)
+{
+	uint32_t changed = 0;
+	for (uint i = 0; i < count; ++i)
+		changed += s_chain[i].m_task->GetPriority() != before[i];
+	return changed;
+}
+
+static void Snapshot(Task::Priority * prio, uint count)
+{
+	for (uint i = 0; i < count; ++i)
+		prio[i] = s_chain[i].m_task->GetPriority();
+}
+
+// очередной шаг текущей задачи цепочки
+static void ChainStep(ChainLink & link, uint i)
+{
+	if (link.m_top) {
+		CHECK(link.m_task->Reason() == Task::UnblockReasonTimeout);
+		link.m_top = false;
+	} else if (link.m_waiting) {
+		// мьютекс нижней получен: отпустить оба
+		link.m_waiting = false;
+		CHECK(s_chain[i - 1].m_mutex.Unlock() == ResultOk);
+		CHECK(link.m_mutex.Unlock() == ResultOk);
+	} else if (link.m_holding) {
+		link.m_holding = false;
+		CHECK(link.m_mutex.Unlock() == ResultOk);
+	} else if (i == s_depth) {
+		Task::Priority before[MAX_DEPTH];
+		Snapshot(before, i);
+		std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+		s_chain[i - 1].m_mutex.Lock(5);
+		s_cost.m_boost_time += std::chrono::steady_clock::now() - t0;
+		s_cost.m_boosts += Changed(before, i);
+		link.m_top = true;
+		return;
+	} else {
+		CHECK(link.m_mutex.Lock() == ResultOk);
+		if (i == 0) {
+			link.m_holding = true;
+		} else {
+			link.m_waiting = true;
+			s_chain[i - 1].m_mutex.Lock();
+			return;
+		}
+	}
+	link.m_go.Wait();
+}
+
+// задачи цепочки работают, пока текущей не станет L
+static void RunChain()
+{
+	while (Task::GetCurrent() != &s_low) {
+		uint i = 0;
+		while (i <= MAX_DEPTH && s_chain[i].m_task != Task::GetCurrent())
+			++i;
+		if (!CHECK(i <= MAX_DEPTH))
+			return;
+		ChainStep(s_chain[i], i);
+		sim::Dispatch();
+	}
+}
+
+static void ChainRound()
+{
+	for (uint i = 0; i <= s_depth; ++i) {
+		s_chain[i].m_go.Signal();
+		sim::Dispatch();
+		RunChain();
+	}
+
+	// таймаут верхней снимает подъем по всей цепочке одним тиком
+	for (uint t = 0; t < 10 && Task::GetCurrent() == &s_low; ++t) {
+		Task::Priority before[MAX_DEPTH];
+		Snapshot(before, s_depth);
+		std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+		sim::Tick();
+		std::chrono::nanoseconds spent = std::chrono::steady_clock::now() - t0;
+		uint32_t changed = Changed(before, s_depth);
+		if (changed) {
+			s_cost.m_deboosts += changed;
+			s_cost.m_deboost_time += spent;
+		}
+	}
+	RunChain();
+
+	s_chain[0].m_go.Signal();
+	sim::Dispatch();
+	RunChain();
+	for (uint i = 0; i <= s_depth; ++i)
+		CHECK(s_chain[i].m_task->GetPriority() == s_chain[i].m_priority && !s_chain[i].m_mutex.IsLocked());
+}
+
+static void MeasureChainCost()
+{
+	static const Task::Priority prio[MAX_DEPTH + 1] = {
+		Task::PriorityBelowNormal, Task::PriorityNormal, Task::PriorityAboveNormal, Task::PriorityHigh};
+
+	// L ведет цепочку, M и H спят до конца теста
+	for (uint parked = 0; parked < 2 || Task::GetCurrent() != &s_low;) {
+		if (Task::GetCurrent() == &s_mid || Task::GetCurrent() == &s_high) {
+			Task::Delay(INFINITE_TIMEOUT);
+			sim::Dispatch();
+			++parked;
+		} else {
+			sim::Tick();
+		}
+	}
+	for (uint i = 0; i <= MAX_DEPTH; ++i) {
+		s_chain[i].m_task = new TestTask("C");
+		s_chain[i].m_priority = prio[i];
+		Task::Add(s_chain[i].m_task, prio[i]);
+		sim::Dispatch();
+		CHECK(Task::GetCurrent() == s_chain[i].m_task);
+		s_chain[i].m_go.Wait();
+		sim::Dispatch();
+		CHECK(Task::GetCurrent() == &s_low);
+	}
+
+	printf("%6s %12s %12s %14s %14s\n", "depth", "boost calls", "boost ns", "deboost calls", "deboost ns");
+	for (s_depth = 1; s_depth <= MAX_DEPTH; ++s_depth) {
+		s_cost = ChainCost();
+		for (uint r = 0; r < ROUNDS; ++r)
+			ChainRound();
+		printf("%6u %12.1f %12.1f %14.1f %14.1f\n", s_depth,
+				(double)s_cost.m_boosts / ROUNDS, (double)s_cost.m_boost_time.count() / ROUNDS,
+				(double)s_cost.m_deboosts / ROUNDS, (double)s_cost.m_deboost_time.count() / ROUNDS);
+
+		// подъем и снятие проходят всю цепочку: по вызову на задачу
+		CHECK(s_cost.m_boosts == s_depth * ROUNDS);
+		CHECK(s_cost.m_deboosts == s_depth * ROUNDS);
+	}
+}
+
+int main()
+{
+	Task::Add(&s_low, Task::PriorityLow);
+	Task::Add(&s_mid, Task::PriorityNormal);
+	Task::Add(&s_high, Task::PriorityHigh);
+	sim::Start();
+
+	TestChainUnlock();
+	TestChainTimeout();
+	TestChainDelete();
+	MeasureChainCost();
+
+	return sim::Result();
+}
@@ -0,0 +1,147 @@
+/** @copyright AstroSoft Ltd */
+
+// Замер сигнала из прерывания задаче: Task::Notify против BinarySemaphore::Signal.
+// Задача-поток ждет сигнала, тест в роли обработчика прерывания (sim::SetInInterrupt) подает его
+// и по выходу из прерывания переключает на задачу. На сигнал считаются запреты прерываний (входы
+// в критические секции) в обработчике и всего за круг вместе с повторным ожиданием задачи,
+// вызовы SVC, переключения и время вызова в обработчике.
+
+#include <chrono>
+#include "semaphore.hpp"
+#include "sim.hpp"
+
+using sim::TestTask;
+using sim::ThreadTask;
+
+static const uint32_t SIGNALS = 1000;
+
+struct Counts
+{
+	double m_isr_masks;
+	double m_masks;
+	double m_svc;
+	double m_switches;
+	double m_isr_ns;
+};
+
+class NotifyWaiter: public ThreadTask
+{
+public:
+	NotifyWaiter() :
+			ThreadTask("NotifyWaiter"),
+			m_count(0)
+	{
+	}
+	uint32_t m_count;
+private:
+	virtual void Execute()
+	{
+		for (;;) {
+			uint32_t value = 0;
+			Task::WaitNotify(~0u, INFINITE_TIMEOUT, &value);
+			CHECK(value == 1);
+			++m_count;
+		}
+	}
+};
+
+class SemaphoreWaiter: public ThreadTask
+{
+public:
+	SemaphoreWaiter() :
+			ThreadTask("SemWaiter"),
+			m_count(0)
+	{
+	}
+	BinarySemaphore m_sem;
+	uint32_t m_count;
+private:
+	virtual void Execute()
+	{
+		for (;;) {
+			m_sem.Wait();
+			++m_count;
+		}
+	}
+};
+
+static TestTask s_driver("Driver");
+static NotifyWaiter s_notified;
+static SemaphoreWaiter s_signalled;
+
+// signal() подает сигнал из обработчика, count - счетчик пробуждений ждущей задачи
+template <typename F>
+static Counts Measure(F signal, const uint32_t & count)
+{
+	using namespace std::chrono;
+
+	uint32_t start_count = count;
+	ulong masks = sim::IrqMasks();
+	ulong svc = sim::SvcCalls();
+	ulong switches = sim::ContextSwitches();
+	ulong isr_masks = 0;
+	nanoseconds isr_time(0);
+
+	for (uint32_t i = 0; i < SIGNALS; ++i) {
+		sim::SetInInterrupt(true);
+		ulong before = sim::IrqMasks();
+		steady_clock::time_point t0 = steady_clock::now();
+		CHECK(signal() == ResultOk);
+		isr_time += steady_clock::now() - t0;
+		isr_masks += sim::IrqMasks() - before;
+		sim::SetInInterrupt(false);
+		sim::Dispatch();
+		CHECK(Task::GetCurrent() == &s_driver);
+	}
+	CHECK(count - start_count == SIGNALS);
+
+	Counts res;
+	res.m_isr_masks = (double)isr_masks / SIGNALS;
+	res.m_masks = (double)(sim::IrqMasks() - masks) / SIGNALS;
+	res.m_svc = (double)(sim::SvcCalls() - svc) / SIGNALS;
+	res.m_switches = (double)(sim::ContextSwitches() - switches) / SIGNALS;
+	res.m_isr_ns = (double)isr_time.count() / SIGNALS;
+	return res;
+}
+
+static Result NotifyFromIsr()
+{
+	return Task::Notify(&s_notified, 1);
+}
+
+static Result SignalFromIsr()
+{
+	return s_signalled.m_sem.Signal();
+}
+
+static void Print(const char * name, const Counts & c)
+{
+	printf("%-16s %10.2f %10.2f %10.2f %10.2f %10.1f\n", name, c.m_isr_masks, c.m_masks, c.m_svc, c.m_switches, c.m_isr_ns);
+}
+
+int main()
+{
+	sim::ModelPrivilege(true);
+	Task::Add(&s_driver, Task::PriorityLow);
+	Task::Add(&s_notified, Task::PriorityHigh);
+	Task::Add(&s_signalled, Task::PriorityHigh);
+	sim::Start();
+	CHECK(Task::GetCurrent() == &s_driver);
+
+	// первый проход прогревает кэши и ядро, в счет идет второй
+	Measure(NotifyFromIsr, s_notified.m_count);
+	Measure(SignalFromIsr, s_signalled.m_count);
+	Counts notify = Measure(NotifyFromIsr, s_notified.m_count);
+	Counts sem = Measure(SignalFromIsr, s_signalled.m_count);
+
+	printf("%-16s %10s %10s %10s %10s %10s\n", "", "isr masks", "masks", "svc", "switches", "isr ns");
+	Print("Task::Notify", notify);
+	Print("Semaphore", sem);
+
+	// уведомление не дороже семафора ни в обработчике, ни за круг
+	CHECK(notify.m_isr_masks <= sem.m_isr_masks);
+	CHECK(notify.m_masks <= sem.m_masks);
+	CHECK(notify.m_switches == sem.m_switches);
+
+	return sim::Result();
+}
@@ -0,0 +1,188 @@
+/** @copyright AstroSoft Ltd */
+
+// Замер RwLock против одного Mutex на той же нагрузке: писатель и N читателей одного приоритета
+// в цикле захват - удержание - отпускание - пауза. За RUN_TICKS считаются переключения задач,
+// тики, проведенные задачами в ожидании захвата, и число завершенных чтений и записей.
+
+#include "mutex.hpp"
+#include "rw_lock.hpp"
+#include "sim.hpp"
+
+using sim::TestTask;
+
+static const uint32_t RUN_TICKS = 5000;
+static const uint32_t READ_HOLD_MS = 4;
+static const uint32_t READ_PAUSE_MS = 2;
+static const uint32_t WRITE_HOLD_MS = 2;
+static const uint32_t WRITE_PAUSE_MS = 25;
+static const size_t MAX_READERS = MACS_RWLOCK_MAX_READERS;
+
+struct Stats
+{
+	ulong m_switches;
+	uint32_t m_blocked;
+	uint32_t m_reads;
+	uint32_t m_writes;
+};
+
+// захват для читателей и писателя: RwLock или один Mutex на всех
+class Lock
+{
+public:
+	explicit Lock(bool rw) :
+			m_rw(rw)
+	{
+	}
+	void Acquire(bool write)
+	{
+		if (!m_rw)
+			m_mutex.Lock();
+		else if (write)
+			m_rwlock.LockWrite();
+		else
+			m_rwlock.LockRead();
+	}
+	void Release(bool write)
+	{
+		if (!m_rw)
+			m_mutex.Unlock();
+		else if (write)
+			m_rwlock.UnlockWrite();
+		else
+			m_rwlock.UnlockRead();
+	}
+	// писатель исключает всех, читатели - только писателя
+	bool Exclusive(bool write) const
+	{
+		if (!m_rw)
+			return true;
+		return write ? m_rwlock.GetReaders() == 0 : !m_rwlock.IsWriteLocked();
+	}
+private:
+	bool m_rw;
+	Mutex m_mutex;
+	RwLock m_rwlock;
+};
+
+class Worker: public TestTask
+{
+public:
+	enum State
+	{
+		StateIdle,
+		StateLocking,   // захват запрошен; задача снова текущая - захват получен
+		StateHolding,
+		StateParked
+	};
+
+	explicit Worker(bool writer) :
+			TestTask(writer ? "Writer" : "Reader"),
+			m_writer(writer),
+			m_state(StateIdle),
+			m_waiting(false)
+	{
+	}
+
+	bool m_writer;
+	State m_state;
+	bool m_waiting;
+};
+
+static TestTask s_driver("Driver");
+
+// очередной шаг текущей задачи; переключение выполнит вызывающий
+static void Step(Worker & w, Lock & lock, bool stop, Stats & st)
+{
+	switch (w.m_state) {
+	case Worker::StateIdle:
+		if (stop) {
+			w.m_state = Worker::StateParked;
+			Task::Delay(INFINITE_TIMEOUT);
+			break;
+		}
+		w.m_state = Worker::StateLocking;
+		lock.Acquire(w.m_writer);
+		break;
+	case Worker::StateLocking:
+		w.m_waiting = false;
+		CHECK(lock.Exclusive(w.m_writer));
+		w.m_state = Worker::StateHolding;
+		Task::Delay(w.m_writer ? WRITE_HOLD_MS : READ_HOLD_MS);
+		break;
+	case Worker::StateHolding:
+		lock.Release(w.m_writer);
+		if (!stop)
+			++(w.m_writer ? st.m_writes : st.m_reads);
+		w.m_state = Worker::StateIdle;
+		Task::Delay(w.m_writer ? WRITE_PAUSE_MS : READ_PAUSE_MS);
+		break;
+	case Worker::StateParked:
+		CHECK(false);
+		break;
+	}
+}
+
+static Stats Run(size_t readers, bool rw)
+{
+	Lock lock(rw);
+	Worker * workers[1 + MAX_READERS];
+	size_t count = 1 + readers;
+	for (size_t i = 0; i < count; ++i) {
+		workers[i] = new Worker(i == 0);
+		Task::Add(workers[i], Task::PriorityNormal);
+	}
+
+	Stats st = {};
+	ulong switches = sim::ContextSwitches();
+	uint32_t ticks = 0;
+	size_t parked = 0;
+	sim::Dispatch();
+
+	// задачи работают, пока не запаркуются все; счет - только за RUN_TICKS
+	while (parked < count) {
+		Task * cur = Task::GetCurrent();
+		if (cur == &s_driver) {
+			for (size_t i = 0; ticks < RUN_TICKS && i < count; ++i)
+				st.m_blocked += workers[i]->m_waiting;
+			if (++ticks == RUN_TICKS)
+				st.m_switches = sim::ContextSwitches() - switches;
+			sim::Tick();
+			continue;
+		}
+
+		Worker & w = *static_cast<Worker *>(cur);
+		Step(w, lock, ticks >= RUN_TICKS, st);
+		sim::Dispatch();
+		if (w.m_state == Worker::StateParked)
+			++parked;
+		else if (w.m_state == Worker::StateLocking && Task::GetCurrent() != &w)
+			w.m_waiting = true;
+	}
+
+	for (size_t i = 0; i < count; ++i)
+		CHECK(workers[i]->Delete() == ResultOk);
+	return st;
+}
+
+int main()
+{
+	Task::Add(&s_driver, Task::PriorityLow);
+	sim::Start();
+
+	printf("%4s %8s %10s %10s %8s %8s\n", "N", "lock", "switches", "blocked", "reads", "writes");
+	for (size_t readers = 1; readers <= MAX_READERS; ++readers) {
+		Stats mutex = Run(readers, false);
+		Stats rw = Run(readers, true);
+		printf("%4u %8s %10lu %10u %8u %8u\n", (unsigned)readers, "Mutex", mutex.m_switches, mutex.m_blocked, mutex.m_reads, mutex.m_writes);
+		printf("%4u %8s %10lu %10u %8u %8u\n", (unsigned)readers, "RwLock", rw.m_switches, rw.m_blocked, rw.m_reads, rw.m_writes);
+
+		// писатель не голодает; с двух читателей RwLock пропускает больше чтений при меньшем ожидании
+		CHECK(rw.m_writes > 0);
+		if (readers >= 2) {
+			CHECK(rw.m_reads > mutex.m_reads);
+			CHECK(rw.m_blocked < mutex.m_blocked);
+		}
+	}
+
+	return sim::Result();
+}
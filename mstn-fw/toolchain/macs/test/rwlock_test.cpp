@@ -0,0 +1,149 @@
+/** @copyright AstroSoft Ltd */
+
+// RwLock: учет читателей по задачам, чужой UnlockRead, удаление читателя, переполнение таблицы читателей
+// (собирается с MACS_RWLOCK_MAX_READERS=2)
+
+#include "rw_lock.hpp"
+#include "sim.hpp"
+
+using sim::TestTask;
+
+// A удаляется тестом вместе с памятью
+static TestTask * s_a;
+static TestTask s_b("B");
+static TestTask s_c("C");
+static TestTask s_d("D");
+
+static RwLock s_lock;
+
+// A: повторный захват на чтение считается, лишний UnlockRead отвергается
+static void TestReadCount()
+{
+	CHECK(Task::GetCurrent() == s_a);
+	CHECK(s_lock.UnlockRead() == ResultErrorInvalidState);
+
+	CHECK(s_lock.LockRead() == ResultOk);
+	CHECK(s_lock.LockRead() == ResultOk);
+	CHECK(s_lock.GetReaders() == 1);
+	CHECK(s_lock.UnlockRead() == ResultOk);
+	CHECK(s_lock.GetReaders() == 1);
+	CHECK(s_lock.UnlockRead() == ResultOk);
+	CHECK(s_lock.GetReaders() == 0);
+	CHECK(s_lock.UnlockRead() == ResultErrorInvalidState);
+}
+
+// A: читатель не может захватить на запись - ждал бы сам себя
+static void TestReaderUpgrade()
+{
+	CHECK(s_lock.LockRead() == ResultOk);
+	CHECK(s_lock.LockWrite() == ResultErrorInvalidState);
+	CHECK(sim::LastAlarm() == AR_NESTED_MUTEX_LOCK);
+	sim::ClearAlarm();
+	CHECK(!s_lock.IsWriteLocked());
+	CHECK(s_lock.UnlockRead() == ResultOk);
+}
+
+// A читает и засыпает; B не может снять чужой захват и ждет записи; C удаляет A - B получает запись
+static void TestDeleteReader()
+{
+	CHECK(s_lock.LockRead() == ResultOk);
+	Task::Delay(10);
+	sim::Dispatch();
+
+	CHECK(Task::GetCurrent() == &s_b);
+	CHECK(s_lock.UnlockRead() == ResultErrorInvalidState);
+	CHECK(s_lock.GetReaders() == 1);
+	s_lock.LockWrite();
+	sim::Dispatch();
+
+	CHECK(Task::GetCurrent() == &s_c);
+	CHECK(s_a->Delete() == ResultOk);
+	CHECK(s_lock.GetReaders() == 0);
+	sim::Dispatch();
+
+	CHECK(Task::GetCurrent() == &s_b);
+	CHECK(s_b.Reason() == Task::UnblockReasonRequest);
+	CHECK(s_lock.IsWriteLocked());
+	CHECK(s_lock.UnlockWrite() == ResultOk);
+}
+
+// B и C заняли обе строки таблицы, D ждет, пока одна не освободится
+static void TestReaderTableFull()
+{
+	CHECK(s_lock.LockRead() == ResultOk);
+	Task::Delay(10);
+	sim::Dispatch();
+
+	CHECK(Task::GetCurrent() == &s_c);
+	CHECK(s_lock.LockRead() == ResultOk);
+	Task::Delay(10);
+	sim::Dispatch();
+
+	CHECK(Task::GetCurrent() == &s_d);
+	s_lock.LockRead();
+	sim::Dispatch();
+	CHECK(Task::GetCurrent() != &s_d);
+	CHECK(s_lock.GetReaders() == 2);
+
+	sim::Tick(20);
+	CHECK(Task::GetCurrent() == &s_b);
+	CHECK(s_lock.UnlockRead() == ResultOk);
+	CHECK(s_lock.GetReaders() == 2);
+	CHECK(s_d.Reason() == Task::UnblockReasonRequest);
+	Task::Delay(100);
+	sim::Dispatch();
+
+	CHECK(Task::GetCurrent() == &s_c);
+	CHECK(s_lock.UnlockRead() == ResultOk);
+	Task::Delay(100);
+	sim::Dispatch();
+
+	CHECK(Task::GetCurrent() == &s_d);
+	CHECK(s_lock.UnlockRead() == ResultOk);
+	CHECK(s_lock.GetReaders() == 0);
+}
+
+// D читает, B ждет записи: повторный захват D на чтение не ждет писателя
+static void TestRelockWithWriterWaiting()
+{
+	CHECK(s_lock.LockRead() == ResultOk);
+	sim::Tick(100);
+
+	CHECK(Task::GetCurrent() == &s_b);
+	s_lock.LockWrite();
+	sim::Dispatch();
+	CHECK(Task::GetCurrent() == &s_c);
+	Task::Delay(1000);
+	sim::Dispatch();
+
+	CHECK(Task::GetCurrent() == &s_d);
+	CHECK(s_lock.LockRead() == ResultOk);
+	sim::Dispatch();
+	CHECK(Task::GetCurrent() == &s_d);
+	CHECK(s_lock.UnlockRead() == ResultOk);
+	CHECK(!s_lock.IsWriteLocked());
+	CHECK(s_lock.UnlockRead() == ResultOk);
+	sim::Dispatch();
+
+	CHECK(Task::GetCurrent() == &s_b);
+	CHECK(s_lock.IsWriteLocked());
+	CHECK(s_lock.UnlockWrite() == ResultOk);
+}
+
+int main()
+{
+	s_a = new TestTask("A");
+	Task::Add(s_a, Task::PriorityHigh);
+	Task::Add(&s_b, Task::PriorityAboveNormal);
+	Task::Add(&s_c, Task::PriorityNormal);
+	Task::Add(&s_d, Task::PriorityLow);
+	sim::Start();
+
+	TestReadCount();
+	TestReaderUpgrade();
+	TestDeleteReader();
+	TestReaderTableFull();
+	TestRelockWithWriterWaiting();
+
+	return sim::Result();
+}
@@ -0,0 +1,95 @@
+/** @copyright AstroSoft Ltd */
+
+// Цена операций без конкуренции: вызовы SVC и запреты прерываний на пару Lock+Unlock мьютекса
+// и Signal+Wait семафора из непривилегированной и привилегированной задачи.
+// Собирается дважды: с быстрым путем (sync_cost_bench) и без него (sync_cost_bench_slow,
+// MACS_SYNC_FAST_PATH=0). Ядро на ПК собрано как для M1, и атомарная операция быстрого пути здесь
+// тоже запрещает прерывания - на M3 это LDREX/STREX без запрета. На цели те же операции замеряет
+// Diagnostics::MeasureSync (ProfEye).
+
+#include "mutex.hpp"
+#include "semaphore.hpp"
+#include "sim.hpp"
+
+using sim::TestTask;
+
+static const uint32_t PAIRS = 1000;
+
+struct Cost
+{
+	double m_svc;
+	double m_masks;
+};
+
+static Mutex s_mutex;
+static BinarySemaphore s_sem;
+
+static void MutexPair()
+{
+	CHECK(s_mutex.Lock() == ResultOk);
+	CHECK(s_mutex.Unlock() == ResultOk);
+}
+
+static void SemaphorePair()
+{
+	CHECK(s_sem.Signal() == ResultOk);
+	CHECK(s_sem.Wait() == ResultOk);
+}
+
+static Cost Measure(void (*pair)())
+{
+	ulong svc = sim::SvcCalls();
+	ulong masks = sim::IrqMasks();
+	for (uint32_t i = 0; i < PAIRS; ++i)
+		pair();
+
+	Cost cost;
+	cost.m_svc = (double)(sim::SvcCalls() - svc) / PAIRS;
+	cost.m_masks = (double)(sim::IrqMasks() - masks) / PAIRS;
+	return cost;
+}
+
+static void Print(const char * name, const Cost & cost)
+{
+	printf("%-24s %8.2f %8.2f\n", name, cost.m_svc, cost.m_masks);
+}
+
+static TestTask s_user("User");
+static TestTask s_priv("Priv");
+
+int main()
+{
+	sim::ModelPrivilege(true);
+	Task::Add(&s_user, Task::PriorityNormal);
+	Task::Add(&s_priv, Task::PriorityHigh, Task::ModePrivileged);
+	sim::Start();
+
+	CHECK(Task::GetCurrent() == &s_priv);
+	Cost priv_mutex = Measure(MutexPair);
+	Cost priv_sem = Measure(SemaphorePair);
+	Task::Delay(10);
+	sim::Dispatch();
+
+	CHECK(Task::GetCurrent() == &s_user);
+	Cost user_mutex = Measure(MutexPair);
+	Cost user_sem = Measure(SemaphorePair);
+
+	printf("MACS_SYNC_FAST_PATH=%d %10s %8s\n", MACS_SYNC_FAST_PATH, "svc", "masks");
+	Print("Lock+Unlock, user", user_mutex);
+	Print("Signal+Wait, user", user_sem);
+	Print("Lock+Unlock, privileged", priv_mutex);
+	Print("Signal+Wait, privileged", priv_sem);
+
+	// привилегированная задача входит в ядро без SVC; на операцию одна критическая секция ядра
+	// или одна атомарная операция быстрого пути
+	CHECK(priv_mutex.m_svc == 0 && priv_sem.m_svc == 0);
+	CHECK(user_mutex.m_masks == 2 && user_sem.m_masks == 2);
+	CHECK(priv_mutex.m_masks == 2 && priv_sem.m_masks == 2);
+#if MACS_SYNC_FAST_PATH
+	CHECK(user_mutex.m_svc == 0 && user_sem.m_svc == 0);
+#else
+	CHECK(user_mutex.m_svc == 2 && user_sem.m_svc == 2);
+#endif
+
+	return sim::Result();
+}
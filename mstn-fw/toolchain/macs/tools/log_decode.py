@@ -0,0 +1,121 @@
+#!/usr/bin/env python3
+#coding: utf-8
+
+""" Декодер двоичного журнала MACS (MACS_LOG_BINARY = 1).
+
+Строки формата и аргументы %s восстанавливаются по адресам из ELF-файла прошивки.
+Использование: log_decode.py firmware.elf [log.bin | /dev/ttyUSB0 [baudrate]]
+"""
+
+import re, struct, sys
+
+FRAME_SYNC = 0xA5
+LEVELS = {1: 'E', 2: 'W', 3: 'I', 4: 'D'}
+
+SHF_ALLOC = 0x2
+SHT_NOBITS = 8
+
+SPEC = re.compile(r'%([-+ #0]*\d*(?:\.\d+)?)(hh|h|ll|l|z|t|j)?([diuxXcsp%])')
+
+
+class Elf:
+    def __init__(self, path):
+        with open(path, 'rb') as f:
+            self.data = f.read()
+        if self.data[:4] != b'\x7fELF' or self.data[4] != 1:
+            raise ValueError("{0}: not an ELF32 file".format(path))
+        shoff, = struct.unpack_from('<I', self.data, 0x20)
+        shentsize, shnum = struct.unpack_from('<HH', self.data, 0x2E)
+        self.sections = []
+        for i in range(shnum):
+            (name, stype, flags, addr, offset, size) = struct.unpack_from('<IIIIII', self.data, shoff + i * shentsize)
+            if flags & SHF_ALLOC and stype != SHT_NOBITS and size:
+                self.sections.append((addr, offset, size))
+
+    def string(self, addr):
+        for (base, offset, size) in self.sections:
+            if base <= addr < base + size:
+                start = offset + addr - base
+                end = self.data.find(b'\0', start, offset + size)
+                if end < 0:
+                    end = offset + size
+                return self.data[start:end].decode('utf-8', 'replace')
+        return None
+
+
+def format_record(elf, fmt_addr, args):
+    if fmt_addr == 0:
+        return "{0} log records dropped".format(args[0] if args else '?')
+
+    fmt = elf.string(fmt_addr)
+    if fmt is None:
+        return "<unknown format 0x{0:08x}> {1}".format(fmt_addr, ' '.join(hex(a) for a in args))
+
+    args = list(args)
+
+    def subst(m):
+        flags, conv = m.group(1), m.group(3)
+        if conv == '%':
+            return '%'
+        val = args.pop(0) if args else 0
+        if conv in 'di':
+            val = val - (1 << 32) if val & 0x80000000 else val
+            return ('%' + flags + 'd') % val
+        if conv == 'u':
+            return ('%' + flags + 'd') % val
+        if conv in 'xX':
+            return ('%' + flags + conv) % val
+        if conv == 'c':
+            return chr(val & 0xFF)
+        if conv == 'p':
+            return '0x%08x' % val
+        s = elf.string(val)
+        return ('%' + flags + 's') % (s if s is not None else '<0x%08x>' % val)
+
+    return SPEC.sub(subst, fmt)
+
+
+def decode(elf, stream):
+    buf = b''
+    while True:
+        chunk = stream.read(1)
+        if not chunk:
+            break
+        buf += chunk
+        while buf:
+            if buf[0] != FRAME_SYNC:
+                buf = buf[1:]
+                continue
+            if len(buf) < 2:
+                break
+            level, argc = buf[1] & 0x0F, buf[1] >> 4
+            need = 2 + 8 + 4 * argc
+            if argc > 4:
+                buf = buf[1:]
+                continue
+            if len(buf) < need:
+                break
+            stamp, fmt_addr = struct.unpack_from('<II', buf, 2)
+            args = struct.unpack_from('<' + 'I' * argc, buf, 10)
+            print("{0:8d} {1} {2}".format(stamp, LEVELS.get(level, '?'), format_record(elf, fmt_addr, args)))
+            sys.stdout.flush()
+            buf = buf[need:]
+
+
+if __name__ == "__main__":
+    if len(sys.argv) < 2:
+        print(__doc__)
+        sys.exit(1)
+
+    elf = Elf(sys.argv[1])
+    source = sys.argv[2] if len(sys.argv) > 2 else None
+
+    if source is None:
+        decode(elf, sys.stdin.buffer)
+    elif source.startswith('/dev/'):
+        import serial
+        baudrate = int(sys.argv[3]) if len(sys.argv) > 3 else 115200
+        decode(elf, serial.Serial(source, baudrate))
+    else:
+        with open(source, 'rb') as f:
+            decode(elf, f)
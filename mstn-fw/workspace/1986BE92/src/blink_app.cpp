@@ -1,35 +1,96 @@
 #include "blink_app.hpp"
 #include "task.hpp"
+#include "button.hpp"
+#include "power.hpp"
+#include "diagnostics.hpp"
+
+#ifndef DIAG_BAUD_RATE
+#define DIAG_BAUD_RATE  115200u
+#endif
 
 LedDriver Led;
+Uart RadioUart(Uart::Port2);
+Uart DiagUart(Uart::Port1);
+Rak811 * Radio = nullptr;
+RadioLink * Link = nullptr;
+Indicator * Indication = nullptr;
+FiberHost * Fibers = nullptr;
+
+// кнопки SELECT и DOWN отладочной платы, замыкают на землю; линии EXT_INT на них не выведены
+static const Buttons::Pin s_referee_pins[] = {
+	{Buttons::PortC, PORT_Pin_2, PORT_FUNC_PORT, 0, true},
+	{Buttons::PortE, PORT_Pin_1, PORT_FUNC_PORT, 0, true}};
+
+enum
+{
+	BTN_COUNT,
+	BTN_NO_COUNT
+};
 
-class LedTask: public Task
+// короткое нажатие - засчитать/не засчитать, длинное - запуск таймера/следующий спортсмен
+class RefereeTask: public Task
 {
 public:
-	LedTask(int16_t led, int16_t period) :
-			Task("LedTask"),
-			led(led),
-			period(period)
+	RefereeTask() :
+			Task("Referee"),
+			m_count(0)
 	{
 	}
 
 private:
-	int16_t led;
-	int16_t period;
+	uint32_t m_count;
 
 	virtual void Execute()
 	{
-		while (true) {
-			Led.Toggle(led);
-			Delay(period);
+		Buttons::Event event;
+		while (Buttons::Wait(event) == ResultOk) {
+			if (event.m_type != Buttons::EventRelease)
+				Indication->Set(event.m_button, Indicator::LayerAlert, Indicator::Pulse(150));
+			if (!Link)
+				continue;
+			if (event.m_type == Buttons::EventPress && event.m_button == BTN_COUNT)
+				Link->Post(RC_COUNT, ++m_count);
+			else if (event.m_type == Buttons::EventPress && event.m_button == BTN_NO_COUNT)
+				Link->Post(RC_NO_COUNT, m_count);
+			else if (event.m_type == Buttons::EventLongPress && event.m_button == BTN_COUNT)
+				Link->Post(RC_START_TIMER, m_count);
+			else if (event.m_type == Buttons::EventLongPress && event.m_button == BTN_NO_COUNT) {
+				m_count = 0;
+				Link->Post(RC_NEXT_ATHLETE, m_count);
+			}
 		}
 	}
 };
 
 void BlinkApp::Initialize()
 {
+	// индикация и радиолиния - волокна на одном стеке вместо двух задач
+	Fibers = new FiberHost();
+
+	Indication = new Indicator(Led);
 	for (int16_t led = 0; led < Led.GetNum(); led++) {
-		int16_t period = (led + 1) * 300 + 200;
-		Task::Add(new LedTask(led, period), Task::PriorityNormal, 0x100);
+		uint16_t period = (led + 1) * 300 + 200;
+		Indication->Set(led, Indicator::LayerBase, Indicator::Blink(period, period));
 	}
+	Fibers->Add(*Indication);
+
+	if (RadioUart.Initialize(RAK811_BAUD_RATE, Uart::ModeDma) == ResultOk) {
+		Radio = new Rak811(RadioUart);
+		Task::Add(Radio, Task::PriorityAboveNormal);
+		Link = new RadioLink(*Radio);
+		Fibers->Add(*Link);
+#if MACS_POWER_MANAGEMENT
+		// ответы радиомодуля приходят по UART, поэтому только сон без останова
+		Power::SetWakeSources(System::WakeGpio | System::WakeUart);
+#endif
+	}
+
+	if (Buttons::Initialize(s_referee_pins, countof(s_referee_pins)) == ResultOk)
+		Task::Add(new RefereeTask(), Task::PriorityHigh, 0x100);
+
+	Task::Add(Fibers, Task::PriorityNormal);
+
+	// снимок по любому байту с терминала; низший приоритет, чтобы не мешать остальным
+	if (DiagUart.Initialize(DIAG_BAUD_RATE) == ResultOk)
+		Task::Add(new Diagnostics(DiagUart), Task::PriorityLow);
 }
@@ -3,6 +3,14 @@
 #include <stdint.h>
 #include "application.hpp"
 #include "led.hpp"
+#include "indicator.hpp"
+#include "rak811.hpp"
+#include "radio_link.hpp"
+
+extern Rak811 * Radio;
+extern RadioLink * Link;
+extern Indicator * Indication;
+extern FiberHost * Fibers;
 
 class BlinkApp: public Application
 {
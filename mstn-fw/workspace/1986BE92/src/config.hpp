@@ -1 +1,5 @@
 #pragma once
+
+#define MACS_USE_UART  1
+#define MACS_USE_BUTTONS  1
+#define MACS_POWER_MANAGEMENT  1
@@ -0,0 +1,182 @@
+#include <string.h>
+#include "diagnostics.hpp"
+#include "mutex.hpp"
+#include "semaphore.hpp"
+#include "memory_manager.hpp"
+#include "mask_budget.hpp"
+#include "profiler.hpp"
+
+static const char * const s_states[] = {"READY", "RUN", "BLOCK", "OFF"};
+static const char * const s_reasons[] = {"-", "req", "tmo", "irq"};
+
+Diagnostics::Diagnostics(Uart & uart, uint32_t period_ms) :
+		Task("Diag"),
+		m_uart(uart),
+		m_period_ms(period_ms),
+		m_count(0),
+		m_total(0),
+		m_now(0),
+		m_prev_count(0),
+		m_prev_now(0)
+{
+#if MACS_SYNC_STATS
+	m_sync_count = 0;
+#endif
+}
+
+void Diagnostics::Execute()
+{
+#if MACS_PROFILING_ENABLED
+	MeasureSync();
+#endif
+	for (;;) {
+		char cmd;
+		size_t received = 0;
+		m_uart.Read(&cmd, 1, &received, m_period_ms ? m_period_ms : INFINITE_TIMEOUT);
+		if (!received && !m_period_ms)
+			continue;
+
+		Snapshot();
+		Report();
+	}
+}
+
+#if MACS_PROFILING_ENABLED
+// Lock/Unlock мьютекса и Signal/Wait семафора без конкуренции из этой непривилегированной задачи:
+// с MACS_SYNC_FAST_PATH - без SVC. Средние и минимумы попадают в сводку профилировщика;
+// вытеснение низшей задачи портит только максимум
+void Diagnostics::MeasureSync()
+{
+	static const uint ROUNDS = 100;
+	Mutex mutex;
+	BinarySemaphore sem;
+	for (uint i = 0; i < ROUNDS; ++i) {
+		{
+			PROF_EYE(PE_MUTEX_LOCK, lock);
+			mutex.Lock();
+		}
+		{
+			PROF_EYE(PE_MUTEX_UNLOCK, unlock);
+			mutex.Unlock();
+		}
+		{
+			PROF_EYE(PE_SEMPH_GIVE, give);
+			sem.Signal();
+		}
+		{
+			PROF_EYE(PE_SEMPH_TAKE, take);
+			sem.Wait();
+		}
+	}
+}
+#endif
+
+// под паузой только копирование: задачи не удаляются, объекты синхронизации не создаются и не удаляются.
+// Пики стеков считаются уже после паузы по скопированным границам
+void Diagnostics::Snapshot()
+{
+	{
+		PauseSection _ps_;
+
+		m_total = Sch().CopyTasksInfo(m_tasks, DIAG_MAX_TASKS);
+		m_now = Sch().GetTickCount();
+#if MACS_SYNC_STATS
+		SnapshotSync();
+#endif
+	}
+	m_count = MIN(m_total, DIAG_MAX_TASKS);
+	Scheduler::ScanStacks(m_tasks, m_count);
+}
+
+#if MACS_SYNC_STATS
+// реестр обходится под паузой Snapshot
+void Diagnostics::SnapshotSync()
+{
+	m_sync_count = 0;
+	for (SyncObject * obj = SyncObject::FirstStat(); obj && m_sync_count < DIAG_MAX_SYNC; obj = obj->NextStat()) {
+		if (!obj->GetName())
+			continue;
+		m_sync[m_sync_count].m_name = obj->GetName();
+		m_sync[m_sync_count].m_stats = obj->GetStats();
+		++m_sync_count;
+	}
+}
+
+void Diagnostics::ReportSync()
+{
+	char line[96];
+
+	Write("SYNC         ACQ      WAIT     TMO    QMAX  BOOST  TMAX(us)\r\n");
+	for (uint i = 0; i < m_sync_count; ++i) {
+		const SyncObject::Stats & st = m_sync[i].m_stats;
+		Sprintf(line, sizeof(line), "%-12.12s %-8lu %-8lu %-6lu %-5lu %-6lu %lu\r\n",
+				m_sync[i].m_name, st.m_acquires, st.m_contended, st.m_timeouts, st.m_max_queue, st.m_boosts,
+				System::CpuTicksToUs(st.m_max_blocked_cycles));
+		Write(line);
+	}
+}
+#endif
+
+uint32_t Diagnostics::PrevRunTicks(const Task * task) const
+{
+	for (uint i = 0; i < m_prev_count; ++i)
+		if (m_prev[i].m_task == task)
+			return m_prev[i].m_run_ticks;
+	return 0;
+}
+
+void Diagnostics::Write(const char * str)
+{
+	if (str)
+		m_uart.Write(str, strlen(str));
+}
+
+void Diagnostics::Report()
+{
+	char line[96];
+	uint32_t span = m_now - m_prev_now;
+
+	Sprintf(line, sizeof(line), "\r\n--- top @%lu ms, tasks %u\r\n", (ulong)(TicksToUs(m_now) / 1000), m_total);
+	Write(line);
+	Write("NAME         STATE PRIO  CPU%  STACK      WAKE\r\n");
+
+	for (uint i = 0; i < m_count; ++i) {
+		const Scheduler::TaskInfo & ti = m_tasks[i];
+		String prior;
+		PrintPriority(prior, ti.m_priority);
+		uint32_t run = ti.m_run_ticks - PrevRunTicks(ti.m_task);
+		uint share = span ? (uint)((uint64_t)run * 1000 / span) : 0;
+
+		Sprintf(line, sizeof(line), "%-12.12s %-5s %-5s %3u.%u  %4u/%-4u  %s\r\n",
+				ti.m_name ? ti.m_name : "?", s_states[ti.m_state], prior.Z(), share / 10, share % 10,
+				ti.m_stack_usage, ti.m_stack_len, s_reasons[ti.m_unblock_reason]);
+		Write(line);
+	}
+
+	m_prev_count = m_count;
+	for (uint i = 0; i < m_count; ++i) {
+		m_prev[i].m_task = m_tasks[i].m_task;
+		m_prev[i].m_run_ticks = m_tasks[i].m_run_ticks;
+	}
+	m_prev_now = m_now;
+
+#if MACS_SYNC_STATS
+	ReportSync();
+#endif
+
+#if MACS_MEM_STATISTICS
+	Sprintf(line, sizeof(line), "heap: %u used, %u peak, %u total\r\n",
+			MemoryManager::CurHeapSize(), MemoryManager::PeakHeapSize(), MemoryManager::MaxHeapSize());
+	Write(line);
+#endif
+
+#if MACS_MASK_BUDGET_ENABLED || MACS_PROFILING_ENABLED
+	String str;
+#if MACS_PROFILING_ENABLED
+	ProfEye::PrintResults(str, true);
+#elif MACS_MASK_BUDGET_ENABLED
+	MaskBudget::Print(str);
+#endif
+	Write(str);
+#endif
+}
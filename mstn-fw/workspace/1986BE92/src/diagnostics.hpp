@@ -0,0 +1,79 @@
+#pragma once
+
+#include <stdint.h>
+#include "scheduler.hpp"
+#include "uart.hpp"
+
+#ifndef DIAG_PERIOD_MS
+#define DIAG_PERIOD_MS     0u     // 0 - снимок только по команде
+#endif
+
+#ifndef DIAG_MAX_TASKS
+#define DIAG_MAX_TASKS     12u
+#endif
+
+#ifndef DIAG_MAX_SYNC
+#define DIAG_MAX_SYNC      8u     // именованных объектов синхронизации в отчете
+#endif
+
+// Снимок состояния пульта в UART, аналог top: задачи (имя, состояние, приоритет, доля процессора,
+// пик стека, причина разблокировки), куча, конкуренция за именованные объекты синхронизации
+// и сводки профилировщика.
+// С MACS_PROFILING_ENABLED при запуске замеряет на цели операции синхронизации без конкуренции (MeasureSync).
+// Снимок берется по любому принятому байту и раз в period_ms. Сведения о задачах и объектах синхронизации
+// копируются под одной короткой паузой планировщика в статический буфер; стеки обходятся, а строки
+// форматируются и передаются уже после нее.
+class Diagnostics: public Task
+{
+public:
+	Diagnostics(Uart & uart, uint32_t period_ms = DIAG_PERIOD_MS);
+
+private:
+	CLS_COPY(Diagnostics)
+
+	struct Usage
+	{
+		const Task * m_task;
+		uint32_t m_run_ticks;
+	};
+
+#if MACS_SYNC_STATS
+	struct SyncInfo
+	{
+		const char * m_name;
+		SyncObject::Stats m_stats;
+	};
+#endif
+
+	virtual void Execute();
+
+	void Snapshot();
+	void Report();
+#if MACS_SYNC_STATS
+	void SnapshotSync();
+	void ReportSync();
+#endif
+#if MACS_PROFILING_ENABLED
+	static void MeasureSync();
+#endif
+	uint32_t PrevRunTicks(const Task * task) const;
+	void Write(const char * str);
+
+private:
+	Uart & m_uart;
+	uint32_t m_period_ms;
+
+	Scheduler::TaskInfo m_tasks[DIAG_MAX_TASKS];
+	uint m_count;
+	uint m_total;
+	tick_t m_now;
+
+	Usage m_prev[DIAG_MAX_TASKS];
+	uint m_prev_count;
+	tick_t m_prev_now;
+
+#if MACS_SYNC_STATS
+	SyncInfo m_sync[DIAG_MAX_SYNC];
+	uint m_sync_count;
+#endif
+};
@@ -0,0 +1,114 @@
+#include <string.h>
+#include "indicator.hpp"
+
+Indicator::Indicator(LedDriver & driver) :
+		m_driver(driver),
+		m_written(0)
+{
+	memset(m_slots, 0, sizeof(m_slots));
+}
+
+Result Indicator::Set(uint output, Layer layer, const Pattern & pattern)
+{
+	if (output >= MAX_OUTPUTS || layer >= LAYER_COUNT || !pattern.m_on_ms || !pattern.m_flashes)
+		return ResultErrorInvalidArgs;
+
+	// шаблоны можно задать и в Application::Initialize: до запуска планировщика пауза и сигнал ничего не делают
+	{
+		PauseSection _ps_;
+		Slot & slot = m_slots[output][layer];
+		slot.m_pattern = pattern;
+		slot.m_start = Sch().GetTickCount();
+		slot.m_active = true;
+	}
+	m_changed.Signal();
+	return ResultOk;
+}
+
+Result Indicator::Clear(uint output, Layer layer)
+{
+	if (output >= MAX_OUTPUTS || layer >= LAYER_COUNT)
+		return ResultErrorInvalidArgs;
+
+	{
+		PauseSection _ps_;
+		m_slots[output][layer].m_active = false;
+	}
+	m_changed.Signal();
+	return ResultOk;
+}
+
+// false - конечный шаблон отработал
+bool Indicator::Evaluate(const Pattern & pattern, uint32_t elapsed_ms, bool & on, uint32_t & next_ms)
+{
+	if (!pattern.m_off_ms && !pattern.m_pause_ms && !pattern.m_repeats) {
+		on = true;
+		next_ms = INFINITE_TIMEOUT;
+		return true;
+	}
+
+	uint32_t period = pattern.m_on_ms + pattern.m_off_ms;
+	uint32_t flashes_len = pattern.m_flashes * period;
+	uint32_t group = flashes_len + pattern.m_pause_ms;
+	if (pattern.m_repeats && elapsed_ms >= pattern.m_repeats * group)
+		return false;
+
+	uint32_t pos = elapsed_ms % group;
+	if (pos >= flashes_len) {
+		on = false;
+		next_ms = group - pos;
+		return true;
+	}
+
+	uint32_t flash = pos / period;
+	uint32_t phase = pos % period;
+	on = phase < pattern.m_on_ms;
+	if (on)
+		next_ms = pattern.m_on_ms - phase;
+	else
+		next_ms = (flash + 1 < pattern.m_flashes ? (flash + 1) * period : group) - pos;
+	return true;
+}
+
+// выводит уровни на сейчас; возвращает время до ближайшей смены
+uint32_t Indicator::Refresh()
+{
+	uint32_t mask = 0;
+	uint32_t wait_ms = INFINITE_TIMEOUT;
+
+	// время читается под паузой: слот, взведенный Set() до нее, не окажется моложе now
+	{
+		PauseSection _ps_;
+		tick_t now = Sch().GetTickCount();
+		for (uint out = 0; out < MAX_OUTPUTS; ++out)
+			for (int layer = LAYER_COUNT - 1; layer >= 0; --layer) {
+				Slot & slot = m_slots[out][layer];
+				if (!slot.m_active)
+					continue;
+				bool on;
+				uint32_t next_ms;
+				if (!Evaluate(slot.m_pattern, TicksToUs(now - slot.m_start) / 1000, on, next_ms)) {
+					slot.m_active = false;
+					continue;
+				}
+				if (on)
+					mask |= 1u << out;
+				wait_ms = MIN(wait_ms, next_ms);
+				break;
+			}
+	}
+
+	if (mask != m_written) {
+		m_driver.Write(mask);
+		m_written = mask;
+	}
+	return wait_ms;
+}
+
+void Indicator::Run()
+{
+	FIBER_BEGIN();
+	for (;;)
+		FIBER_WAIT(m_changed, Refresh());
+	FIBER_END();
+}
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <stdint.h>
+#include "fiber.hpp"
+#include "led.hpp"
+
+// Одно волокно ведет все индикаторы по шаблонам и спит до ближайшей смены уровня.
+// У каждого выхода несколько слоев: горит шаблон самого приоритетного активного слоя,
+// конечный шаблон по окончании открывает нижний слой.
+class Indicator: public Fiber
+{
+public:
+	static const uint MAX_OUTPUTS = NUM_LED;
+
+	enum Layer
+	{
+		LayerBase,
+		LayerStatus,
+		LayerAlert,
+		LAYER_COUNT
+	};
+
+	struct Pattern
+	{
+		uint16_t m_on_ms;
+		uint16_t m_off_ms;     // 0 вместе с m_pause_ms - горит постоянно
+		uint8_t m_flashes;     // вспышек в серии
+		uint16_t m_pause_ms;   // пауза после серии
+		uint8_t m_repeats;     // число серий, 0 - бесконечно
+	};
+
+	static Pattern Solid()
+	{
+		Pattern p = {1, 0, 1, 0, 0};
+		return p;
+	}
+	static Pattern Blink(uint16_t on_ms, uint16_t off_ms)
+	{
+		Pattern p = {on_ms, off_ms, 1, 0, 0};
+		return p;
+	}
+	static Pattern Pulse(uint16_t on_ms)
+	{
+		Pattern p = {on_ms, 0, 1, 0, 1};
+		return p;
+	}
+	static Pattern Flashes(uint8_t count, uint16_t on_ms, uint16_t off_ms, uint16_t pause_ms = 0, uint8_t repeats = 1)
+	{
+		Pattern p = {on_ms, off_ms, count, pause_ms, repeats};
+		return p;
+	}
+
+	explicit Indicator(LedDriver & driver);
+
+	// только из задач
+	Result Set(uint output, Layer layer, const Pattern & pattern);
+	Result Clear(uint output, Layer layer);
+
+private:
+	CLS_COPY(Indicator)
+
+	struct Slot
+	{
+		bool m_active;
+		Pattern m_pattern;
+		tick_t m_start;
+	};
+
+	virtual void Run();
+
+	uint32_t Refresh();
+	static bool Evaluate(const Pattern & pattern, uint32_t elapsed_ms, bool & on, uint32_t & next_ms);
+
+private:
+	LedDriver & m_driver;
+	BinarySemaphore m_changed;
+	Slot m_slots[MAX_OUTPUTS][LAYER_COUNT];
+	uint32_t m_written;
+};
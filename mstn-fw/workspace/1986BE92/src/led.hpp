@@ -36,6 +36,7 @@ const uint16_t led_tbl[] = {
 	LED1};
 
 #define NUM_LED  2
+#define LED_MASK  (LED0 | LED1)
 
 class LedDriver
 {
@@ -66,6 +67,16 @@ public:
 		PORT_WriteBit(MDR_PORTB, led_tbl[i], (BitAction)!PORT_ReadInputDataBit(MDR_PORTB, led_tbl[i]));
 	}
 
+	// бит i маски - светодиод i; все выводы меняются одной записью в порт
+	void Write(uint32_t on_mask)
+	{
+		uint32_t data = PORT_ReadInputData(MDR_PORTB) & ~LED_MASK;
+		for (uint16_t i = 0; i < NUM_LED; i++)
+			if (on_mask & (1u << i))
+				data |= led_tbl[i];
+		PORT_Write(MDR_PORTB, data);
+	}
+
 	uint16_t GetNum() const
 	{
 		return NUM_LED;
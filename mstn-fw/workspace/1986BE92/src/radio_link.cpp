@@ -0,0 +1,101 @@
+#include <string.h>
+#include "system.hpp"
+#include "radio_link.hpp"
+
+typedef char FrameLenCheck[RadioWindow::MAX_FRAME_LEN == Rak811::MAX_FRAME_LEN ? 1 : -1];
+
+RadioLink::RadioLink(Rak811 & radio, uint64_t device_id, uint32_t batch_window_ms) :
+		m_radio(radio),
+		m_queue(QUEUE_LEN),
+		m_acks(ACK_QUEUE_LEN),
+		m_window(device_id, batch_window_ms, System::GetTickRate(), Send, this),
+		m_fast(true)
+{
+	m_radio.SetReceiveHook(OnReceive, this);
+}
+
+Result RadioLink::Post(RefereeCommand command, uint32_t approach)
+{
+	Item item;
+	item.m_code = command;
+	item.m_mask = 0;
+	item.m_value = approach;
+	Result res = m_queue.Push(item, 0);
+	if (res == ResultOk)
+		m_ready.Signal();
+	return res;
+}
+
+// выполняется в задаче драйвера радио
+void RadioLink::OnReceive(void * arg, const Rak811::Frame & frame)
+{
+	RadioLink * link = static_cast<RadioLink *>(arg);
+
+	RefereeFrame ack;
+	if (!ack.Decode(frame.m_data, frame.m_len) || ack.m_type != RefereeFrame::TypeAck || ack.m_device_id != link->m_window.GetDeviceId())
+		return;
+
+	Item item;
+	item.m_code = ack.m_seq;
+	item.m_mask = ack.m_ack_mask;
+	item.m_value = 0;
+	if (link->m_acks.Push(item, 0) == ResultOk)
+		link->m_ready.Signal();
+}
+
+// очередь драйвера полна - кадр остается в окне до следующего Poll
+bool RadioLink::Send(void * arg, const uint8_t * data, size_t len)
+{
+	RadioLink * link = static_cast<RadioLink *>(arg);
+
+	Rak811::Frame frame;
+	frame.m_len = len;
+	memcpy(frame.m_data, data, len);
+	return link->m_radio.Send(frame) == ResultOk;
+}
+
+uint32_t RadioLink::WaitMs()
+{
+	uint32_t ticks = m_window.NextTimeout(Sch().GetTickCount());
+	return ticks == RadioWindow::INFINITE ? INFINITE_TIMEOUT : TicksToUs(ticks) / 1000;
+}
+
+void RadioLink::Process()
+{
+	tick_t now = Sch().GetTickCount();
+
+	// сначала подтверждения: они освобождают окно передачи
+	Item item;
+	while (m_acks.Pop(item, 0) == ResultOk)
+		m_window.OnAck(item.m_code, item.m_mask, now);
+	while (m_queue.Pop(item, 0) == ResultOk) {
+		RefereeEvent event;
+		event.m_command = item.m_code;
+		event.m_approach = item.m_value;
+		m_window.AddEvent(event, now);
+	}
+
+	m_window.Poll(now);
+	UpdateCpuFreq();
+}
+
+void RadioLink::Run()
+{
+	FIBER_BEGIN();
+	UpdateCpuFreq();
+	for (;;) {
+		FIBER_WAIT(m_ready, WaitMs());
+		Process();
+	}
+	FIBER_END();
+}
+
+// частота меняется, пока линия молчит: до отправки первого кадра пачки и после последнего подтверждения
+void RadioLink::UpdateCpuFreq()
+{
+	bool busy = m_window.IsBusy();
+	if (busy == m_fast)
+		return;
+	if (System::SetCpuFreq(busy ? System::CPU_FREQ_HIGH : System::CPU_FREQ_LOW) == ResultOk)
+		m_fast = busy;
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <stdint.h>
+#include "fiber.hpp"
+#include "message_queue.hpp"
+#include "rak811.hpp"
+#include "radio_window.hpp"
+
+#ifndef RADIO_DEVICE_ID
+#define RADIO_DEVICE_ID        8888888888888888ull
+#endif
+
+#ifndef RADIO_BATCH_WINDOW_MS
+#define RADIO_BATCH_WINDOW_MS  30u
+#endif
+
+// Надежная доставка событий пульта: события за окно RADIO_BATCH_WINDOW_MS собираются в один кадр,
+// кадры нумеруются и хранятся до подтверждения; неподтвержденные повторяются с экспоненциальной задержкой
+// (логика окна - RadioWindow). Пока есть неотправленные или неподтвержденные кадры, ядро работает на полной частоте.
+// Работает волокном: очереди разбираются без ожидания, будит семафор m_ready или таймаут окна.
+class RadioLink: public Fiber
+{
+public:
+	static const size_t QUEUE_LEN = 8;
+	static const size_t ACK_QUEUE_LEN = 4;
+
+	typedef RadioWindow::Stats Stats;
+
+	RadioLink(Rak811 & radio, uint64_t device_id = RADIO_DEVICE_ID, uint32_t batch_window_ms = RADIO_BATCH_WINDOW_MS);
+
+	// не блокируется; только из задач
+	Result Post(RefereeCommand command, uint32_t approach);
+
+	const Stats & GetStats() const
+	{
+		return m_window.GetStats();
+	}
+
+private:
+	CLS_COPY(RadioLink)
+
+	struct Item
+	{
+		uint8_t m_code;  // команда или номер подтвержденного кадра
+		uint8_t m_mask;
+		uint32_t m_value;
+	};
+
+	static void OnReceive(void * arg, const Rak811::Frame & frame);
+	static bool Send(void * arg, const uint8_t * data, size_t len);
+
+	virtual void Run();
+
+	uint32_t WaitMs();
+	void Process();
+	void UpdateCpuFreq();
+
+private:
+	Rak811 & m_radio;
+	MessageQueue<Item> m_queue;
+	MessageQueue<Item> m_acks;  // подтверждения не теснят события в очереди
+	BinarySemaphore m_ready;    // в одной из очередей что-то есть
+
+	RadioWindow m_window;
+	bool m_fast;
+};
@@ -0,0 +1,165 @@
+#include <string.h>
+#include "radio_window.hpp"
+
+typedef char RetxWindowCheck[(RadioWindow::RETX_WINDOW & (RadioWindow::RETX_WINDOW - 1)) == 0 ? 1 : -1];
+
+RadioWindow::RadioWindow(uint64_t device_id, uint32_t batch_window_ms, uint32_t tick_hz, SendHook send, void * arg) :
+		m_batch_window_ms(batch_window_ms),
+		m_tick_hz(tick_hz),
+		m_send(send),
+		m_send_arg(arg),
+		m_batch_due(0),
+		m_next_seq(0)
+{
+	memset(&m_batch, 0, sizeof(m_batch));
+	m_batch.m_type = RefereeFrame::TypeEvents;
+	m_batch.m_device_id = device_id;
+	memset(m_slots, 0, sizeof(m_slots));
+	memset(&m_stats, 0, sizeof(m_stats));
+}
+
+bool RadioWindow::IsBusy() const
+{
+	if (m_batch.m_count)
+		return true;
+	for (unsigned i = 0; i < RETX_WINDOW; ++i)
+		if (m_slots[i].m_used)
+			return true;
+	return false;
+}
+
+void RadioWindow::AddEvent(const RefereeEvent & event, uint32_t now)
+{
+	++m_stats.m_events;
+
+	if (m_batch.m_count == RefereeFrame::MAX_EVENTS)
+		Flush(now);
+	if (m_batch.m_count == RefereeFrame::MAX_EVENTS) {
+		++m_stats.m_dropped;
+		return;
+	}
+
+	m_batch.m_events[m_batch.m_count++] = event;
+	if (m_batch.m_count > 1 && m_batch.EncodedLen() > MAX_FRAME_LEN) {
+		--m_batch.m_count;
+		Flush(now);
+		if (m_batch.m_count) {
+			++m_stats.m_dropped;
+			return;
+		}
+		m_batch.m_events[m_batch.m_count++] = event;
+	}
+
+	if (m_batch.m_count == 1)
+		m_batch_due = now + MsToTicks(m_batch_window_ms);
+}
+
+void RadioWindow::Poll(uint32_t now)
+{
+	if (m_batch.m_count && IsDue(m_batch_due, now))
+		Flush(now);
+	Retransmit(now);
+}
+
+bool RadioWindow::CanFlush() const
+{
+	return !m_slots[m_next_seq % RETX_WINDOW].m_used;
+}
+
+// при занятом окне события продолжают копиться в текущем кадре
+void RadioWindow::Flush(uint32_t now)
+{
+	if (!CanFlush())
+		return;
+
+	Slot & slot = m_slots[m_next_seq % RETX_WINDOW];
+	m_batch.m_seq = m_next_seq++;
+	slot.m_len = m_batch.Encode(slot.m_data, sizeof(slot.m_data));
+	m_batch.m_count = 0;
+	if (!slot.m_len)
+		return;
+
+	slot.m_used = true;
+	slot.m_seq = m_batch.m_seq;
+	slot.m_tries = 0;
+	slot.m_sent_at = now;
+	Transmit(slot, now);
+}
+
+bool RadioWindow::Transmit(Slot & slot, uint32_t now)
+{
+	if (!m_send(m_send_arg, slot.m_data, slot.m_len)) {
+		slot.m_due = now + (MsToTicks(RESEND_MS) ? MsToTicks(RESEND_MS) : 1);
+		++m_stats.m_refused;
+		return false;
+	}
+
+	uint32_t backoff_ms = slot.m_tries < 5 ? RETX_BASE_MS << slot.m_tries : RETX_MAX_MS;
+	slot.m_due = now + MsToTicks(backoff_ms < RETX_MAX_MS ? backoff_ms : RETX_MAX_MS);
+	++slot.m_tries;
+
+	++m_stats.m_frames;
+	m_stats.m_tx_bytes += slot.m_len;
+	return true;
+}
+
+void RadioWindow::Retransmit(uint32_t now)
+{
+	for (unsigned i = 0; i < RETX_WINDOW; ++i) {
+		Slot & slot = m_slots[i];
+		if (!slot.m_used || !IsDue(slot.m_due, now))
+			continue;
+		if (slot.m_tries >= MAX_TRIES) {
+			slot.m_used = false;
+			++m_stats.m_lost;
+			continue;
+		}
+		// кадр, ни разу не принятый радио, уходит впервые
+		bool sent = slot.m_tries != 0;
+		if (Transmit(slot, now) && sent)
+			++m_stats.m_retransmits;
+	}
+}
+
+void RadioWindow::OnAck(uint8_t seq, uint8_t mask, uint32_t now)
+{
+	Acknowledge(seq, now);
+	for (unsigned i = 0; i < 8; ++i)
+		if (mask & (1u << i))
+			Acknowledge(seq - 1 - i, now);
+}
+
+void RadioWindow::Acknowledge(uint8_t seq, uint32_t now)
+{
+	Slot & slot = m_slots[seq % RETX_WINDOW];
+	if (!slot.m_used || slot.m_seq != seq)
+		return;
+
+	slot.m_used = false;
+	++m_stats.m_acked;
+	uint32_t latency_ms = TicksToMs(now - slot.m_sent_at);
+	if (latency_ms > m_stats.m_ack_latency_max_ms)
+		m_stats.m_ack_latency_max_ms = latency_ms;
+}
+
+uint32_t RadioWindow::NextTimeout(uint32_t now) const
+{
+	bool found = false;
+	uint32_t due = 0;
+
+	if (m_batch.m_count && CanFlush()) {
+		due = m_batch_due;
+		found = true;
+	}
+	for (unsigned i = 0; i < RETX_WINDOW; ++i) {
+		const Slot & slot = m_slots[i];
+		if (slot.m_used && (!found || (int32_t)(slot.m_due - due) < 0)) {
+			due = slot.m_due;
+			found = true;
+		}
+	}
+
+	if (!found)
+		return INFINITE;
+	return IsDue(due, now) ? 0 : due - now;
+}
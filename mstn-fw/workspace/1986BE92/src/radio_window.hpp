@@ -0,0 +1,101 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include "referee_frame.hpp"
+
+// Окно передачи RadioLink без ядра и радио: пачки событий, нумерация кадров, повторы и подтверждения.
+// Время - в тиках планировщика (переполнение учтено), кадры уходят через SendHook. Кадр, который радио
+// не приняло, остается неотправленным и повторяется через RESEND_MS без счета попыток.
+// Собирается и на ПК, см. test/link_sim.cpp
+class RadioWindow
+{
+public:
+	static const unsigned RETX_WINDOW = 8;
+	static const unsigned MAX_TRIES = 6;
+	static const uint32_t RETX_BASE_MS = 250;
+	static const uint32_t RETX_MAX_MS = 4000;
+	static const uint32_t RESEND_MS = 20;
+	static const size_t MAX_FRAME_LEN = 32;
+	static const uint32_t INFINITE = 0xFFFFFFFFu;
+
+	struct Stats
+	{
+		uint32_t m_events;
+		uint32_t m_dropped;
+		uint32_t m_frames;
+		uint32_t m_retransmits;
+		uint32_t m_refused;
+		uint32_t m_acked;
+		uint32_t m_lost;
+		uint32_t m_tx_bytes;
+		uint32_t m_ack_latency_max_ms;
+	};
+
+	// false - радио кадр не приняло
+	typedef bool (*SendHook)(void * arg, const uint8_t * data, size_t len);
+
+	RadioWindow(uint64_t device_id, uint32_t batch_window_ms, uint32_t tick_hz, SendHook send, void * arg);
+
+	void AddEvent(const RefereeEvent & event, uint32_t now);
+	void OnAck(uint8_t seq, uint8_t mask, uint32_t now);
+	// отправляет созревшую пачку и повторяет неподтвержденные кадры
+	void Poll(uint32_t now);
+	// тиков до следующего дела, INFINITE - ждать нечего
+	uint32_t NextTimeout(uint32_t now) const;
+	// есть неотправленные или неподтвержденные кадры
+	bool IsBusy() const;
+
+	uint64_t GetDeviceId() const
+	{
+		return m_batch.m_device_id;
+	}
+	const Stats & GetStats() const
+	{
+		return m_stats;
+	}
+
+private:
+	struct Slot
+	{
+		bool m_used;
+		uint8_t m_seq;
+		uint8_t m_tries;
+		uint8_t m_len;
+		uint32_t m_sent_at;
+		uint32_t m_due;
+		uint8_t m_data[MAX_FRAME_LEN];
+	};
+
+	static inline bool IsDue(uint32_t due, uint32_t now)
+	{
+		return (int32_t)(due - now) <= 0;
+	}
+	uint32_t MsToTicks(uint32_t ms) const
+	{
+		return (uint32_t)((uint64_t)m_tick_hz * ms / 1000);
+	}
+	uint32_t TicksToMs(uint32_t ticks) const
+	{
+		return (uint32_t)((uint64_t)ticks * 1000 / m_tick_hz);
+	}
+
+	bool CanFlush() const;
+	void Flush(uint32_t now);
+	bool Transmit(Slot & slot, uint32_t now);
+	void Retransmit(uint32_t now);
+	void Acknowledge(uint8_t seq, uint32_t now);
+
+private:
+	const uint32_t m_batch_window_ms;
+	const uint32_t m_tick_hz;
+	SendHook m_send;
+	void * m_send_arg;
+
+	RefereeFrame m_batch;
+	uint32_t m_batch_due;
+	uint8_t m_next_seq;
+	Slot m_slots[RETX_WINDOW];
+
+	Stats m_stats;
+};
@@ -0,0 +1,306 @@
+#include <string.h>
+#include "rak811.hpp"
+
+typedef char CmdQueueLenCheck[(Rak811::CMD_QUEUE_LEN & (Rak811::CMD_QUEUE_LEN - 1)) == 0 ? 1 : -1];
+
+static const char * const s_init_cmds[] = {
+	"at+mode=1",
+	"at+rf_config=867700000,10,0,1,8,14",
+	"at+rxc=1"};
+
+static const char TXC_PREFIX[] = "at+txc=1,10,";
+static const char LINE_END[] = "\r\n";
+
+static const char * const s_keywords[] = {
+	"OK",
+	"ERROR",
+	"at+recv="};
+
+enum
+{
+	KW_OK,
+	KW_ERROR,
+	KW_RECV,
+	KW_COUNT
+};
+
+// at+recv=<status>,<rssi>,<len>,<hex>
+static const uint RECV_DATA_FIELD = 3;
+
+static const size_t RX_CHUNK_LEN = 32;
+// проверка таймаута, пока ждем ответа
+static const uint32_t POLL_PERIOD_MS = 100;
+static const uint32_t TX_TIMEOUT_MS = 50;
+
+static const char HEX_DIGITS[] = "0123456789ABCDEF";
+
+static int HexValue(char c)
+{
+	if (c >= '0' && c <= '9')
+		return c - '0';
+	if (c >= 'A' && c <= 'F')
+		return c - 'A' + 10;
+	if (c >= 'a' && c <= 'f')
+		return c - 'a' + 10;
+	return -1;
+}
+
+Rak811::Rak811(Uart & uart) :
+		Task("RAK811"),
+		m_uart(uart),
+		m_rx_queue(RX_QUEUE_LEN),
+		m_req_head(0),
+		m_req_sent(0),
+		m_req_tail(0),
+		m_stale(0),
+		m_stale_since(0),
+		m_state(PS_LINE_START),
+		m_kw_mask(0),
+		m_kw_pos(0),
+		m_field(0),
+		m_low_nibble(false),
+		m_rx_dropped(0),
+		m_rx_hook(nullptr),
+		m_rx_hook_arg(nullptr)
+{
+	m_rx_frame.m_len = 0;
+}
+
+Result Rak811::Command(const char * cmd, Callback cb, void * arg)
+{
+	Request req;
+	req.m_cmd = cmd;
+	req.m_frame.m_len = 0;
+	req.m_cb = cb;
+	req.m_arg = arg;
+	return Enqueue(req);
+}
+
+Result Rak811::Send(const Frame & frame, Callback cb, void * arg)
+{
+	if (!frame.m_len || frame.m_len > MAX_FRAME_LEN)
+		return ResultErrorInvalidArgs;
+
+	Request req;
+	req.m_cmd = nullptr;
+	req.m_frame = frame;
+	req.m_cb = cb;
+	req.m_arg = arg;
+	return Enqueue(req);
+}
+
+Result Rak811::Enqueue(const Request & req)
+{
+	{
+		MutexGuard _guard_(m_lock);
+		if (m_req_tail - m_req_head == CMD_QUEUE_LEN)
+			return ResultErrorInvalidState;
+		m_requests[m_req_tail % CMD_QUEUE_LEN] = req;
+		++m_req_tail;
+	}
+
+	Task::Notify(this, NOTIFY_TX);
+	return ResultOk;
+}
+
+void Rak811::ReceivePending()
+{
+	char buf[RX_CHUNK_LEN];
+	size_t cnt;
+	do {
+		cnt = 0;
+		m_uart.Read(buf, sizeof(buf), &cnt, 0);
+		for (size_t i = 0; i < cnt; ++i)
+			Parse(buf[i]);
+	} while (cnt == sizeof(buf));
+}
+
+// только в задаче драйвера; слот [m_req_sent, m_req_tail) не меняется, пока голова не пройдет его
+void Rak811::TransmitPending()
+{
+	while (!m_stale) {
+		const Request * req;
+		{
+			MutexGuard _guard_(m_lock);
+			if (m_req_sent == m_req_tail || m_req_sent - m_req_head >= PIPELINE_DEPTH)
+				return;
+			Request & next = m_requests[m_req_sent % CMD_QUEUE_LEN];
+			next.m_sent_at = Sch().GetTickCount();
+			++m_req_sent;
+			req = &next;
+		}
+		Transmit(*req);
+	}
+}
+
+void Rak811::Transmit(const Request & req)
+{
+	if (req.m_cmd) {
+		m_uart.Write(req.m_cmd, strlen(req.m_cmd), nullptr, TX_TIMEOUT_MS);
+		m_uart.Write(LINE_END, sizeof(LINE_END) - 1, nullptr, TX_TIMEOUT_MS);
+		return;
+	}
+
+	// строка целиком, чтобы модуль получил ее без пауз
+	char line[sizeof(TXC_PREFIX) - 1 + 2 * MAX_FRAME_LEN + sizeof(LINE_END) - 1];
+	size_t len = sizeof(TXC_PREFIX) - 1;
+	memcpy(line, TXC_PREFIX, len);
+	for (uint i = 0; i < req.m_frame.m_len; ++i) {
+		line[len++] = HEX_DIGITS[req.m_frame.m_data[i] >> 4];
+		line[len++] = HEX_DIGITS[req.m_frame.m_data[i] & 0x0F];
+	}
+	memcpy(&line[len], LINE_END, sizeof(LINE_END) - 1);
+	len += sizeof(LINE_END) - 1;
+	m_uart.Write(line, len, nullptr, TX_TIMEOUT_MS);
+}
+
+void Rak811::OnResponse(Result res)
+{
+	// опоздавший ответ на запрос, уже завершенный по таймауту
+	if (m_stale) {
+		--m_stale;
+		m_stale_since = Sch().GetTickCount();
+		return;
+	}
+	Complete(res);
+}
+
+void Rak811::Complete(Result res)
+{
+	Callback cb;
+	void * arg;
+	{
+		MutexGuard _guard_(m_lock);
+		if (m_req_head == m_req_sent)
+			return;
+		const Request & req = m_requests[m_req_head % CMD_QUEUE_LEN];
+		cb = req.m_cb;
+		arg = req.m_arg;
+		++m_req_head;
+	}
+
+	if (cb)
+		cb(arg, res);
+}
+
+void Rak811::CheckTimeout()
+{
+	tick_t now = Sch().GetTickCount();
+	// остальные ответы потеряны
+	if (m_stale && now - m_stale_since >= MsToTicks(RESPONSE_TIMEOUT_MS))
+		m_stale = 0;
+
+	if (m_req_head == m_req_sent
+			|| now - m_requests[m_req_head % CMD_QUEUE_LEN].m_sent_at < MsToTicks(RESPONSE_TIMEOUT_MS))
+		return;
+
+	// ответ на более поздний запрос не отличить от опоздавшего ответа головы
+	uint in_flight = m_req_sent - m_req_head;
+	m_stale += in_flight;
+	m_stale_since = now;
+	while (in_flight--)
+		Complete(ResultTimeout);
+}
+
+void Rak811::Parse(char c)
+{
+	if (c == '\r' || c == '\n') {
+		if (m_state == PS_RECV_DATA)
+			OnFrameEnd();
+		m_state = PS_LINE_START;
+		return;
+	}
+
+	switch (m_state) {
+	case PS_LINE_START:
+		m_kw_mask = (1u << KW_COUNT) - 1;
+		m_kw_pos = 0;
+		m_state = PS_KEYWORD;
+		// no break
+	case PS_KEYWORD:
+		for (uint kw = 0; kw < KW_COUNT; ++kw)
+			if ((m_kw_mask & (1u << kw)) && s_keywords[kw][m_kw_pos] != c)
+				m_kw_mask &= ~(1u << kw);
+		++m_kw_pos;
+		if (!m_kw_mask) {
+			m_state = PS_SKIP_LINE;
+			break;
+		}
+		for (uint kw = 0; kw < KW_COUNT; ++kw)
+			if ((m_kw_mask & (1u << kw)) && !s_keywords[kw][m_kw_pos]) {
+				OnKeyword(kw);
+				break;
+			}
+		break;
+	case PS_RECV_FIELDS:
+		if (c == ',' && ++m_field == RECV_DATA_FIELD) {
+			m_rx_frame.m_len = 0;
+			m_low_nibble = false;
+			m_state = PS_RECV_DATA;
+		}
+		break;
+	case PS_RECV_DATA:
+	{
+		int val = HexValue(c);
+		if (val < 0 || (!m_low_nibble && m_rx_frame.m_len == MAX_FRAME_LEN)) {
+			++m_rx_dropped;
+			m_state = PS_SKIP_LINE;
+			break;
+		}
+		if (m_low_nibble)
+			m_rx_frame.m_data[m_rx_frame.m_len++] |= val;
+		else
+			m_rx_frame.m_data[m_rx_frame.m_len] = val << 4;
+		m_low_nibble = !m_low_nibble;
+	}
+		break;
+	case PS_SKIP_LINE:
+		break;
+	}
+}
+
+void Rak811::OnKeyword(uint kw)
+{
+	switch (kw) {
+	case KW_OK:
+		OnResponse(ResultOk);
+		m_state = PS_SKIP_LINE;
+		break;
+	case KW_ERROR:
+		OnResponse(ResultErrorInvalidState);
+		m_state = PS_SKIP_LINE;
+		break;
+	case KW_RECV:
+		m_field = 0;
+		m_state = PS_RECV_FIELDS;
+		break;
+	}
+}
+
+void Rak811::OnFrameEnd()
+{
+	if (m_low_nibble || !m_rx_frame.m_len) {
+		++m_rx_dropped;
+		return;
+	}
+	if (m_rx_hook)
+		m_rx_hook(m_rx_hook_arg, m_rx_frame);
+	else if (m_rx_queue.Push(m_rx_frame, 0) != ResultOk)
+		++m_rx_dropped;
+}
+
+void Rak811::Execute()
+{
+	m_uart.SetRxNotify(this, NOTIFY_RX);
+	for (uint i = 0; i < countof(s_init_cmds); ++i)
+		Command(s_init_cmds[i]);
+
+	for (;;) {
+		ReceivePending();
+		CheckTimeout();
+		TransmitPending();
+
+		bool waiting = m_req_head != m_req_sent || m_stale;
+		Task::WaitNotify(NOTIFY_RX | NOTIFY_TX, waiting ? POLL_PERIOD_MS : INFINITE_TIMEOUT);
+	}
+}
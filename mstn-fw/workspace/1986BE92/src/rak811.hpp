@@ -0,0 +1,122 @@
+#pragma once
+
+#include <stdint.h>
+#include "task.hpp"
+#include "mutex.hpp"
+#include "message_queue.hpp"
+#include "uart.hpp"
+
+#define RAK811_BAUD_RATE  115200
+
+// Драйвер LoRa-модуля RAK811 в режиме P2P.
+// Command и Send только ставят запрос в очередь и будят задачу драйвера уведомлением. В UART пишет
+// только она, не дожидаясь OK на предыдущие запросы (до PIPELINE_DEPTH штук). Ответы разбираются
+// по байтам из потока UART. Ответ без метки относится к самому старому запросу, поэтому по таймауту
+// завершаются все отправленные запросы. Опоздавшие на них OK/ERROR отбрасываются, и новые запросы
+// не отправляются, пока не придут все такие ответы или линия не промолчит RESPONSE_TIMEOUT_MS.
+class Rak811: public Task
+{
+public:
+	static const size_t MAX_FRAME_LEN = 32;
+	static const size_t RX_QUEUE_LEN = 4;
+	static const uint CMD_QUEUE_LEN = 8;
+	static const uint PIPELINE_DEPTH = 2;
+	static const uint32_t RESPONSE_TIMEOUT_MS = 2000;
+
+	struct Frame
+	{
+		uint8_t m_len;
+		uint8_t m_data[MAX_FRAME_LEN];
+	};
+
+	// вызывается в задаче драйвера: ResultOk - OK, ResultErrorInvalidState - ERROR, ResultTimeout - нет ответа
+	typedef void (*Callback)(void * arg, Result res);
+	typedef void (*ReceiveHook)(void * arg, const Frame & frame);
+
+	explicit Rak811(Uart & uart);
+
+	// не ждут ни ответа, ни UART; ResultErrorInvalidState - очередь полна. Только из задач
+	Result Command(const char * cmd, Callback cb = nullptr, void * arg = nullptr);
+	Result Send(const Frame & frame, Callback cb = nullptr, void * arg = nullptr);
+
+	// кадры из уведомлений at+recv
+	MessageQueue<Frame> & Received()
+	{
+		return m_rx_queue;
+	}
+
+	// перехватчик получает кадры в задаче драйвера вместо очереди Received()
+	void SetReceiveHook(ReceiveHook hook, void * arg)
+	{
+		m_rx_hook_arg = arg;
+		m_rx_hook = hook;
+	}
+
+	ulong GetRxDropped() const
+	{
+		return m_rx_dropped;
+	}
+
+private:
+	CLS_COPY(Rak811)
+
+	struct Request
+	{
+		const char * m_cmd;  // nullptr - передача m_frame
+		Frame m_frame;
+		Callback m_cb;
+		void * m_arg;
+		tick_t m_sent_at;
+	};
+
+	enum ParseState
+	{
+		PS_LINE_START,
+		PS_KEYWORD,
+		PS_RECV_FIELDS,
+		PS_RECV_DATA,
+		PS_SKIP_LINE
+	};
+
+	// биты уведомления задачи драйвера
+	static const uint32_t NOTIFY_RX = 1u << 0;
+	static const uint32_t NOTIFY_TX = 1u << 1;
+
+	virtual void Execute();
+
+	Result Enqueue(const Request & req);
+	void ReceivePending();
+	void TransmitPending();
+	void Transmit(const Request & req);
+	void OnResponse(Result res);
+	void Complete(Result res);
+	void CheckTimeout();
+
+	void Parse(char c);
+	void OnKeyword(uint kw);
+	void OnFrameEnd();
+
+private:
+	Uart & m_uart;
+	Mutex m_lock;
+	MessageQueue<Frame> m_rx_queue;
+
+	// [m_req_head, m_req_sent) - ждут ответа, [m_req_sent, m_req_tail) - ждут отправки
+	Request m_requests[CMD_QUEUE_LEN];
+	uint m_req_head;
+	uint m_req_sent;
+	uint m_req_tail;
+	// ответов, которые еще могут прийти на запросы, завершенные по таймауту
+	uint m_stale;
+	tick_t m_stale_since;
+
+	ParseState m_state;
+	uint m_kw_mask;
+	uint m_kw_pos;
+	uint m_field;
+	bool m_low_nibble;
+	Frame m_rx_frame;
+	ulong m_rx_dropped;
+	ReceiveHook m_rx_hook;
+	void * m_rx_hook_arg;
+};
@@ -0,0 +1,168 @@
+#pragma once
+
+// Двоичный кадр судейского пульта. Заголовочный файл собирается и для ARM, и на host.
+//
+// Версия 1 (многобайтные поля - little endian):
+//   заголовок     версия (3 бита) | тип (1 бит) | число событий (4 бита)
+//   ID устройства varint
+//   номер кадра   1 байт
+//   события       команда (1 байт), номер подхода (varint) - для TypeEvents
+//   маска         1 байт, биты подтверждают кадры seq-1 ... seq-8 - для TypeAck
+//   CRC-16        CCITT-FALSE по всем предыдущим байтам
+//
+// Текст старого формата начинается с 'I' (0x49, в поле версии 2),
+// поэтому оба формата различаются по первому байту.
+
+#include <stddef.h>
+#include <stdint.h>
+
+enum RefereeCommand
+{
+	RC_COUNT = 1,
+	RC_NO_COUNT = 2,
+	RC_START_TIMER = 3,
+	RC_NEXT_ATHLETE = 4
+};
+
+struct RefereeEvent
+{
+	uint8_t m_command;
+	uint32_t m_approach;
+};
+
+struct RefereeFrame
+{
+	enum Type
+	{
+		TypeEvents,
+		TypeAck
+	};
+
+	static const uint8_t VERSION = 1;
+	static const unsigned MAX_EVENTS = 8;
+	static const size_t MAX_VARINT32_LEN = 5;
+	static const size_t MAX_VARINT64_LEN = 10;
+	static const size_t MAX_LEN = 1 + MAX_VARINT64_LEN + 1 + MAX_EVENTS * (1 + MAX_VARINT32_LEN) + 2;
+
+	uint8_t m_type;
+	uint64_t m_device_id;
+	uint8_t m_seq;
+	uint8_t m_ack_mask;
+	uint8_t m_count;
+	RefereeEvent m_events[MAX_EVENTS];
+
+	static inline uint16_t Crc16(const uint8_t * data, size_t len, uint16_t crc = 0xFFFF)
+	{
+		while (len--) {
+			crc ^= (uint16_t)(*data++ << 8);
+			for (unsigned bit = 0; bit < 8; ++bit)
+				crc = (crc & 0x8000) ? (uint16_t)((crc << 1) ^ 0x1021) : (uint16_t)(crc << 1);
+		}
+		return crc;
+	}
+
+	static inline size_t VarintLen(uint64_t val)
+	{
+		size_t len = 1;
+		while (val >= 0x80) {
+			val >>= 7;
+			++len;
+		}
+		return len;
+	}
+
+	inline size_t EncodedLen() const
+	{
+		size_t len = 1 + VarintLen(m_device_id) + 1 + 2;
+		if (m_type == TypeAck)
+			return len + 1;
+		for (unsigned i = 0; i < m_count && i < MAX_EVENTS; ++i)
+			len += 1 + VarintLen(m_events[i].m_approach);
+		return len;
+	}
+
+	// возвращает длину кадра или 0, если он не помещается в буфер
+	inline size_t Encode(uint8_t * buf, size_t size) const
+	{
+		if (m_count > MAX_EVENTS || (m_type == TypeAck && m_count) || EncodedLen() > size)
+			return 0;
+
+		size_t len = 0;
+		buf[len++] = (uint8_t)((VERSION << 5) | (m_type << 4) | m_count);
+		len += PutVarint(&buf[len], m_device_id);
+		buf[len++] = m_seq;
+		if (m_type == TypeAck) {
+			buf[len++] = m_ack_mask;
+		} else {
+			for (unsigned i = 0; i < m_count; ++i) {
+				buf[len++] = m_events[i].m_command;
+				len += PutVarint(&buf[len], m_events[i].m_approach);
+			}
+		}
+		uint16_t crc = Crc16(buf, len);
+		buf[len++] = (uint8_t)crc;
+		buf[len++] = (uint8_t)(crc >> 8);
+		return len;
+	}
+
+	inline bool Decode(const uint8_t * buf, size_t len)
+	{
+		if (len < 1 + 1 + 1 + 2 || (buf[0] >> 5) != VERSION)
+			return false;
+		if (Crc16(buf, len - 2) != (uint16_t)(buf[len - 2] | (buf[len - 1] << 8)))
+			return false;
+
+		const uint8_t * end = buf + len - 2;
+		m_type = (buf[0] >> 4) & 1;
+		m_count = buf[0] & 0x0F;
+		if (m_count > MAX_EVENTS || (m_type == TypeAck && m_count))
+			return false;
+
+		const uint8_t * ptr = buf + 1;
+		if (!GetVarint(ptr, end, m_device_id) || ptr == end)
+			return false;
+		m_seq = *ptr++;
+		m_ack_mask = 0;
+
+		if (m_type == TypeAck) {
+			if (ptr == end)
+				return false;
+			m_ack_mask = *ptr++;
+		} else {
+			for (unsigned i = 0; i < m_count; ++i) {
+				uint64_t approach;
+				if (ptr == end)
+					return false;
+				m_events[i].m_command = *ptr++;
+				if (!GetVarint(ptr, end, approach) || approach > 0xFFFFFFFFu)
+					return false;
+				m_events[i].m_approach = (uint32_t)approach;
+			}
+		}
+		return ptr == end;
+	}
+
+private:
+	static inline size_t PutVarint(uint8_t * buf, uint64_t val)
+	{
+		size_t len = 0;
+		while (val >= 0x80) {
+			buf[len++] = (uint8_t)(val | 0x80);
+			val >>= 7;
+		}
+		buf[len++] = (uint8_t)val;
+		return len;
+	}
+
+	static inline bool GetVarint(const uint8_t * & ptr, const uint8_t * end, uint64_t & val)
+	{
+		val = 0;
+		for (unsigned shift = 0; ptr != end && shift < 7 * MAX_VARINT64_LEN; shift += 7) {
+			uint8_t b = *ptr++;
+			val |= (uint64_t)(b & 0x7F) << shift;
+			if (!(b & 0x80))
+				return true;
+		}
+		return false;
+	}
+};
@@ -0,0 +1,92 @@
+// Окно передачи RadioLink (RadioWindow) на ПК для модели канала с потерями, см. link_sim.py.
+// Время - миллисекунды (тик 1 мс). Команды построчно на stdin:
+//   post <t> <команда> <подход>   событие пульта
+//   ack <t> <hex>                 принятый кадр подтверждения
+//   tick <t>                      только продвинуть время
+//   busy <t> <0|1>                радио не принимает кадры (очередь драйвера полна)
+//   stats                         счетчики RadioWindow
+// На каждую команду времени - строки "tx <hex>" с отправленными кадрами и "next <t>"
+// (время следующего дела окна, -1 - ждать нечего).
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "radio_window.hpp"
+
+static const uint64_t DEVICE_ID = 8888888888888888ull;
+static const uint32_t BATCH_WINDOW_MS = 50;
+
+static bool s_busy = false;
+
+static bool Send(void *, const uint8_t * data, size_t len)
+{
+	if (s_busy)
+		return false;
+	printf("tx ");
+	for (size_t i = 0; i < len; ++i)
+		printf("%02X", data[i]);
+	printf("\n");
+	return true;
+}
+
+static size_t FromHex(const char * hex, uint8_t * buf, size_t size)
+{
+	size_t len = 0;
+	unsigned byte;
+	while (len < size && sscanf(hex + 2 * len, "%2X", &byte) == 1)
+		buf[len++] = (uint8_t)byte;
+	return len;
+}
+
+int main(int argc, char * argv[])
+{
+	uint32_t batch_window_ms = argc > 1 ? (uint32_t)strtoul(argv[1], 0, 10) : BATCH_WINDOW_MS;
+	RadioWindow window(DEVICE_ID, batch_window_ms, 1000, Send, 0);
+
+	char line[256];
+	while (fgets(line, sizeof(line), stdin)) {
+		char cmd[16], arg[128];
+		unsigned long t;
+		unsigned command, approach, busy;
+
+		if (!strncmp(line, "stats", 5)) {
+			const RadioWindow::Stats & s = window.GetStats();
+			printf("stats events %u dropped %u frames %u retransmits %u refused %u acked %u lost %u tx_bytes %u ack_latency_max_ms %u\n",
+					s.m_events, s.m_dropped, s.m_frames, s.m_retransmits, s.m_refused, s.m_acked, s.m_lost, s.m_tx_bytes, s.m_ack_latency_max_ms);
+			fflush(stdout);
+			continue;
+		}
+		if (sscanf(line, "%15s %lu", cmd, &t) != 2) {
+			fprintf(stderr, "link_sim: bad command: %s", line);
+			return 1;
+		}
+
+		uint32_t now = (uint32_t)t;
+		if (!strcmp(cmd, "post") && sscanf(line, "%*s %*u %u %u", &command, &approach) == 2) {
+			RefereeEvent event;
+			event.m_command = (uint8_t)command;
+			event.m_approach = approach;
+			window.AddEvent(event, now);
+		} else if (!strcmp(cmd, "ack") && sscanf(line, "%*s %*u %127s", arg) == 1) {
+			uint8_t buf[RefereeFrame::MAX_LEN];
+			RefereeFrame ack;
+			if (ack.Decode(buf, FromHex(arg, buf, sizeof(buf))) && ack.m_type == RefereeFrame::TypeAck && ack.m_device_id == window.GetDeviceId())
+				window.OnAck(ack.m_seq, ack.m_ack_mask, now);
+		} else if (!strcmp(cmd, "busy") && sscanf(line, "%*s %*u %u", &busy) == 1) {
+			s_busy = busy != 0;
+		} else if (strcmp(cmd, "tick")) {
+			fprintf(stderr, "link_sim: bad command: %s", line);
+			return 1;
+		}
+
+		// как RadioLink::Process: после подтверждений и событий - созревшие пачки и повторы
+		window.Poll(now);
+		uint32_t next = window.NextTimeout(now);
+		if (next == RadioWindow::INFINITE)
+			printf("next -1\n");
+		else
+			printf("next %lu\n", (unsigned long)(now + next));
+		fflush(stdout);
+	}
+	return 0;
+}
@@ -0,0 +1,177 @@
+#!/usr/bin/env python3
+#coding: utf-8
+
+""" Модель канала с потерями для связи пульт - табло.
+
+Пульт - окно передачи RadioLink, собранное на ПК (build/link_sim из link_sim.cpp),
+табло - LinkReceiver из board/referee_frame.py. Кадры в обе стороны теряются с заданной
+вероятностью и приходят с задержкой; передача пульта занимает эфир на время LoRa-кадра
+(режим P2P, как at+txc), следующий кадр ждет освобождения эфира.
+
+На выходе для каждой вероятности потерь: доля доставленных событий, задержка от нажатия
+до первой доставки (средняя, 95%, максимальная) и время в эфире на доставленное событие.
+
+Использование:
+    link_sim.py [--loss 0 0.1 0.3] [--ack-loss P] [--events N] [--interval MS] [--sf 7]
+    link_sim.py --loss 0 --min-delivery 1.0   код выхода 1, если доставлено меньше
+"""
+
+import argparse, heapq, math, os, random, re, subprocess, sys
+
+HERE = os.path.dirname(os.path.abspath(__file__))
+sys.path.insert(0, os.path.join(HERE, '..', '..', '..', '..', 'board'))
+import referee_frame
+
+APPROACH = re.compile(r'P(\d+)END$')
+
+
+def airtime_ms(length, sf=7, bw_khz=125, cr=1, preamble=8, crc=True, implicit_header=False):
+    """ время в эфире LoRa-кадра, Semtech AN1200.13 """
+    t_sym = (2 ** sf) / bw_khz
+    de = 1 if sf >= 11 and bw_khz == 125 else 0
+    num = 8 * length - 4 * sf + 28 + 16 * crc - 20 * implicit_header
+    symbols = 8 + max(math.ceil(num / (4 * (sf - 2 * de))) * (cr + 4), 0)
+    return (preamble + 4.25) * t_sym + symbols * t_sym
+
+
+class Window:
+    """ build/link_sim: команды в stdin, кадры и время следующего дела из stdout """
+
+    def __init__(self, binary, batch_ms):
+        self.proc = subprocess.Popen([binary, str(batch_ms)], stdin=subprocess.PIPE, stdout=subprocess.PIPE,
+                                     universal_newlines=True)
+        self.next = None
+
+    def command(self, line):
+        self.proc.stdin.write(line + '\n')
+        self.proc.stdin.flush()
+        frames = []
+        while True:
+            reply = self.proc.stdout.readline().split()
+            if not reply:
+                raise RuntimeError("link_sim exited")
+            if reply[0] == 'tx':
+                frames.append(bytes(bytearray.fromhex(reply[1])))
+            elif reply[0] == 'next':
+                t = int(reply[1])
+                self.next = None if t < 0 else t
+                return frames
+            elif reply[0] == 'stats':
+                return dict(zip(reply[1::2], map(int, reply[2::2])))
+
+    def close(self):
+        self.proc.stdin.close()
+        self.proc.wait()
+
+
+def run(args, loss, rnd):
+    window = Window(args.binary, args.batch)
+    receiver = referee_frame.LinkReceiver()
+
+    queue = []          # (время, порядковый номер, вид, данные)
+    order = [0]
+
+    def schedule(t, kind, data):
+        order[0] += 1
+        heapq.heappush(queue, (t, order[0], kind, data))
+
+    posted = {}
+    t = 0
+    for approach in range(1, args.events + 1):
+        t += rnd.expovariate(1.0 / args.interval)
+        posted[approach] = int(t)
+        schedule(int(t), 'post', (rnd.randint(1, 4), approach))
+
+    delivered = {}
+    air_free = 0.0
+    uplink_air = 0.0
+    downlink_air = 0.0
+    frames = 0
+    duplicates = 0
+
+    while queue or window.next is not None:
+        if window.next is not None and (not queue or window.next <= queue[0][0]):
+            now, kind, data = window.next, 'tick', None
+        else:
+            now, _, kind, data = heapq.heappop(queue)
+
+        if kind == 'post':
+            sent = window.command("post {0} {1} {2}".format(now, data[0], data[1]))
+        elif kind == 'ack':
+            sent = window.command("ack {0} {1}".format(now, data.hex().upper()))
+        elif kind == 'tick':
+            sent = window.command("tick {0}".format(now))
+        else:
+            # кадр дошел до табло
+            received, ack = receiver.receive(data)
+            if not received:
+                duplicates += 1
+            for message in received:
+                approach = int(APPROACH.search(message).group(1))
+                delivered.setdefault(approach, now)
+            if ack is not None:
+                air = airtime_ms(len(ack), args.sf)
+                downlink_air += air
+                if rnd.random() >= args.ack_loss:
+                    schedule(int(math.ceil(now + air + args.delay)), 'ack', ack)
+            continue
+
+        for frame in sent:
+            air = airtime_ms(len(frame), args.sf)
+            start = max(now, air_free)
+            air_free = start + air
+            uplink_air += air
+            frames += 1
+            if rnd.random() >= loss:
+                schedule(int(math.ceil(air_free + args.delay)), 'frame', frame)
+
+    stats = window.command("stats")
+    window.close()
+
+    latency = sorted(delivered[a] - posted[a] for a in delivered)
+    return {
+        'loss': loss,
+        'ratio': float(len(delivered)) / args.events,
+        'lat_avg': sum(latency) / float(len(latency)) if latency else 0,
+        'lat_p95': latency[int(0.95 * (len(latency) - 1))] if latency else 0,
+        'lat_max': latency[-1] if latency else 0,
+        'air_per_event': (uplink_air + downlink_air) / len(delivered) if delivered else float('inf'),
+        'uplink_per_event': uplink_air / len(delivered) if delivered else float('inf'),
+        'frames': frames,
+        'duplicates': duplicates,
+        'stats': stats,
+    }
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split('\n')[0])
+    parser.add_argument('--binary', default=os.path.join(HERE, 'build', 'link_sim'))
+    parser.add_argument('--loss', type=float, nargs='+', default=[0.0, 0.1, 0.3, 0.5])
+    parser.add_argument('--ack-loss', type=float, default=None, help="потери подтверждений, по умолчанию как --loss")
+    parser.add_argument('--events', type=int, default=500)
+    parser.add_argument('--interval', type=float, default=1500, help="среднее время между нажатиями, мс")
+    parser.add_argument('--batch', type=int, default=50, help="окно сбора пачки, мс (RADIO_BATCH_WINDOW_MS)")
+    parser.add_argument('--delay', type=float, default=20, help="задержка модема и UART в одну сторону, мс")
+    parser.add_argument('--sf', type=int, default=7)
+    parser.add_argument('--seed', type=int, default=1)
+    parser.add_argument('--min-delivery', type=float, default=None)
+    args = parser.parse_args()
+
+    print("{0:>5} {1:>8} {2:>8} {3:>8} {4:>8} {5:>10} {6:>10} {7:>6} {8:>6} {9:>5}".format(
+        'loss', 'deliver', 'lat avg', 'lat p95', 'lat max', 'air/event', 'up/event', 'frames', 'retx', 'dup'))
+    ok = True
+    for loss in args.loss:
+        ack_loss = args.ack_loss
+        args.ack_loss = loss if ack_loss is None else ack_loss
+        r = run(args, loss, random.Random(args.seed))
+        args.ack_loss = ack_loss
+        print("{0:5.2f} {1:8.4f} {2:6.0f}ms {3:6.0f}ms {4:6.0f}ms {5:8.1f}ms {6:8.1f}ms {7:6d} {8:6d} {9:5d}".format(
+            r['loss'], r['ratio'], r['lat_avg'], r['lat_p95'], r['lat_max'], r['air_per_event'],
+            r['uplink_per_event'], r['frames'], r['stats']['retransmits'], r['duplicates']))
+        if args.min_delivery is not None and r['ratio'] < args.min_delivery:
+            ok = False
+    return 0 if ok else 1
+
+
+if __name__ == "__main__":
+    sys.exit(main())
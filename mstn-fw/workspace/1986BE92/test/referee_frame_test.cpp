@@ -0,0 +1,225 @@
+// Кадр судейского пульта на ПК: кодирование и разбор, порча CRC, обрезанный varint, скорость.
+// Эталонные кадры получены board/referee_frame.py (encode)
+
+#include <stdio.h>
+#include <string.h>
+#include <chrono>
+#include "referee_frame.hpp"
+
+static int s_failed = 0;
+static int s_checked = 0;
+
+#define CHECK(e) Check((e), #e, __LINE__)
+
+static bool Check(bool ok, const char * expr, int line)
+{
+	++s_checked;
+	if (!ok) {
+		++s_failed;
+		fprintf(stderr, "referee_frame_test.cpp:%d: FAILED: %s\n", line, expr);
+	}
+	return ok;
+}
+
+static size_t FromHex(const char * hex, uint8_t * buf)
+{
+	size_t len = 0;
+	unsigned byte;
+	while (sscanf(hex + 2 * len, "%2X", &byte) == 1)
+		buf[len++] = (uint8_t)byte;
+	return len;
+}
+
+static RefereeFrame Events(uint64_t device_id, uint8_t seq)
+{
+	RefereeFrame frame;
+	memset(&frame, 0, sizeof(frame));
+	frame.m_type = RefereeFrame::TypeEvents;
+	frame.m_device_id = device_id;
+	frame.m_seq = seq;
+	return frame;
+}
+
+static void AddEvent(RefereeFrame & frame, uint8_t command, uint32_t approach)
+{
+	frame.m_events[frame.m_count].m_command = command;
+	frame.m_events[frame.m_count].m_approach = approach;
+	++frame.m_count;
+}
+
+static bool SameAsReference(const RefereeFrame & frame, const char * hex)
+{
+	uint8_t ref[RefereeFrame::MAX_LEN], buf[RefereeFrame::MAX_LEN];
+	size_t ref_len = FromHex(hex, ref);
+	size_t len = frame.Encode(buf, sizeof(buf));
+	return len == ref_len && len == frame.EncodedLen() && !memcmp(buf, ref, len);
+}
+
+static void TestReference()
+{
+	RefereeFrame one = Events(8888888888888888ull, 7);
+	AddEvent(one, RC_COUNT, 36);
+	CHECK(SameAsReference(one, "21B89CAEC5DB8CE50F0701243549"));
+
+	RefereeFrame edges = Events(1, 0);
+	AddEvent(edges, RC_COUNT, 0);
+	AddEvent(edges, RC_NO_COUNT, 127);
+	AddEvent(edges, RC_START_TIMER, 128);
+	AddEvent(edges, RC_NEXT_ATHLETE, 0xFFFFFFFFu);
+	CHECK(SameAsReference(edges, "2401000100027F03800104FFFFFFFF0FAA2C"));
+
+	RefereeFrame ack = Events(300, 255);
+	ack.m_type = RefereeFrame::TypeAck;
+	ack.m_ack_mask = 0xA5;
+	CHECK(SameAsReference(ack, "30AC02FFA57630"));
+}
+
+static bool RoundTrip(const RefereeFrame & frame)
+{
+	uint8_t buf[RefereeFrame::MAX_LEN];
+	size_t len = frame.Encode(buf, sizeof(buf));
+	RefereeFrame out;
+	if (!len || !out.Decode(buf, len))
+		return false;
+	if (out.m_type != frame.m_type || out.m_device_id != frame.m_device_id || out.m_seq != frame.m_seq || out.m_count != frame.m_count)
+		return false;
+	if (frame.m_type == RefereeFrame::TypeAck)
+		return out.m_ack_mask == frame.m_ack_mask;
+	for (unsigned i = 0; i < frame.m_count; ++i)
+		if (out.m_events[i].m_command != frame.m_events[i].m_command || out.m_events[i].m_approach != frame.m_events[i].m_approach)
+			return false;
+	return true;
+}
+
+static void TestRoundTrip()
+{
+	const uint64_t ids[] = { 0, 1, 0x7F, 0x80, 8888888888888888ull, ~0ull };
+	for (size_t i = 0; i < sizeof(ids) / sizeof(ids[0]); ++i)
+		for (unsigned count = 0; count <= RefereeFrame::MAX_EVENTS; ++count) {
+			RefereeFrame frame = Events(ids[i], (uint8_t)(i * 37 + count));
+			for (unsigned ev = 0; ev < count; ++ev)
+				AddEvent(frame, (uint8_t)(ev % 4 + 1), ev ? 0xFFFFFFFFu >> (ev * 4) : 0);
+			CHECK(RoundTrip(frame));
+		}
+
+	RefereeFrame ack = Events(~0ull, 0);
+	ack.m_type = RefereeFrame::TypeAck;
+	ack.m_ack_mask = 0xFF;
+	CHECK(RoundTrip(ack));
+
+	// MAX_LEN покрывает самый длинный кадр
+	RefereeFrame longest = Events(~0ull, 0);
+	for (unsigned ev = 0; ev < RefereeFrame::MAX_EVENTS; ++ev)
+		AddEvent(longest, RC_COUNT, 0xFFFFFFFFu);
+	CHECK(longest.EncodedLen() == RefereeFrame::MAX_LEN);
+
+	uint8_t buf[RefereeFrame::MAX_LEN];
+	CHECK(longest.Encode(buf, RefereeFrame::MAX_LEN - 1) == 0);
+	longest.m_count = RefereeFrame::MAX_EVENTS + 1;
+	CHECK(longest.Encode(buf, sizeof(buf)) == 0);
+}
+
+// любой испорченный бит отвергается CRC
+static void TestCrcCorruption()
+{
+	RefereeFrame frame = Events(8888888888888888ull, 7);
+	AddEvent(frame, RC_COUNT, 36);
+	AddEvent(frame, RC_START_TIMER, 1000);
+	uint8_t buf[RefereeFrame::MAX_LEN];
+	size_t len = frame.Encode(buf, sizeof(buf));
+
+	RefereeFrame out;
+	bool all_rejected = true;
+	for (size_t i = 0; i < len; ++i)
+		for (unsigned bit = 0; bit < 8; ++bit) {
+			buf[i] ^= (uint8_t)(1u << bit);
+			if (out.Decode(buf, len))
+				all_rejected = false;
+			buf[i] ^= (uint8_t)(1u << bit);
+		}
+	CHECK(all_rejected);
+	CHECK(out.Decode(buf, len));
+
+	// обрезанный кадр тоже
+	bool cut_rejected = true;
+	for (size_t cut = 0; cut < len; ++cut)
+		if (out.Decode(buf, cut))
+			cut_rejected = false;
+	CHECK(cut_rejected);
+}
+
+// кадр с верной CRC, но varint без последнего байта или длиннее 10 байт
+static bool DecodeWithCrc(const uint8_t * body, size_t len)
+{
+	uint8_t buf[64];
+	memcpy(buf, body, len);
+	uint16_t crc = RefereeFrame::Crc16(buf, len);
+	buf[len++] = (uint8_t)crc;
+	buf[len++] = (uint8_t)(crc >> 8);
+	RefereeFrame out;
+	return out.Decode(buf, len);
+}
+
+static void TestTruncatedVarint()
+{
+	// ID 0x80 без второго байта: за ним сразу конец кадра
+	const uint8_t id_cut[] = { 0x20, 0x80 };
+	CHECK(!DecodeWithCrc(id_cut, sizeof(id_cut)));
+
+	// ID без номера кадра
+	const uint8_t no_seq[] = { 0x20, 0x05 };
+	CHECK(!DecodeWithCrc(no_seq, sizeof(no_seq)));
+
+	// номер подхода оборван
+	const uint8_t approach_cut[] = { 0x21, 0x05, 0x01, RC_COUNT, 0xFF, 0xFF };
+	CHECK(!DecodeWithCrc(approach_cut, sizeof(approach_cut)));
+
+	// varint из 11 байт
+	uint8_t too_long[2 + 11 + 1] = { 0x20 };
+	for (size_t i = 1; i < 12; ++i)
+		too_long[i] = 0x80;
+	too_long[12] = 0x00;
+	CHECK(!DecodeWithCrc(too_long, 13));
+
+	// номер подхода больше 32 бит
+	const uint8_t approach_big[] = { 0x21, 0x05, 0x01, RC_COUNT, 0x80, 0x80, 0x80, 0x80, 0x10 };
+	CHECK(!DecodeWithCrc(approach_big, sizeof(approach_big)));
+
+	// лишний байт после событий
+	const uint8_t tail[] = { 0x21, 0x05, 0x01, RC_COUNT, 0x24, 0x00 };
+	CHECK(!DecodeWithCrc(tail, sizeof(tail)));
+	CHECK(DecodeWithCrc(tail, sizeof(tail) - 1));
+}
+
+static void Timing()
+{
+	RefereeFrame frame = Events(8888888888888888ull, 7);
+	AddEvent(frame, RC_COUNT, 36);
+	AddEvent(frame, RC_NEXT_ATHLETE, 37);
+
+	const unsigned LOOPS = 1000000;
+	uint8_t buf[RefereeFrame::MAX_LEN];
+	RefereeFrame out;
+	unsigned ok = 0;
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	for (unsigned i = 0; i < LOOPS; ++i) {
+		frame.m_seq = (uint8_t)i;
+		size_t len = frame.Encode(buf, sizeof(buf));
+		ok += out.Decode(buf, len);
+	}
+	double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / LOOPS;
+	CHECK(ok == LOOPS);
+	printf("encode+decode, 2 events: %.1f ns\n", ns);
+}
+
+int main()
+{
+	TestReference();
+	TestRoundTrip();
+	TestCrcCorruption();
+	TestTruncatedVarint();
+	Timing();
+
+	printf("%d checks, %d failed\n", s_checked, s_failed);
+	return s_failed ? 1 : 0;
+}